@@ -0,0 +1,98 @@
+// Масштабирование concurrent_map по числу потоков против map под одним
+// общим мьютексом. Смесь операций: 90% поиск, 9% insert_or_assign,
+// 1% erase по случайным ключам. Сборка и запуск: make bench_concurrent.
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_map.h"
+
+namespace {
+
+constexpr int kKeys = 1 << 20;
+constexpr long kOperations = 4000000;
+
+// map под одним мьютексом, как его делили до concurrent_map.
+class LockedMap {
+ public:
+  bool find(int key, long *value) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = data_.find(key);
+    if (it == data_.end()) return false;
+    *value = (*it).second;
+    return true;
+  }
+  void insert_or_assign(int key, long value) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    data_.insert_or_assign(key, value);
+  }
+  void erase(int key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = data_.find(key);
+    if (it != data_.end()) data_.erase(it);
+  }
+
+ private:
+  mutable std::shared_mutex mutex_;
+  STL::map<int, long> data_;
+};
+
+class ShardedMap {
+ public:
+  bool find(int key, long *value) const {
+    auto found = data_.find(key);
+    if (found) *value = *found;
+    return found.has_value();
+  }
+  void insert_or_assign(int key, long value) {
+    data_.insert_or_assign(key, value);
+  }
+  void erase(int key) { data_.erase(key); }
+
+ private:
+  STL::concurrent_map<int, long> data_;
+};
+
+template <class Map>
+double Throughput(int threads) {
+  Map map;
+  for (int key = 0; key < kKeys; key += 2) map.insert_or_assign(key, key);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&map, t, threads] {
+      std::mt19937 rng(t);
+      long sink = 0;
+      for (long i = 0; i < kOperations / threads; ++i) {
+        int key = int(rng() % kKeys);
+        int dice = int(rng() % 100);
+        if (dice < 90)
+          map.find(key, &sink);
+        else if (dice < 99)
+          map.insert_or_assign(key, i);
+        else
+          map.erase(key);
+      }
+      if (sink == -1) std::puts("");
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  auto finish = std::chrono::steady_clock::now();
+  return double(kOperations) /
+         std::chrono::duration<double, std::micro>(finish - start).count();
+}
+}  // namespace
+
+int main() {
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  std::printf("threads  locked map Mops/s  concurrent_map Mops/s\n");
+  for (int threads : {1, 2, 4, 8, 16, 32, 64}) {
+    double locked = Throughput<LockedMap>(threads);
+    double sharded = Throughput<ShardedMap>(threads);
+    std::printf("%7d  %19.2f  %21.2f\n", threads, locked, sharded);
+  }
+}
@@ -0,0 +1,312 @@
+// Набор Google Benchmark: STL::map, set и multiset рядом с std::map,
+// std::set и std::multiset. Операции: вставка (случайная, по
+// возрастанию, по убыванию), поиск (есть / нет), удаление, обход,
+// копирование, слияние, lower_bound/upper_bound и разрушение. Размеры
+// от 1e2 до 1e7, ключи int64, строка и 64-байтная структура.
+//
+// Сборка и запуск всего набора с JSON в bench_results.json:
+//   make bench
+// Часть набора:
+//   make bench BENCH_ARGS='--benchmark_filter=FindHit/.*int64/1000$'
+// Имя бенчмарка: Операция/контейнер<ключ>/размер.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../my_map.h"
+#include "../my_multiset.h"
+#include "../my_set.h"
+
+namespace {
+
+// Ключ размером в кеш-линию: сравнивается по первому слову, остальные
+// только занимают место, как поля большой записи.
+struct Key64 {
+  int64_t id;
+  char payload[56];
+
+  bool operator<(const Key64 &other) const { return id < other.id; }
+};
+
+// i-й ключ; разные i дают разные ключи, порядок ключей не совпадает с
+// порядком i.
+uint64_t Scramble(uint64_t i) { return (i * 0x9e3779b97f4a7c15ull) >> 1; }
+
+template <class K>
+K MakeKey(uint64_t i);
+
+template <>
+int64_t MakeKey<int64_t>(uint64_t i) {
+  return int64_t(Scramble(i));
+}
+
+template <>
+std::string MakeKey<std::string>(uint64_t i) {
+  return "key:" + std::to_string(Scramble(i));
+}
+
+template <>
+Key64 MakeKey<Key64>(uint64_t i) {
+  Key64 key;
+  key.id = int64_t(Scramble(i));
+  std::memset(key.payload, int(i & 0x7f), sizeof(key.payload));
+  return key;
+}
+
+template <class K>
+const char *KeyName();
+template <>
+const char *KeyName<int64_t>() {
+  return "int64";
+}
+template <>
+const char *KeyName<std::string>() {
+  return "string";
+}
+template <>
+const char *KeyName<Key64>() {
+  return "key64";
+}
+
+// Ключи одного размера строятся один раз: n ключей в случайном порядке,
+// они же по возрастанию и n ключей, которых в контейнере нет. Хранятся
+// только наборы текущего типа ключа - при 1e7 все типы разом не влезают
+// в память.
+template <class K>
+struct Dataset {
+  std::vector<K> random;
+  std::vector<K> sorted;
+  std::vector<K> missing;
+};
+
+void (*release_data)() = nullptr;
+
+template <class K>
+const Dataset<K> &Data(size_t n) {
+  static std::map<size_t, Dataset<K>> cache;
+  static void (*const release)() = [] { cache.clear(); };
+  if (release_data != release) {
+    if (release_data) release_data();
+    release_data = release;
+  }
+  auto found = cache.find(n);
+  if (found != cache.end()) return found->second;
+  Dataset<K> &data = cache[n];
+  data.random.reserve(n);
+  data.missing.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    data.random.push_back(MakeKey<K>(i));
+    data.missing.push_back(MakeKey<K>(n + i));
+  }
+  std::shuffle(data.random.begin(), data.random.end(), std::mt19937_64(n));
+  data.sorted = data.random;
+  std::sort(data.sorted.begin(), data.sorted.end());
+  return data;
+}
+
+// Элемент контейнера из ключа: для map - пара с нулевым значением.
+template <class C, class = void>
+struct IsMap : std::false_type {};
+template <class C>
+struct IsMap<C, std::void_t<typename C::mapped_type>> : std::true_type {};
+template <class C>
+struct IsMap<C, std::void_t<typename C::tree_type>> : std::true_type {};
+
+template <class C, class K>
+auto Element(const K &key) {
+  if constexpr (IsMap<C>::value)
+    return std::pair<K, int64_t>(key, 0);
+  else
+    return key;
+}
+
+template <class C, class K>
+void Fill(C &container, const std::vector<K> &keys) {
+  for (const K &key : keys) container.insert(Element<C>(key));
+}
+
+template <class C, class K>
+std::unique_ptr<C> Build(const std::vector<K> &keys) {
+  auto container = std::make_unique<C>();
+  Fill(*container, keys);
+  return container;
+}
+
+enum class Order { kRandom, kSorted, kReverse };
+
+template <class C, class K, Order order>
+void Insert(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  std::vector<K> keys = order == Order::kRandom ? data.random : data.sorted;
+  if (order == Order::kReverse) std::reverse(keys.begin(), keys.end());
+  for (auto _ : state) {
+    auto container = std::make_unique<C>();
+    Fill(*container, keys);
+    benchmark::DoNotOptimize(container->size());
+    state.PauseTiming();
+    container.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K, bool hit>
+void Find(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  auto container = Build<C>(data.random);
+  const std::vector<K> &probes = hit ? data.random : data.missing;
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const K &key : probes)
+      found += container->find(key) != container->end();
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void Bounds(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  auto container = Build<C>(data.random);
+  for (auto _ : state) {
+    for (size_t i = 0; i < data.random.size(); ++i) {
+      const K &key = i % 2 ? data.random[i] : data.missing[i];
+      benchmark::DoNotOptimize(container->lower_bound(key));
+      benchmark::DoNotOptimize(container->upper_bound(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void Erase(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto container = Build<C>(data.random);
+    state.ResumeTiming();
+    for (const K &key : data.random) container->erase(container->find(key));
+    benchmark::DoNotOptimize(container->size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void Iterate(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  auto container = Build<C>(data.random);
+  for (auto _ : state) {
+    for (auto it = container->begin(); it != container->end(); ++it)
+      benchmark::DoNotOptimize(&*it);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void Copy(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  auto container = Build<C>(data.random);
+  for (auto _ : state) {
+    auto copy = std::make_unique<C>(*container);
+    benchmark::DoNotOptimize(copy->size());
+    state.PauseTiming();
+    copy.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Слияние двух половин с чередующимися ключами.
+template <class C, class K>
+void Merge(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  std::vector<K> even;
+  std::vector<K> odd;
+  for (size_t i = 0; i < data.sorted.size(); ++i)
+    (i % 2 ? odd : even).push_back(data.sorted[i]);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto target = Build<C>(even);
+    auto source = Build<C>(odd);
+    state.ResumeTiming();
+    target->merge(*source);
+    benchmark::DoNotOptimize(target->size());
+    state.PauseTiming();
+    target.reset();
+    source.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void Destroy(benchmark::State &state) {
+  const Dataset<K> &data = Data<K>(size_t(state.range(0)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto container = Build<C>(data.random);
+    state.ResumeTiming();
+    container.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class C, class K>
+void RegisterContainer(const std::string &name) {
+  using Function = void (*)(benchmark::State &);
+  const std::pair<const char *, Function> operations[] = {
+      {"InsertRandom", Insert<C, K, Order::kRandom>},
+      {"InsertSorted", Insert<C, K, Order::kSorted>},
+      {"InsertReverse", Insert<C, K, Order::kReverse>},
+      {"FindHit", Find<C, K, true>},
+      {"FindMiss", Find<C, K, false>},
+      {"Bounds", Bounds<C, K>},
+      {"Erase", Erase<C, K>},
+      {"Iterate", Iterate<C, K>},
+      {"Copy", Copy<C, K>},
+      {"Merge", Merge<C, K>},
+      {"Destroy", Destroy<C, K>},
+  };
+  std::string suffix = name + "<" + KeyName<K>() + ">";
+  for (const auto &operation : operations) {
+    benchmark::RegisterBenchmark(
+        (std::string(operation.first) + "/" + suffix).c_str(),
+        operation.second)
+        ->RangeMultiplier(10)
+        ->Range(100, 10000000)
+        ->Unit(benchmark::kMicrosecond);
+  }
+}
+
+template <class K>
+void RegisterKey() {
+  RegisterContainer<std::map<K, int64_t>, K>("std::map");
+  RegisterContainer<STL::map<K, int64_t>, K>("STL::map");
+  RegisterContainer<STL::map<K, int64_t, std::less<K>,
+                             std::allocator<std::pair<K, int64_t>>,
+                             STL::NoAugment, STL::ThreadedBackend>,
+                    K>("STL::threaded_map");
+  RegisterContainer<std::set<K>, K>("std::set");
+  RegisterContainer<STL::set<K>, K>("STL::set");
+  RegisterContainer<std::multiset<K>, K>("std::multiset");
+  RegisterContainer<STL::multiset<K>, K>("STL::multiset");
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  RegisterKey<int64_t>();
+  RegisterKey<std::string>();
+  RegisterKey<Key64>();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
@@ -0,0 +1,127 @@
+// Задержка чтений при всплесках записи: lockfree_map против
+// concurrent_map и map под одним мьютексом. Читатели ищут случайные
+// ключи без пауз, писатели раз в несколько миллисекунд вставляют и
+// удаляют пачку ключей; на одно изменение приходится около 50 чтений.
+// Печатаются перцентили времени одного find. Сборка и запуск:
+// make bench_lockfree.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_map.h"
+#include "../lockfree_map.h"
+
+namespace {
+
+constexpr int kKeys = 1 << 16;
+constexpr int kReaders = 4;
+constexpr int kWriters = 2;
+constexpr int kBurst = 2000;
+constexpr auto kDuration = std::chrono::seconds(2);
+
+using Clock = std::chrono::steady_clock;
+
+class LockedMap {
+ public:
+  bool find(int key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return data_.find(key) != data_.end();
+  }
+  void insert(int key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    data_.insert(key, key);
+  }
+  void erase(int key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = data_.find(key);
+    if (it != data_.end()) data_.erase(it);
+  }
+
+ private:
+  mutable std::shared_mutex mutex_;
+  STL::map<int, long> data_;
+};
+
+class ShardedMap {
+ public:
+  bool find(int key) const { return data_.find(key).has_value(); }
+  void insert(int key) { data_.insert(key, key); }
+  void erase(int key) { data_.erase(key); }
+
+ private:
+  STL::concurrent_map<int, long> data_;
+};
+
+class LockFreeMap {
+ public:
+  bool find(int key) const { return data_.contains(key); }
+  void insert(int key) { data_.insert(key, key); }
+  void erase(int key) { data_.erase(key); }
+
+ private:
+  STL::lockfree_map<int, long> data_;
+};
+
+template <class Map>
+void Latency(const char *name) {
+  Map map;
+  for (int key = 0; key < kKeys; key += 2) map.insert(key);
+  std::atomic<bool> done{false};
+  std::atomic<long> writes{0};
+  std::vector<std::vector<double>> samples(kReaders);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kReaders; ++t) {
+    threads.emplace_back([&map, &done, &samples, t] {
+      std::mt19937 rng(t);
+      long hits = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        int key = int(rng() % kKeys);
+        auto start = Clock::now();
+        hits += map.find(key);
+        auto finish = Clock::now();
+        samples[t].push_back(
+            std::chrono::duration<double, std::nano>(finish - start).count());
+      }
+      if (hits == -1) std::puts("");
+    });
+  }
+  for (int t = 0; t < kWriters; ++t) {
+    threads.emplace_back([&map, &done, &writes, t] {
+      std::mt19937 rng(100 + t);
+      while (!done.load(std::memory_order_relaxed)) {
+        int first = int(rng() % kKeys) | 1;
+        for (int i = 0; i < kBurst; i += 2) map.insert((first + i) % kKeys);
+        for (int i = 0; i < kBurst; i += 2) map.erase((first + i) % kKeys);
+        writes += kBurst;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+    });
+  }
+  std::this_thread::sleep_for(kDuration);
+  done = true;
+  for (auto &thread : threads) thread.join();
+  std::vector<double> all;
+  for (auto &part : samples) all.insert(all.end(), part.begin(), part.end());
+  std::sort(all.begin(), all.end());
+  auto at = [&all](double q) { return all[size_t(q * (all.size() - 1))]; };
+  std::printf("%-15s %9.0f %9.0f %9.0f %10.0f %6.0f\n", name, at(0.5),
+              at(0.99), at(0.999), all.back(),
+              double(all.size()) / double(writes.load()));
+}
+}  // namespace
+
+int main() {
+  std::printf("hardware threads: %u, readers %d, writers %d\n",
+              std::thread::hardware_concurrency(), kReaders, kWriters);
+  std::printf("%-15s %9s %9s %9s %10s %6s\n", "find, ns", "p50", "p99",
+              "p99.9", "max", "r:w");
+  Latency<LockedMap>("locked map");
+  Latency<ShardedMap>("concurrent_map");
+  Latency<LockFreeMap>("lockfree_map");
+}
@@ -0,0 +1,100 @@
+// Сравнение векторных ядер поиска со скалярным путём: сами ядра на
+// окнах размером с узел B-дерева и поиск в B-дереве целиком.
+// Сборка и запуск: make bench_simd.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../btree.h"
+#include "../my_set.h"
+#include "../simd_search.h"
+
+namespace {
+
+// Тот же порядок, что std::less, но векторный поиск для него выключен.
+template <class T>
+struct ScalarLess {
+  bool operator()(const T &lhs, const T &rhs) const { return lhs < rhs; }
+};
+
+template <class Function>
+double Millis(Function function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(finish - start).count();
+}
+
+template <class T>
+std::vector<T> RandomKeys(size_t n, std::mt19937_64 &rng) {
+  std::vector<T> keys(n);
+  for (auto &key : keys) key = static_cast<T>(rng() % (4 * n + 1));
+  return keys;
+}
+
+template <class T>
+void BenchKernels(const char *type, size_t window) {
+  std::mt19937_64 rng(window);
+  std::vector<T> keys = RandomKeys<T>(window, rng);
+  std::sort(keys.begin(), keys.end());
+  std::vector<T> queries = RandomKeys<T>(1 << 12, rng);
+  const int rounds = 20000000 / static_cast<int>(queries.size());
+  size_t sink = 0;
+  double scalar = Millis([&] {
+    for (int r = 0; r < rounds; ++r)
+      for (T key : queries)
+        sink += STL::simd::ScalarCount<false>(keys.data(), window, key);
+  });
+  double vector = Millis([&] {
+    for (int r = 0; r < rounds; ++r)
+      for (T key : queries)
+        sink += STL::simd::LowerIndex(keys.data(), window, key);
+  });
+  std::printf("%-8s window %3zu  scalar %7.1f ms  %-6s %7.1f ms  x%.2f  %zu\n",
+              type, window, scalar, STL::simd::KernelName<T>(), vector,
+              scalar / vector, sink % 10);
+}
+
+template <class Set, class T>
+double BenchLookups(const std::vector<T> &keys, const std::vector<T> &queries) {
+  Set set(keys.begin(), keys.end());
+  size_t hits = 0;
+  double time = Millis([&] {
+    for (T key : queries) hits += set.contains(key);
+  });
+  if (hits == size_t(-1)) std::puts("");
+  return time;
+}
+
+template <class T>
+void BenchContainers(const char *type, size_t n) {
+  std::mt19937_64 rng(n);
+  std::vector<T> keys = RandomKeys<T>(n, rng);
+  std::vector<T> queries = RandomKeys<T>(4000000, rng);
+  using Alloc = std::allocator<T>;
+  using BTree = STL::BTreeBackend<256>;
+  double btree_scalar = BenchLookups<
+      STL::set<T, ScalarLess<T>, Alloc, STL::NoAugment, BTree>>(keys, queries);
+  double btree_vector =
+      BenchLookups<STL::set<T, std::less<T>, Alloc, STL::NoAugment, BTree>>(
+          keys, queries);
+  std::printf("%-8s n %8zu  btree scalar %7.1f ms  vector %7.1f ms  x%.2f\n",
+              type, n, btree_scalar, btree_vector,
+              btree_scalar / btree_vector);
+}
+}  // namespace
+
+int main() {
+  for (size_t window : {16, 32, 64}) {
+    BenchKernels<int64_t>("int64_t", window);
+    BenchKernels<uint32_t>("uint32_t", window);
+    BenchKernels<double>("double", window);
+  }
+  for (size_t n : {1000, 100000, 1000000}) {
+    BenchContainers<int64_t>("int64_t", n);
+    BenchContainers<uint32_t>("uint32_t", n);
+    BenchContainers<double>("double", n);
+  }
+}
@@ -0,0 +1,49 @@
+// Стоимость снимка map и записей после него: обычный map копирует всё
+// дерево, persistent_map делит узлы и копирует путь при записи.
+// Сборка и запуск: make bench_snapshot.
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "../persistent_map.h"
+
+namespace {
+
+constexpr int kKeys = 1 << 20;
+constexpr int kWrites = 100000;
+
+using Clock = std::chrono::steady_clock;
+
+double Micros(Clock::time_point start, Clock::time_point finish) {
+  return std::chrono::duration<double, std::micro>(finish - start).count();
+}
+
+template <class Map>
+void Measure(const char *name) {
+  Map map;
+  for (int key = 0; key < kKeys; ++key) map.insert(key, key);
+  auto start = Clock::now();
+  Map snapshot = map.snapshot();
+  auto taken = Clock::now();
+  std::mt19937 rng(1);
+  for (int i = 0; i < kWrites; ++i)
+    map.insert_or_assign(int(rng() % kKeys), i);
+  auto written = Clock::now();
+  long sum = 0;
+  for (int i = 0; i < kWrites; ++i)
+    sum += snapshot.contains(int(rng() % kKeys));
+  auto read = Clock::now();
+  std::printf("%-15s %12.1f %16.3f %16.3f\n", name, Micros(start, taken),
+              Micros(taken, written) / kWrites,
+              Micros(written, read) / kWrites);
+  if (sum == -1) std::puts("");
+}
+}  // namespace
+
+int main() {
+  std::printf("%d keys, %d writes after the snapshot\n", kKeys, kWrites);
+  std::printf("%-15s %12s %16s %16s\n", "", "snapshot, us", "write, us/op",
+              "snap read, us/op");
+  Measure<STL::map<int, int>>("map");
+  Measure<STL::persistent_map<int, int>>("persistent_map");
+}
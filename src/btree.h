@@ -0,0 +1,783 @@
+#ifndef STLCONTAINERS_BTREE_H
+#define STLCONTAINERS_BTREE_H
+
+#include <new>
+
+#include "drevo.h"
+#include "simd_search.h"
+
+namespace STL {
+
+// B-дерево с тем же интерфейсом, что у Tree. Значения лежат в узлах по
+// нескольку штук, узел занимает около NodeBytes байт (несколько строк
+// кэша), поэтому поиск делает log_B(n) промахов вместо log2(n), а
+// накладные расходы - пара указателей на узел, а не три на элемент.
+// Значения переезжают между узлами при вставке и удалении, так что, в
+// отличие от Tree, любая модификация делает итераторы недействительными.
+template <class T, class KeyOfValue = Identity<T>,
+          class Compare = std::less<TreeKey<T, KeyOfValue>>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment,
+          size_t NodeBytes = 256>
+class BTree {
+  static_assert(std::is_same_v<Augment, NoAugment>,
+                "BTree does not support node augmentation");
+
+  struct Node;
+  using Anchor = IteratorAnchor<BTree, Allocator>;
+  using AnchorCell = typename Anchor::Cell;
+
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const BTree *tree, Node *node, size_t index)
+        : Iterator(tree->anchor_.get(), node, index) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(anchor_, node_, index_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.anchor_, other.node_, other.index_) {}
+
+    // В листе шаг - сдвиг индекса; из внутреннего узла спускаемся в
+    // крайний лист соседнего поддерева, из конца листа поднимаемся.
+    Iterator &operator++() {
+      if (!node_) throw std::out_of_range("Out of range");
+      if (!node_->leaf) {
+        node_ = Child(node_, index_ + 1);
+        while (!node_->leaf) node_ = Child(node_, 0);
+        index_ = 0;
+        return *this;
+      }
+      ++index_;
+      while (index_ == node_->count) {
+        if (!node_->parent) {
+          node_ = nullptr;
+          index_ = 0;
+          break;
+        }
+        index_ = node_->position;
+        node_ = node_->parent;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    // Шаг назад от end() - последний элемент самого правого листа того
+    // дерева, у которого сейчас узлы: якорь переезжает с ними при swap.
+    Iterator &operator--() {
+      if (!node_) {
+        node_ = anchor_ ? anchor_->owner->Rightmost() : nullptr;
+        if (!node_) throw std::out_of_range("Out of range");
+        index_ = node_->count - 1;
+        return *this;
+      }
+      if (!node_->leaf) {
+        node_ = Child(node_, index_);
+        while (!node_->leaf) node_ = Child(node_, node_->count);
+        index_ = node_->count - 1;
+        return *this;
+      }
+      while (index_ == 0) {
+        if (!node_->parent) {
+          node_ = nullptr;
+          return *this;
+        }
+        index_ = node_->position;
+        node_ = node_->parent;
+      }
+      --index_;
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    reference operator*() const {
+      if (!node_) throw std::logic_error("nullptr");
+      return node_->values()[index_];
+    }
+
+    bool operator==(const Iterator &other) const {
+      return node_ == other.node_ && index_ == other.index_;
+    }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+   private:
+    Iterator(const AnchorCell *anchor, Node *node, size_t index) noexcept
+        : anchor_(anchor), node_(node), index_(index) {}
+
+    const AnchorCell *anchor_;
+    Node *node_;
+    size_t index_;
+    friend BTree;
+    friend Iterator<!Const>;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  BTree() : BTree(Compare(), Allocator()) {}
+
+  explicit BTree(const Allocator &alloc) : BTree(Compare(), alloc) {}
+
+  explicit BTree(const Compare &comp, const Allocator &alloc = Allocator())
+      : root_(nullptr), size_(0), comp_(comp), alloc_(alloc) {
+    anchor_.Ensure(this, alloc_);
+  }
+
+  BTree(const BTree &other)
+      : root_(nullptr),
+        size_(0),
+        comp_(other.comp_),
+        alloc_(leaf_traits::select_on_container_copy_construction(
+            other.alloc_)) {
+    anchor_.Ensure(this, alloc_);
+    CopyFrom(other);
+  }
+
+  BTree(BTree &&other) noexcept
+      : root_(other.root_),
+        size_(other.size_),
+        comp_(other.comp_),
+        alloc_(std::move(other.alloc_)) {
+    anchor_.Take(other.anchor_, this);
+    other.root_ = nullptr;
+    other.size_ = 0;
+  }
+
+  BTree &operator=(const BTree &other) {
+    if (this == &other) return *this;
+    clear();
+    if (leaf_traits::propagate_on_container_copy_assignment::value) {
+      anchor_.Free(alloc_);
+      alloc_ = other.alloc_;
+      anchor_.Ensure(this, alloc_);
+    }
+    comp_ = other.comp_;
+    CopyFrom(other);
+    return *this;
+  }
+
+  BTree &operator=(BTree &&other) noexcept(
+      leaf_traits::propagate_on_container_move_assignment::value ||
+      leaf_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    clear();
+    comp_ = other.comp_;
+    if (leaf_traits::propagate_on_container_move_assignment::value) {
+      anchor_.Free(alloc_);
+      alloc_ = std::move(other.alloc_);
+    } else if (!(alloc_ == other.alloc_)) {
+      CopyFrom(other);
+      other.clear();
+      return *this;
+    }
+    anchor_.Free(alloc_);
+    anchor_.Take(other.anchor_, this);
+    root_ = other.root_;
+    size_ = other.size_;
+    other.root_ = nullptr;
+    other.size_ = 0;
+    return *this;
+  }
+
+  ~BTree() {
+    clear();
+    anchor_.Free(alloc_);
+  }
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  iterator InsertEqual(const T &value) { return EmplaceEqual(value); }
+
+  iterator InsertEqual(T &&value) { return EmplaceEqual(std::move(value)); }
+
+  // Подсказка B-дереву не нужна: спуск и так короткий.
+  std::pair<iterator, bool> InsertUnique(iterator, const T &value) {
+    return InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator, T &&value) {
+    return InsertUnique(std::move(value));
+  }
+
+  iterator InsertEqual(iterator, const T &value) { return InsertEqual(value); }
+
+  iterator InsertEqual(iterator, T &&value) {
+    return InsertEqual(std::move(value));
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    iterator pos = UniquePos(key);
+    if (pos.node_ && pos.index_ < pos.node_->count &&
+        !comp_(key, KeyOf(pos.node_, pos.index_)))
+      return std::make_pair(pos, false);
+    return std::make_pair(InsertAt(pos, std::forward<Args>(args)...), true);
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceHintUnique(iterator, const K &key,
+                                                 Args &&...args) {
+    return TryEmplaceUnique(key, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    T value(std::forward<Args>(args)...);
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceHintUnique(iterator, Args &&...args) {
+    return EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator EmplaceEqual(Args &&...args) {
+    T value(std::forward<Args>(args)...);
+    return InsertAt(EqualPos(KeyOfValue()(value)), std::move(value));
+  }
+
+  template <class... Args>
+  iterator EmplaceHintEqual(iterator, Args &&...args) {
+    return EmplaceEqual(std::forward<Args>(args)...);
+  }
+
+  // Семантика как у Tree::AssignSorted: из равных для уникальных ключей
+  // остаётся первый, равные для неуникальных идут в порядке входа.
+  template <class InputIt>
+  void AssignSorted(InputIt first, InputIt last) {
+    clear();
+    for (; first != last; ++first) EmplaceEqual(*first);
+  }
+
+  template <class InputIt>
+  void AssignSortedUnique(InputIt first, InputIt last) {
+    clear();
+    for (; first != last; ++first) EmplaceUnique(*first);
+  }
+
+  // Слияние и операции над множествами поэлементные, O(m log n): без
+  // split/join, которые есть только у Tree.
+  void MergeUnique(BTree &other) { Merge<true>(other); }
+  void MergeEqual(BTree &other) { Merge<false>(other); }
+
+  void UniteUnique(const BTree &other) {
+    if (this == &other) return;
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      InsertUnique(*it);
+  }
+
+  void IntersectUnique(const BTree &other) {
+    if (this == &other) return;
+    Filter([&other](const key_type &key) {
+      return other.FindTreeNode(key) != other.end();
+    });
+  }
+
+  void SubtractUnique(const BTree &other) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    Filter([&other](const key_type &key) {
+      return other.FindTreeNode(key) == other.end();
+    });
+  }
+
+  // Последнее значение из листа встаёт на место удаляемого, затем
+  // недобор в листе покрывается соседом или слиянием с ним.
+  void erase(iterator pos) noexcept {
+    Node *node = pos.node_;
+    size_t index = pos.index_;
+    if (!node->leaf) {
+      Node *leaf = Child(node, index);
+      while (!leaf->leaf) leaf = Child(leaf, leaf->count);
+      Destroy(node->values() + index);
+      MoveValue(node->values() + index, leaf->values() + leaf->count - 1);
+      leaf->count--;
+      node = leaf;
+    } else {
+      Destroy(node->values() + index);
+      for (size_t i = index + 1; i < node->count; ++i)
+        MoveValue(node->values() + i - 1, node->values() + i);
+      node->count--;
+    }
+    size_--;
+    Rebalance(node);
+  }
+
+  void clear() noexcept {
+    if (root_) DestroySubtree(root_);
+    root_ = nullptr;
+    size_ = 0;
+  }
+
+  template <class K>
+  iterator FindTreeNode(const K &key) const {
+    Node *node = root_;
+    while (node) {
+      size_t i = LowerIndex(node, key);
+      if (i < node->count && !comp_(key, KeyOf(node, i)))
+        return iterator(this, node, i);
+      if (node->leaf) break;
+      node = Child(node, i);
+    }
+    return iterator(this, nullptr, 0);
+  }
+
+  template <class K>
+  iterator LowerBound(const K &key) const {
+    iterator result(this, nullptr, 0);
+    Node *node = root_;
+    while (node) {
+      size_t i = LowerIndex(node, key);
+      if (i < node->count) result = iterator(this, node, i);
+      if (node->leaf) break;
+      node = Child(node, i);
+    }
+    return result;
+  }
+
+  template <class K>
+  iterator UpperBound(const K &key) const {
+    iterator result(this, nullptr, 0);
+    Node *node = root_;
+    while (node) {
+      size_t i = UpperIndex(node, key);
+      if (i < node->count) result = iterator(this, node, i);
+      if (node->leaf) break;
+      node = Child(node, i);
+    }
+    return result;
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> EqualRange(const K &key) const {
+    return std::make_pair(LowerBound(key), UpperBound(key));
+  }
+
+  // Дополнений у B-дерева нет, пересчитывать нечего.
+  void Refresh(iterator) noexcept {}
+
+  iterator begin() noexcept { return iterator(this, Leftmost(), 0); }
+
+  iterator end() noexcept { return iterator(this, nullptr, 0); }
+
+  const_iterator begin() const noexcept {
+    return const_iterator(this, Leftmost(), 0);
+  }
+
+  const_iterator end() const noexcept {
+    return const_iterator(this, nullptr, 0);
+  }
+
+  size_t size() const noexcept { return size_; }
+
+  key_compare key_comp() const { return comp_; }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+ private:
+  static constexpr size_t kHeaderBytes = sizeof(void *) + 4;
+  static constexpr size_t kFit =
+      NodeBytes > kHeaderBytes ? (NodeBytes - kHeaderBytes) / sizeof(T) : 0;
+  static constexpr size_t kMaxValues = kFit < 3 ? 3 : kFit > 255 ? 255 : kFit;
+  // После разделения полного узла в правой половине остаётся столько.
+  static constexpr size_t kMinValues = (kMaxValues - 1) / 2;
+
+  struct Node {
+    Node *parent;
+    unsigned char position;  // номер среди детей parent
+    unsigned char count;     // число значений
+    bool leaf;
+    alignas(T) unsigned char storage[kMaxValues * sizeof(T)];
+
+    T *values() noexcept {
+      return std::launder(reinterpret_cast<T *>(storage));
+    }
+  };
+
+  struct InternalNode : Node {
+    Node *children[kMaxValues + 1];
+  };
+
+  using leaf_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using leaf_traits = std::allocator_traits<leaf_allocator>;
+  using internal_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<InternalNode>;
+  using internal_traits = std::allocator_traits<internal_allocator>;
+
+  static Node *Child(Node *node, size_t i) noexcept {
+    return static_cast<InternalNode *>(node)->children[i];
+  }
+
+  static void SetChild(Node *node, size_t i, Node *child) noexcept {
+    static_cast<InternalNode *>(node)->children[i] = child;
+    child->parent = node;
+    child->position = static_cast<unsigned char>(i);
+  }
+
+  static const key_type &KeyOf(Node *node, size_t i) noexcept {
+    return KeyOfValue()(node->values()[i]);
+  }
+
+  Node *Leftmost() const noexcept {
+    Node *node = root_;
+    if (node)
+      while (!node->leaf) node = Child(node, 0);
+    return node;
+  }
+
+  Node *Rightmost() const noexcept {
+    Node *node = root_;
+    if (node)
+      while (!node->leaf) node = Child(node, node->count);
+    return node;
+  }
+
+  // Первый индекс в узле, чей ключ не меньше key. Узлы маленькие, так
+  // что хватает линейного прохода без ветвления на середину; ключи
+  // арифметических типов сравниваются векторным ядром по несколько за
+  // команду.
+  template <class K>
+  size_t LowerIndex(Node *node, const K &key) const {
+    if constexpr (simd::kSearchable<T, KeyOfValue, Compare, K>)
+      return simd::LowerIndex(node->values(), node->count, key);
+    size_t i = 0;
+    while (i < node->count && comp_(KeyOf(node, i), key)) ++i;
+    return i;
+  }
+
+  template <class K>
+  size_t UpperIndex(Node *node, const K &key) const {
+    if constexpr (simd::kSearchable<T, KeyOfValue, Compare, K>)
+      return simd::UpperIndex(node->values(), node->count, key);
+    size_t i = 0;
+    while (i < node->count && !comp_(key, KeyOf(node, i))) ++i;
+    return i;
+  }
+
+  // Для уникальной вставки: равный ключ (в любом узле) или место в листе.
+  template <class K>
+  iterator UniquePos(const K &key) const {
+    Node *node = root_;
+    while (node) {
+      size_t i = LowerIndex(node, key);
+      if ((i < node->count && !comp_(key, KeyOf(node, i))) || node->leaf)
+        return iterator(this, node, i);
+      node = Child(node, i);
+    }
+    return iterator(this, nullptr, 0);
+  }
+
+  iterator EqualPos(const key_type &key) const {
+    Node *node = root_;
+    while (node) {
+      size_t i = UpperIndex(node, key);
+      if (node->leaf) return iterator(this, node, i);
+      node = Child(node, i);
+    }
+    return iterator(this, nullptr, 0);
+  }
+
+  Node *NewNode(bool leaf) {
+    anchor_.Ensure(this, alloc_);
+    Node *node;
+    if (leaf) {
+      node = leaf_traits::allocate(alloc_, 1);
+    } else {
+      internal_allocator alloc(alloc_);
+      InternalNode *internal = internal_traits::allocate(alloc, 1);
+      std::fill(internal->children, internal->children + kMaxValues + 1,
+                nullptr);
+      node = internal;
+    }
+    node->parent = nullptr;
+    node->position = 0;
+    node->count = 0;
+    node->leaf = leaf;
+    return node;
+  }
+
+  void FreeNode(Node *node) noexcept {
+    if (node->leaf) {
+      leaf_traits::deallocate(alloc_, node, 1);
+    } else {
+      internal_allocator alloc(alloc_);
+      internal_traits::deallocate(alloc, static_cast<InternalNode *>(node), 1);
+    }
+  }
+
+  template <class... Args>
+  void Construct(T *slot, Args &&...args) {
+    leaf_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+  }
+
+  void Destroy(T *slot) noexcept { leaf_traits::destroy(alloc_, slot); }
+
+  void MoveValue(T *to, T *from) noexcept {
+    Construct(to, std::move(*from));
+    Destroy(from);
+  }
+
+  void DestroySubtree(Node *node) noexcept {
+    for (size_t i = 0; i < node->count; ++i) Destroy(node->values() + i);
+    if (!node->leaf) {
+      for (size_t i = 0; i <= node->count; ++i)
+        if (Node *child = Child(node, i)) DestroySubtree(child);
+    }
+    FreeNode(node);
+  }
+
+  void CopyFrom(const BTree &other) {
+    if (!other.root_) return;
+    root_ = CloneSubtree(other.root_);
+    size_ = other.size_;
+  }
+
+  // При исключении частично построенная копия освобождается целиком:
+  // count растёт по мере копирования, недостроенные дети - nullptr.
+  Node *CloneSubtree(Node *source) {
+    Node *copy = NewNode(source->leaf);
+    try {
+      for (size_t i = 0; i < source->count; ++i) {
+        Construct(copy->values() + i, source->values()[i]);
+        copy->count++;
+      }
+      if (!source->leaf) {
+        for (size_t i = 0; i <= source->count; ++i)
+          SetChild(copy, i, CloneSubtree(Child(source, i)));
+      }
+    } catch (...) {
+      DestroySubtree(copy);
+      throw;
+    }
+    return copy;
+  }
+
+  // Вставка в лист pos. Полный лист сначала делится; разделение может
+  // подняться до корня.
+  template <class... Args>
+  iterator InsertAt(iterator pos, Args &&...args) {
+    Node *leaf = pos.node_;
+    size_t index = pos.index_;
+    if (!leaf) {
+      root_ = leaf = NewNode(true);
+      index = 0;
+    } else if (leaf->count == kMaxValues) {
+      Node *sibling = Split(leaf);
+      if (index > leaf->count) {
+        index -= leaf->count + 1;
+        leaf = sibling;
+      }
+    }
+    for (size_t i = leaf->count; i > index; --i)
+      MoveValue(leaf->values() + i, leaf->values() + i - 1);
+    try {
+      Construct(leaf->values() + index, std::forward<Args>(args)...);
+    } catch (...) {
+      for (size_t i = index; i < leaf->count; ++i)
+        MoveValue(leaf->values() + i, leaf->values() + i + 1);
+      Rebalance(leaf);
+      throw;
+    }
+    leaf->count++;
+    size_++;
+    return iterator(this, leaf, index);
+  }
+
+  // Делит полный узел: верхняя половина уходит в нового правого соседа,
+  // средний элемент поднимается в родителя (тот при нужде делится первым).
+  Node *Split(Node *node) {
+    if (node->parent && node->parent->count == kMaxValues) Split(node->parent);
+    Node *sibling = NewNode(node->leaf);
+    if (!node->parent) {
+      Node *root;
+      try {
+        root = NewNode(false);
+      } catch (...) {
+        FreeNode(sibling);
+        throw;
+      }
+      SetChild(root, 0, node);
+      root_ = root;
+    }
+    const size_t mid = kMaxValues / 2;
+    for (size_t i = mid + 1; i < node->count; ++i)
+      MoveValue(sibling->values() + i - mid - 1, node->values() + i);
+    sibling->count = static_cast<unsigned char>(node->count - mid - 1);
+    if (!node->leaf) {
+      for (size_t i = mid + 1; i <= node->count; ++i)
+        SetChild(sibling, i - mid - 1, Child(node, i));
+    }
+    Node *parent = node->parent;
+    size_t at = node->position;
+    for (size_t i = parent->count; i > at; --i) {
+      MoveValue(parent->values() + i, parent->values() + i - 1);
+      SetChild(parent, i + 1, Child(parent, i));
+    }
+    MoveValue(parent->values() + at, node->values() + mid);
+    SetChild(parent, at + 1, sibling);
+    parent->count++;
+    node->count = mid;
+    return sibling;
+  }
+
+  // Восстанавливает минимум значений в узле, поднимаясь к корню.
+  void Rebalance(Node *node) noexcept {
+    while (node != root_ && node->count < kMinValues) {
+      Node *parent = node->parent;
+      size_t at = node->position;
+      Node *left = at > 0 ? Child(parent, at - 1) : nullptr;
+      Node *right = at < parent->count ? Child(parent, at + 1) : nullptr;
+      if (left && left->count > kMinValues) {
+        RotateRight(parent, at - 1);
+        return;
+      }
+      if (right && right->count > kMinValues) {
+        RotateLeft(parent, at);
+        return;
+      }
+      MergeChildren(parent, left ? at - 1 : at);
+      node = parent;
+    }
+    if (root_->count == 0) {
+      Node *old_root = root_;
+      root_ = root_->leaf ? nullptr : Child(root_, 0);
+      if (root_) root_->parent = nullptr;
+      FreeNode(old_root);
+    }
+  }
+
+  // Последнее значение левого ребёнка уходит в родителя, разделитель
+  // родителя - в начало правого.
+  void RotateRight(Node *parent, size_t at) noexcept {
+    Node *left = Child(parent, at);
+    Node *right = Child(parent, at + 1);
+    for (size_t i = right->count; i > 0; --i)
+      MoveValue(right->values() + i, right->values() + i - 1);
+    MoveValue(right->values(), parent->values() + at);
+    MoveValue(parent->values() + at, left->values() + left->count - 1);
+    if (!right->leaf) {
+      for (size_t i = right->count + 1; i > 0; --i)
+        SetChild(right, i, Child(right, i - 1));
+      SetChild(right, 0, Child(left, left->count));
+    }
+    left->count--;
+    right->count++;
+  }
+
+  void RotateLeft(Node *parent, size_t at) noexcept {
+    Node *left = Child(parent, at);
+    Node *right = Child(parent, at + 1);
+    MoveValue(left->values() + left->count, parent->values() + at);
+    MoveValue(parent->values() + at, right->values());
+    for (size_t i = 1; i < right->count; ++i)
+      MoveValue(right->values() + i - 1, right->values() + i);
+    if (!right->leaf) {
+      SetChild(left, left->count + 1, Child(right, 0));
+      for (size_t i = 1; i <= right->count; ++i)
+        SetChild(right, i - 1, Child(right, i));
+    }
+    left->count++;
+    right->count--;
+  }
+
+  // Правый ребёнок вместе с разделителем переезжает в левого.
+  void MergeChildren(Node *parent, size_t at) noexcept {
+    Node *left = Child(parent, at);
+    Node *right = Child(parent, at + 1);
+    MoveValue(left->values() + left->count, parent->values() + at);
+    for (size_t i = 0; i < right->count; ++i)
+      MoveValue(left->values() + left->count + 1 + i, right->values() + i);
+    if (!left->leaf) {
+      for (size_t i = 0; i <= right->count; ++i)
+        SetChild(left, left->count + 1 + i, Child(right, i));
+    }
+    left->count += right->count + 1;
+    for (size_t i = at + 1; i < parent->count; ++i) {
+      MoveValue(parent->values() + i - 1, parent->values() + i);
+      SetChild(parent, i, Child(parent, i + 1));
+    }
+    parent->count--;
+    right->count = 0;
+    FreeNode(right);
+  }
+
+  template <bool Unique>
+  void Merge(BTree &other) {
+    if (this == &other) return;
+    BTree rest(comp_, other.get_allocator());
+    for (iterator it = other.begin(); it != other.end(); ++it) {
+      if (!Unique)
+        InsertEqual(std::move(*it));
+      else if (!InsertUnique(std::move(*it)).second)
+        rest.EmplaceEqual(std::move(*it));
+    }
+    other = std::move(rest);
+  }
+
+  // Оставляет только значения, ключ которых удовлетворяет keep.
+  template <class Predicate>
+  void Filter(Predicate keep) {
+    BTree kept(comp_, get_allocator());
+    for (iterator it = begin(); it != end(); ++it)
+      if (keep(KeyOfValue()(*it))) kept.EmplaceEqual(std::move(*it));
+    *this = std::move(kept);
+  }
+
+  Node *root_;
+  size_t size_;
+  Compare comp_;
+  leaf_allocator alloc_;
+  Anchor anchor_;
+};
+
+// Бэкенд на B-дереве для map, set и multiset: STL::set<int,
+// std::less<int>, std::allocator<int>, NoAugment, BTreeBackend<>>.
+// Гарантии контейнеров с ним слабее, чем с AvlBackend:
+// - любая вставка или удаление делает недействительными все итераторы,
+//   указатели и ссылки на элементы, поэтому erase(it++) в цикле нельзя -
+//   только it = find(...) заново;
+// - подсказка в insert(hint, ...) и emplace_hint не используется;
+// - merge, unite и сборка из диапазона идут поэлементно, за O(n log n).
+template <size_t NodeBytes = 256>
+struct BTreeBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = BTree<T, KeyOfValue, Compare, Allocator, Augment, NodeBytes>;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_BTREE_H
@@ -0,0 +1,835 @@
+#ifndef STLCONTAINERS_COMPACT_TREE_H
+#define STLCONTAINERS_COMPACT_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "drevo.h"
+
+namespace STL {
+
+// AVL-дерево с компактными узлами: вместо трёх 64-битных указателей -
+// 32-битные номера узлов в арене, высота - один байт. На узел уходит
+// 13 байт служебных данных против 28 у Tree (24 против 32-40 вместе с
+// 8-байтным ключом и выравниванием). Арена растёт кусками по
+// kChunkSize узлов и никогда не переезжает, поэтому ссылки и итераторы
+// стабильны так же, как у Tree. Алгоритмы те же, что у Tree.
+template <class T, class KeyOfValue = Identity<T>,
+          class Compare = std::less<TreeKey<T, KeyOfValue>>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment>
+class CompactTree {
+  static_assert(std::is_same_v<Augment, NoAugment>,
+                "CompactTree does not support node augmentation");
+
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using index_type = std::uint32_t;
+
+ private:
+  using Anchor = IteratorAnchor<CompactTree, Allocator>;
+  using AnchorCell = typename Anchor::Cell;
+
+ public:
+
+  // Номер 0 зарезервирован под "нет узла", живые узлы начинаются с 1.
+  static constexpr index_type kNull = 0;
+
+  struct Node {
+    T key;
+    index_type parent;
+    index_type left;
+    index_type right;
+    unsigned char height;
+  };
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const CompactTree *tree, index_type index)
+        : Iterator(tree->anchor_.get(), index) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(anchor_, index_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.anchor_, other.index_) {}
+
+    // Номер узла сам по себе ничего не значит: арену ищем через якорь,
+    // который после swap и перемещения указывает на нового владельца.
+    Iterator &operator++() {
+      if (!index_) throw std::out_of_range("Out of range");
+      index_ = anchor_->owner->Next(index_);
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    Iterator &operator--() {
+      const CompactTree *tree = anchor_ ? anchor_->owner : nullptr;
+      index_ = index_ ? tree->Prev(index_) : tree ? tree->Rightmost() : kNull;
+      if (!index_) throw std::out_of_range("Out of range");
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    reference operator*() const {
+      if (!index_) throw std::logic_error("nullptr");
+      return anchor_->owner->At(index_).key;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    Iterator(const AnchorCell *anchor, index_type index) noexcept
+        : anchor_(anchor), index_(index) {}
+
+    const AnchorCell *anchor_;
+    index_type index_;
+    friend CompactTree;
+    friend Iterator<!Const>;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  CompactTree() : CompactTree(Compare(), Allocator()) {}
+
+  explicit CompactTree(const Allocator &alloc)
+      : CompactTree(Compare(), alloc) {}
+
+  explicit CompactTree(const Compare &comp,
+                       const Allocator &alloc = Allocator())
+      : comp_(comp), alloc_(alloc), chunks_(chunk_allocator(alloc_)) {
+    anchor_.Ensure(this, alloc_);
+  }
+
+  CompactTree(const CompactTree &other)
+      : comp_(other.comp_),
+        alloc_(node_traits::select_on_container_copy_construction(
+            other.alloc_)),
+        chunks_(chunk_allocator(alloc_)) {
+    anchor_.Ensure(this, alloc_);
+    CopyFrom(other);
+  }
+
+  CompactTree(CompactTree &&other) noexcept
+      : comp_(other.comp_),
+        alloc_(std::move(other.alloc_)),
+        chunks_(std::move(other.chunks_)) {
+    anchor_.Take(other.anchor_, this);
+    StealState(other);
+  }
+
+  CompactTree &operator=(const CompactTree &other) {
+    if (this == &other) return *this;
+    clear();
+    if (node_traits::propagate_on_container_copy_assignment::value &&
+        !(alloc_ == other.alloc_)) {
+      ReleaseChunks();
+      anchor_.Free(alloc_);
+      alloc_ = other.alloc_;
+      anchor_.Ensure(this, alloc_);
+    }
+    comp_ = other.comp_;
+    CopyFrom(other);
+    return *this;
+  }
+
+  CompactTree &operator=(CompactTree &&other) noexcept(
+      node_traits::propagate_on_container_move_assignment::value ||
+      node_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    clear();
+    comp_ = other.comp_;
+    if (!node_traits::propagate_on_container_move_assignment::value &&
+        !(alloc_ == other.alloc_)) {
+      CopyFrom(other);
+      other.clear();
+      return *this;
+    }
+    ReleaseChunks();
+    anchor_.Free(alloc_);
+    if (node_traits::propagate_on_container_move_assignment::value)
+      alloc_ = std::move(other.alloc_);
+    chunks_ = std::move(other.chunks_);
+    anchor_.Take(other.anchor_, this);
+    StealState(other);
+    return *this;
+  }
+
+  ~CompactTree() {
+    clear();
+    ReleaseChunks();
+    anchor_.Free(alloc_);
+  }
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  iterator InsertEqual(const T &value) { return EmplaceEqual(value); }
+
+  iterator InsertEqual(T &&value) { return EmplaceEqual(std::move(value)); }
+
+  std::pair<iterator, bool> InsertUnique(iterator, const T &value) {
+    return InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator, T &&value) {
+    return InsertUnique(std::move(value));
+  }
+
+  iterator InsertEqual(iterator, const T &value) { return InsertEqual(value); }
+
+  iterator InsertEqual(iterator, T &&value) {
+    return InsertEqual(std::move(value));
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    InsertPos pos = UniquePos(key);
+    if (pos.existing)
+      return std::make_pair(iterator(this, pos.existing), false);
+    index_type created = CreateNode(std::forward<Args>(args)...);
+    LinkNode(pos.parent, pos.to_left, created);
+    return std::make_pair(iterator(this, created), true);
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceHintUnique(iterator, const K &key,
+                                                 Args &&...args) {
+    return TryEmplaceUnique(key, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    index_type created = CreateNode(std::forward<Args>(args)...);
+    InsertPos pos = UniquePos(KeyOf(created));
+    if (pos.existing) {
+      DestroyNode(created);
+      return std::make_pair(iterator(this, pos.existing), false);
+    }
+    LinkNode(pos.parent, pos.to_left, created);
+    return std::make_pair(iterator(this, created), true);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceHintUnique(iterator, Args &&...args) {
+    return EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator EmplaceEqual(Args &&...args) {
+    index_type created = CreateNode(std::forward<Args>(args)...);
+    index_type parent = kNull;
+    bool to_left = false;
+    for (index_type node = root_; node;) {
+      parent = node;
+      to_left = comp_(KeyOf(created), KeyOf(node));
+      node = to_left ? At(node).left : At(node).right;
+    }
+    LinkNode(parent, to_left, created);
+    return iterator(this, created);
+  }
+
+  template <class... Args>
+  iterator EmplaceHintEqual(iterator, Args &&...args) {
+    return EmplaceEqual(std::forward<Args>(args)...);
+  }
+
+  // Как у Tree: отсортированный диапазон собирается за O(n), остальные
+  // сначала сортируются.
+  template <class InputIt>
+  void AssignSorted(InputIt first, InputIt last) {
+    Assign<false>(first, last);
+  }
+
+  template <class InputIt>
+  void AssignSortedUnique(InputIt first, InputIt last) {
+    Assign<true>(first, last);
+  }
+
+  // Узлы живут в арене своего дерева, поэтому слияние поэлементное.
+  void MergeUnique(CompactTree &other) { Merge<true>(other); }
+  void MergeEqual(CompactTree &other) { Merge<false>(other); }
+
+  void UniteUnique(const CompactTree &other) {
+    if (this == &other) return;
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      InsertUnique(*it);
+  }
+
+  void IntersectUnique(const CompactTree &other) {
+    if (this == &other) return;
+    Filter([&other](const key_type &key) {
+      return other.FindTreeNode(key) != other.end();
+    });
+  }
+
+  void SubtractUnique(const CompactTree &other) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    Filter([&other](const key_type &key) {
+      return other.FindTreeNode(key) == other.end();
+    });
+  }
+
+  iterator erase(iterator pos) noexcept {
+    iterator next = pos;
+    ++next;
+    remove(pos.index_);
+    return next;
+  }
+
+  // Куски арены остаются за деревом и заполняются заново.
+  void clear() noexcept {
+    DestroyValues(root_);
+    root_ = kNull;
+    size_ = 0;
+    free_ = kNull;
+    used_ = chunks_.empty() ? 0 : 1;
+  }
+
+  template <class K>
+  iterator FindTreeNode(const K &key) const {
+    index_type node = root_;
+    while (node) {
+      if (comp_(key, KeyOf(node)))
+        node = At(node).left;
+      else if (comp_(KeyOf(node), key))
+        node = At(node).right;
+      else
+        break;
+    }
+    return iterator(this, node);
+  }
+
+  template <class K>
+  iterator LowerBound(const K &key) const {
+    index_type result = kNull;
+    for (index_type node = root_; node;) {
+      if (comp_(KeyOf(node), key)) {
+        node = At(node).right;
+      } else {
+        result = node;
+        node = At(node).left;
+      }
+    }
+    return iterator(this, result);
+  }
+
+  template <class K>
+  iterator UpperBound(const K &key) const {
+    index_type result = kNull;
+    for (index_type node = root_; node;) {
+      if (comp_(key, KeyOf(node))) {
+        result = node;
+        node = At(node).left;
+      } else {
+        node = At(node).right;
+      }
+    }
+    return iterator(this, result);
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> EqualRange(const K &key) const {
+    return std::make_pair(LowerBound(key), UpperBound(key));
+  }
+
+  void Refresh(iterator) noexcept {}
+
+  iterator begin() noexcept { return iterator(this, Leftmost()); }
+
+  iterator end() noexcept { return iterator(this, kNull); }
+
+  const_iterator begin() const noexcept {
+    return const_iterator(this, Leftmost());
+  }
+
+  const_iterator end() const noexcept { return const_iterator(this, kNull); }
+
+  size_t size() const noexcept { return size_; }
+
+  key_compare key_comp() const { return comp_; }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+ private:
+  static constexpr unsigned kChunkBits = 10;
+  static constexpr index_type kChunkSize = index_type(1) << kChunkBits;
+
+  using node_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+  using chunk_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node *>;
+
+  Node &At(index_type index) const noexcept {
+    return chunks_[index >> kChunkBits][index & (kChunkSize - 1)];
+  }
+
+  const key_type &KeyOf(index_type index) const noexcept {
+    return KeyOfValue()(At(index).key);
+  }
+
+  // Свободные узлы связаны в список через left; новые берутся с конца
+  // занятой части арены.
+  index_type AllocateIndex() {
+    if (free_) {
+      index_type index = free_;
+      free_ = At(index).left;
+      return index;
+    }
+    if (used_ == chunks_.size() * kChunkSize) {
+      if (chunks_.size() == (size_t(1) << (32 - kChunkBits)))
+        throw std::length_error("CompactTree is full");
+      AddChunk();
+      if (used_ == 0) used_ = 1;
+    }
+    return static_cast<index_type>(used_++);
+  }
+
+  // Вектор кусков растёт геометрически; кусок, который не удалось в него
+  // положить, возвращается аллокатору.
+  void AddChunk() {
+    anchor_.Ensure(this, alloc_);
+    Node *chunk = node_traits::allocate(alloc_, kChunkSize);
+    try {
+      chunks_.push_back(chunk);
+    } catch (...) {
+      node_traits::deallocate(alloc_, chunk, kChunkSize);
+      throw;
+    }
+  }
+
+  template <class... Args>
+  index_type CreateNode(Args &&...args) {
+    index_type index = AllocateIndex();
+    Node &node = At(index);
+    try {
+      node_traits::construct(alloc_, std::addressof(node.key),
+                             std::forward<Args>(args)...);
+    } catch (...) {
+      node.left = free_;
+      free_ = index;
+      throw;
+    }
+    node.parent = node.left = node.right = kNull;
+    node.height = 1;
+    return index;
+  }
+
+  void DestroyNode(index_type index) noexcept {
+    Node &node = At(index);
+    node_traits::destroy(alloc_, std::addressof(node.key));
+    node.left = free_;
+    free_ = index;
+  }
+
+  void ReleaseChunks() noexcept {
+    for (Node *chunk : chunks_)
+      node_traits::deallocate(alloc_, chunk, kChunkSize);
+    chunks_.clear();
+    used_ = 0;
+    free_ = kNull;
+  }
+
+  void StealState(CompactTree &other) noexcept {
+    root_ = other.root_;
+    size_ = other.size_;
+    used_ = other.used_;
+    free_ = other.free_;
+    other.chunks_.clear();
+    other.root_ = other.free_ = kNull;
+    other.size_ = other.used_ = 0;
+  }
+
+  // Номера не зависят от адреса арены, поэтому копия повторяет
+  // раскладку other: те же номера, те же связи, тот же список свободных.
+  void CopyFrom(const CompactTree &other) {
+    chunks_.reserve(other.chunks_.size());
+    while (chunks_.size() < other.chunks_.size()) AddChunk();
+    for (index_type i = 1; i < other.used_; ++i) {
+      Node &node = At(i);
+      const Node &source = other.At(i);
+      node.parent = source.parent;
+      node.left = source.left;
+      node.right = source.right;
+      node.height = source.height;
+    }
+    used_ = other.used_;
+    free_ = other.free_;
+    size_t copied = 0;
+    try {
+      for (const_iterator it = other.begin(); it != other.end(); ++it) {
+        node_traits::construct(alloc_, std::addressof(At(it.index_).key), *it);
+        ++copied;
+      }
+    } catch (...) {
+      for (const_iterator it = other.begin(); copied--; ++it)
+        node_traits::destroy(alloc_, std::addressof(At(it.index_).key));
+      used_ = 1;
+      free_ = kNull;
+      throw;
+    }
+    root_ = other.root_;
+    size_ = other.size_;
+  }
+
+  // Разрушает значения поддерева обходом с поворотами, без стека; номера
+  // узлов не возвращаются в список свободных.
+  void DestroyValues(index_type node) noexcept {
+    while (node) {
+      Node &current = At(node);
+      if (index_type left = current.left) {
+        current.left = At(left).right;
+        At(left).right = node;
+        node = left;
+      } else {
+        index_type right = current.right;
+        node_traits::destroy(alloc_, std::addressof(current.key));
+        node = right;
+      }
+    }
+  }
+
+  template <bool Unique, class InputIt>
+  void Assign(InputIt first, InputIt last) {
+    using traits = std::iterator_traits<InputIt>;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                    typename traits::iterator_category> &&
+                  std::is_same_v<std::decay_t<typename traits::reference>,
+                                 T>) {
+      if (IsOrdered<Unique>(first, last)) {
+        BuildFrom(first, std::distance(first, last));
+        return;
+      }
+    }
+    std::vector<T> values(first, last);
+    if (!IsOrdered<Unique>(values.begin(), values.end())) {
+      auto less = [this](const T &a, const T &b) {
+        return comp_(KeyOfValue()(a), KeyOfValue()(b));
+      };
+      std::stable_sort(values.begin(), values.end(), less);
+      if (Unique) {
+        auto same = [&less](const T &a, const T &b) { return !less(a, b); };
+        values.erase(std::unique(values.begin(), values.end(), same),
+                     values.end());
+      }
+    }
+    BuildFrom(std::make_move_iterator(values.begin()), values.size());
+  }
+
+  template <bool Unique, class ForwardIt>
+  bool IsOrdered(ForwardIt first, ForwardIt last) const {
+    if (first == last) return true;
+    for (ForwardIt next = std::next(first); next != last; first = next++) {
+      const key_type &prev_key = KeyOfValue()(*first);
+      const key_type &key = KeyOfValue()(*next);
+      if (Unique ? !comp_(prev_key, key) : comp_(key, prev_key)) return false;
+    }
+    return true;
+  }
+
+  // Дерево собирается с пустой арены, узлы занимают её подряд. При
+  // исключении арена снова пуста.
+  template <class It>
+  void BuildFrom(It it, size_t count) {
+    clear();
+    try {
+      root_ = BuildSubtree(it, count);
+    } catch (...) {
+      free_ = kNull;
+      used_ = chunks_.empty() ? 0 : 1;
+      throw;
+    }
+    if (root_) At(root_).parent = kNull;
+    size_ = count;
+  }
+
+  // Половины отличаются по размеру не больше чем на единицу, поэтому
+  // дерево сбалансировано. Глубина рекурсии - log2(count).
+  template <class It>
+  index_type BuildSubtree(It &it, size_t count) {
+    if (!count) return kNull;
+    index_type left = BuildSubtree(it, count / 2);
+    index_type node;
+    try {
+      node = CreateNode(*it);
+    } catch (...) {
+      DestroyValues(left);
+      throw;
+    }
+    ++it;
+    At(node).left = left;
+    if (left) At(left).parent = node;
+    index_type right;
+    try {
+      right = BuildSubtree(it, count - count / 2 - 1);
+    } catch (...) {
+      DestroyValues(node);
+      throw;
+    }
+    At(node).right = right;
+    if (right) At(right).parent = node;
+    fixheight(node);
+    return node;
+  }
+
+  template <bool Unique>
+  void Merge(CompactTree &other) {
+    if (this == &other) return;
+    CompactTree rest(comp_, other.get_allocator());
+    for (iterator it = other.begin(); it != other.end(); ++it) {
+      if (!Unique)
+        InsertEqual(std::move(*it));
+      else if (!InsertUnique(std::move(*it)).second)
+        rest.EmplaceEqual(std::move(*it));
+    }
+    other = std::move(rest);
+  }
+
+  template <class Predicate>
+  void Filter(Predicate keep) {
+    for (iterator it = begin(); it != end();) {
+      if (keep(KeyOfValue()(*it)))
+        ++it;
+      else
+        it = erase(it);
+    }
+  }
+
+  index_type Leftmost() const noexcept {
+    index_type node = root_;
+    if (node)
+      while (At(node).left) node = At(node).left;
+    return node;
+  }
+
+  index_type Rightmost() const noexcept {
+    index_type node = root_;
+    if (node)
+      while (At(node).right) node = At(node).right;
+    return node;
+  }
+
+  index_type Next(index_type node) const noexcept {
+    if (index_type right = At(node).right) {
+      while (At(right).left) right = At(right).left;
+      return right;
+    }
+    index_type parent = At(node).parent;
+    while (parent && At(parent).right == node) {
+      node = parent;
+      parent = At(node).parent;
+    }
+    return parent;
+  }
+
+  index_type Prev(index_type node) const noexcept {
+    if (index_type left = At(node).left) {
+      while (At(left).right) left = At(left).right;
+      return left;
+    }
+    index_type parent = At(node).parent;
+    while (parent && At(parent).left == node) {
+      node = parent;
+      parent = At(node).parent;
+    }
+    return parent;
+  }
+
+  struct InsertPos {
+    index_type parent;
+    bool to_left;
+    index_type existing;
+  };
+
+  template <class K>
+  InsertPos UniquePos(const K &key) const {
+    InsertPos pos{kNull, false, kNull};
+    for (index_type node = root_; node;) {
+      pos.parent = node;
+      if (comp_(key, KeyOf(node))) {
+        pos.to_left = true;
+        node = At(node).left;
+      } else if (comp_(KeyOf(node), key)) {
+        pos.to_left = false;
+        node = At(node).right;
+      } else {
+        pos.existing = node;
+        break;
+      }
+    }
+    return pos;
+  }
+
+  void LinkNode(index_type parent, bool to_left, index_type node) noexcept {
+    At(node).parent = parent;
+    if (!parent)
+      root_ = node;
+    else if (to_left)
+      At(parent).left = node;
+    else
+      At(parent).right = node;
+    size_++;
+    RebalanceUp(parent);
+  }
+
+  void RebalanceUp(index_type node) noexcept {
+    while (node) {
+      unsigned old_height = At(node).height;
+      index_type parent = At(node).parent;
+      index_type subtree = balance(node);
+      ReplaceChild(parent, node, subtree);
+      if (At(subtree).height == old_height) break;
+      node = parent;
+    }
+  }
+
+  void ReplaceChild(index_type parent, index_type old_child,
+                    index_type new_child) noexcept {
+    if (!parent)
+      root_ = new_child;
+    else if (At(parent).left == old_child)
+      At(parent).left = new_child;
+    else
+      At(parent).right = new_child;
+  }
+
+  void remove(index_type node) noexcept {
+    Node &removed = At(node);
+    index_type rebalance_from = removed.parent;
+    if (!removed.left || !removed.right) {
+      index_type child = removed.left ? removed.left : removed.right;
+      if (child) At(child).parent = removed.parent;
+      ReplaceChild(removed.parent, node, child);
+    } else {
+      index_type min = removed.right;
+      while (At(min).left) min = At(min).left;
+      Node &successor = At(min);
+      if (successor.parent == node) {
+        rebalance_from = min;
+      } else {
+        rebalance_from = successor.parent;
+        At(successor.parent).left = successor.right;
+        if (successor.right) At(successor.right).parent = successor.parent;
+        successor.right = removed.right;
+        At(successor.right).parent = min;
+      }
+      successor.left = removed.left;
+      At(successor.left).parent = min;
+      successor.parent = removed.parent;
+      successor.height = removed.height;
+      ReplaceChild(removed.parent, node, min);
+    }
+    RebalanceUp(rebalance_from);
+    DestroyNode(node);
+    size_--;
+  }
+
+  index_type rotateright(index_type root) noexcept {
+    index_type tmp = At(root).left;
+    At(root).left = At(tmp).right;
+    At(tmp).parent = At(root).parent;
+    if (At(tmp).right) At(At(tmp).right).parent = root;
+    At(tmp).right = root;
+    At(root).parent = tmp;
+    fixheight(root);
+    fixheight(tmp);
+    return tmp;
+  }
+
+  index_type rotateleft(index_type root) noexcept {
+    index_type tmp = At(root).right;
+    At(root).right = At(tmp).left;
+    At(tmp).parent = At(root).parent;
+    if (At(tmp).left) At(At(tmp).left).parent = root;
+    At(tmp).left = root;
+    At(root).parent = tmp;
+    fixheight(root);
+    fixheight(tmp);
+    return tmp;
+  }
+
+  index_type balance(index_type root) noexcept {
+    fixheight(root);
+    if (bfactor(root) > 1) {
+      if (bfactor(At(root).right) < 0)
+        At(root).right = rotateright(At(root).right);
+      return rotateleft(root);
+    }
+    if (bfactor(root) < -1) {
+      if (bfactor(At(root).left) > 0)
+        At(root).left = rotateleft(At(root).left);
+      return rotateright(root);
+    }
+    return root;
+  }
+
+  unsigned height(index_type node) const noexcept {
+    return node ? At(node).height : 0;
+  }
+
+  int bfactor(index_type node) const noexcept {
+    return int(height(At(node).right)) - int(height(At(node).left));
+  }
+
+  void fixheight(index_type node) const noexcept {
+    unsigned hl = height(At(node).left);
+    unsigned hr = height(At(node).right);
+    At(node).height = static_cast<unsigned char>((hl > hr ? hl : hr) + 1);
+  }
+
+  Compare comp_;
+  node_allocator alloc_;
+  std::vector<Node *, chunk_allocator> chunks_;
+  index_type root_ = kNull;
+  index_type free_ = kNull;
+  size_t size_ = 0;
+  size_t used_ = 0;
+  Anchor anchor_;
+};
+
+// Бэкенд на компактном AVL-дереве для map, set и multiset.
+struct CompactBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = CompactTree<T, KeyOfValue, Compare, Allocator, Augment>;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_COMPACT_TREE_H
@@ -0,0 +1,176 @@
+#ifndef STLCONTAINERS_CONCURRENT_MAP_H
+#define STLCONTAINERS_CONCURRENT_MAP_H
+
+#include <optional>
+
+#include "my_map.h"
+#include "sharded.h"
+
+namespace STL {
+
+// map для общего доступа из нескольких потоков: Shards деревьев map, у
+// каждого свой reader-writer мьютекс, шард выбирается по хешу ключа.
+// Итераторов наружу нет: значения возвращаются копией, а изменения на
+// месте делаются функцией под блокировкой шарда. Каждая операция над
+// одним ключом атомарна; size() и for_each() видят шарды в разные
+// моменты, согласованный срез даёт snapshot().
+template <class T, class K, class Compare = std::less<T>,
+          class Hash = std::hash<T>,
+          class Allocator = std::allocator<std::pair<T, K>>,
+          size_t Shards = 64>
+class concurrent_map {
+ public:
+  using key_type = T;
+  using value_type = K;
+  using tree_type = std::pair<T, K>;
+  using key_compare = Compare;
+  using hasher = Hash;
+  using allocator_type = Allocator;
+  using map_type = map<T, K, Compare, Allocator>;
+  using size_type = size_t;
+
+  concurrent_map() {}
+
+  explicit concurrent_map(const Compare &comp, const Hash &hash = Hash(),
+                          const Allocator &alloc = Allocator())
+      : Prototype(comp, alloc), Table(Prototype, hash) {}
+
+  concurrent_map(const concurrent_map &) = delete;
+  concurrent_map &operator=(const concurrent_map &) = delete;
+
+  ~concurrent_map() {}
+
+  // true, если ключа не было и пара вставлена.
+  bool insert(const T &key, const K &obj) {
+    return Table.Write(key, [&](map_type &shard) {
+      return shard.insert(key, obj).second;
+    });
+  }
+
+  template <class... Args>
+  bool try_emplace(const T &key, Args &&...args) {
+    return Table.Write(key, [&](map_type &shard) {
+      return shard.try_emplace(key, std::forward<Args>(args)...).second;
+    });
+  }
+
+  // true, если ключа не было; иначе значение заменено.
+  template <class M>
+  bool insert_or_assign(const T &key, M &&obj) {
+    return Table.Write(key, [&](map_type &shard) {
+      return shard.insert_or_assign(key, std::forward<M>(obj)).second;
+    });
+  }
+
+  // Копия значения или nullopt.
+  std::optional<K> find(const T &key) const {
+    return Table.Read(key, [&](const map_type &shard) -> std::optional<K> {
+      auto it = shard.find(key);
+      if (it == shard.end()) return std::nullopt;
+      return (*it).second;
+    });
+  }
+
+  bool contains(const T &key) const {
+    return Table.Read(
+        key, [&](const map_type &shard) { return shard.contains(key); });
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  // update(K &) под исключительной блокировкой, если ключ есть.
+  template <class F>
+  bool find_and_update(const T &key, F update) {
+    return Table.Write(key, [&](map_type &shard) {
+      auto it = shard.find(key);
+      if (it == shard.end()) return false;
+      update((*it).second);
+      return true;
+    });
+  }
+
+  size_type erase(const T &key) {
+    return Table.Write(key, [&](map_type &shard) -> size_type {
+      auto it = shard.find(key);
+      if (it == shard.end()) return 0;
+      shard.erase(it);
+      return 1;
+    });
+  }
+
+  // Удаляет key, только если pred(const K &) истинно, атомарно с
+  // проверкой.
+  template <class Predicate>
+  bool erase_if(const T &key, Predicate pred) {
+    return Table.Write(key, [&](map_type &shard) {
+      auto it = shard.find(key);
+      if (it == shard.end() || !pred(static_cast<const K &>((*it).second)))
+        return false;
+      shard.erase(it);
+      return true;
+    });
+  }
+
+  // Удаляет все пары, для которых pred(const pair &) истинно; шарды
+  // обрабатываются по очереди.
+  template <class Predicate>
+  size_type erase_if(Predicate pred) {
+    size_type erased = 0;
+    Table.WriteEach([&](map_type &shard) {
+      for (auto it = shard.begin(); it != shard.end();) {
+        auto next = it;
+        ++next;
+        if (pred(static_cast<const tree_type &>(*it))) {
+          shard.erase(it);
+          ++erased;
+        }
+        it = next;
+      }
+    });
+    return erased;
+  }
+
+  // visit(const pair &) для каждой пары; внутри шарда - по возрастанию
+  // ключей, шарды - по очереди.
+  template <class Visitor>
+  void for_each(Visitor visit) const {
+    Table.ReadEach([&](const map_type &shard) {
+      for (auto it = shard.begin(); it != shard.end(); ++it)
+        visit(static_cast<const tree_type &>(*it));
+    });
+  }
+
+  // Упорядоченная копия всего содержимого на один момент времени.
+  map_type snapshot() const {
+    map_type result(Prototype);
+    Table.ReadAll([&](const map_type &shard) { result.unite(shard); });
+    return result;
+  }
+
+  size_type size() const {
+    size_type total = 0;
+    Table.ReadEach([&](const map_type &shard) { total += shard.size(); });
+    return total;
+  }
+
+  bool empty() const { return size() ? false : true; }
+
+  void clear() {
+    Table.WriteEach([](map_type &shard) { shard.clear(); });
+  }
+
+  key_compare key_comp() const { return Prototype.key_comp(); }
+
+  hasher hash_function() const { return Table.hash_function(); }
+
+  allocator_type get_allocator() const { return Prototype.get_allocator(); }
+
+ private:
+  // Пустой контейнер с нужными компаратором и аллокатором, по нему
+  // строятся шарды и срезы.
+  map_type Prototype;
+  Sharded<map_type, Hash, Shards> Table;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_CONCURRENT_MAP_H
@@ -0,0 +1,116 @@
+#ifndef STLCONTAINERS_CONCURRENT_SET_H
+#define STLCONTAINERS_CONCURRENT_SET_H
+
+#include "my_set.h"
+#include "sharded.h"
+
+namespace STL {
+
+// set для общего доступа из нескольких потоков; устроен как
+// concurrent_map: Shards деревьев set под reader-writer мьютексами,
+// шард выбирается по хешу ключа.
+template <class T, class Compare = std::less<T>, class Hash = std::hash<T>,
+          class Allocator = std::allocator<T>, size_t Shards = 64>
+class concurrent_set {
+ public:
+  using key_type = T;
+  using value_type = T;
+  using key_compare = Compare;
+  using hasher = Hash;
+  using allocator_type = Allocator;
+  using set_type = set<T, Compare, Allocator>;
+  using size_type = size_t;
+
+  concurrent_set() {}
+
+  explicit concurrent_set(const Compare &comp, const Hash &hash = Hash(),
+                          const Allocator &alloc = Allocator())
+      : Prototype(comp, alloc), Table(Prototype, hash) {}
+
+  concurrent_set(const concurrent_set &) = delete;
+  concurrent_set &operator=(const concurrent_set &) = delete;
+
+  ~concurrent_set() {}
+
+  bool insert(const T &key) {
+    return Table.Write(
+        key, [&](set_type &shard) { return shard.insert(key).second; });
+  }
+
+  bool contains(const T &key) const {
+    return Table.Read(
+        key, [&](const set_type &shard) { return shard.contains(key); });
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  size_type erase(const T &key) {
+    return Table.Write(key, [&](set_type &shard) -> size_type {
+      auto it = shard.find(key);
+      if (it == shard.end()) return 0;
+      shard.erase(it);
+      return 1;
+    });
+  }
+
+  // Удаляет все ключи, для которых pred(const T &) истинно; шарды
+  // обрабатываются по очереди.
+  template <class Predicate>
+  size_type erase_if(Predicate pred) {
+    size_type erased = 0;
+    Table.WriteEach([&](set_type &shard) {
+      for (auto it = shard.begin(); it != shard.end();) {
+        auto next = it;
+        ++next;
+        if (pred(static_cast<const T &>(*it))) {
+          shard.erase(it);
+          ++erased;
+        }
+        it = next;
+      }
+    });
+    return erased;
+  }
+
+  template <class Visitor>
+  void for_each(Visitor visit) const {
+    Table.ReadEach([&](const set_type &shard) {
+      for (auto it = shard.begin(); it != shard.end(); ++it)
+        visit(static_cast<const T &>(*it));
+    });
+  }
+
+  // Упорядоченная копия всего содержимого на один момент времени.
+  set_type snapshot() const {
+    set_type result(Prototype);
+    Table.ReadAll([&](const set_type &shard) { result.unite(shard); });
+    return result;
+  }
+
+  size_type size() const {
+    size_type total = 0;
+    Table.ReadEach([&](const set_type &shard) { total += shard.size(); });
+    return total;
+  }
+
+  bool empty() const { return size() ? false : true; }
+
+  void clear() {
+    Table.WriteEach([](set_type &shard) { shard.clear(); });
+  }
+
+  key_compare key_comp() const { return Prototype.key_comp(); }
+
+  hasher hash_function() const { return Table.hash_function(); }
+
+  allocator_type get_allocator() const { return Prototype.get_allocator(); }
+
+ private:
+  // Пустой контейнер с нужными компаратором и аллокатором, по нему
+  // строятся шарды и срезы.
+  set_type Prototype;
+  Sharded<set_type, Hash, Shards> Table;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_CONCURRENT_SET_H
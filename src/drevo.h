@@ -1,362 +1,1629 @@
 #ifndef STLCONTAINERS_DREVO_H
 #define STLCONTAINERS_DREVO_H
 
+#include <algorithm>
 #include <cstddef>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace STL {
 
-template <class T>
-class Tree;
+// Дополнение узла: Augment::node_data хранится в каждом узле и
+// пересчитывается по детям в Augment::update везде, где пересчитывается
+// высота. Пустой node_data не занимает места.
+struct NoAugment {
+  struct node_data {};
 
-template <class T>
-struct TreeNode {
+  template <class Node>
+  static void update(Node *) noexcept {}
+};
+
+// Свёртка поддерева моноидом: Monoid задаёт value_type, identity(),
+// lift(element) и ассоциативную combine(a, b). Свёртка идёт в порядке
+// обхода, поэтому коммутативность не нужна. Для пересчёта при поворотах
+// lift и combine не должны бросать исключений.
+template <class Monoid>
+struct MonoidAugment {
+  using monoid_type = Monoid;
+  using value_type = typename Monoid::value_type;
+
+  struct node_data {
+    value_type aggregate;
+  };
+
+  template <class Node>
+  static void update(Node *node) noexcept {
+    node->aggregate = Monoid::combine(
+        Monoid::combine(aggregate(node->left), Monoid::lift(node->key)),
+        aggregate(node->right));
+  }
+
+  template <class Node>
+  static value_type aggregate(const Node *node) noexcept {
+    return node ? node->aggregate : Monoid::identity();
+  }
+};
+
+struct CountElements {
+  using value_type = size_t;
+
+  static size_t identity() noexcept { return 0; }
+
+  template <class T>
+  static size_t lift(const T &) noexcept {
+    return 1;
+  }
+
+  static size_t combine(size_t a, size_t b) noexcept { return a + b; }
+};
+
+// Размер поддерева в каждом узле: k-й элемент и ранг ключа за O(log n).
+struct SubtreeSize : MonoidAugment<CountElements> {
+  template <class Node>
+  static size_t size(const Node *node) noexcept {
+    return aggregate(node);
+  }
+};
+
+// Читает ли дополнение сами элементы. Если да, значение в map нельзя
+// менять в обход дерева: свёртки от него не узнают.
+template <class Augment>
+struct ReadsElements : std::true_type {};
+
+template <>
+struct ReadsElements<NoAugment> : std::false_type {};
+
+template <>
+struct ReadsElements<MonoidAugment<CountElements>> : std::false_type {};
+
+template <>
+struct ReadsElements<SubtreeSize> : std::false_type {};
+
+// Ссылки на соседей по порядку для прошитого дерева; без прошивки
+// пустая база места не занимает.
+template <class Node, bool Threaded>
+struct ThreadLinks {};
+
+template <class Node>
+struct ThreadLinks<Node, true> {
+  Node *prev;
+  Node *next;
+};
+
+template <class T, class Augment = NoAugment, bool Threaded = false>
+struct TreeNode : Augment::node_data,
+                  ThreadLinks<TreeNode<T, Augment, Threaded>, Threaded> {
   T key;
   unsigned int height;
-  TreeNode<T> *parent;
-  TreeNode<T> *left;
-  TreeNode<T> *right;
-  friend class Tree<T>;
+  TreeNode *parent;
+  TreeNode *left;
+  TreeNode *right;
 };
 
+// Политики извлечения ключа: дерево упорядочено по KeyOfValue()(node->key),
+// поэтому map и multiset ищут по first без построения фиктивной пары.
 template <class T>
+struct Identity {
+  const T &operator()(const T &value) const noexcept { return value; }
+};
+
+template <class Pair>
+struct SelectFirst {
+  const typename Pair::first_type &operator()(const Pair &value) const
+      noexcept {
+    return value.first;
+  }
+};
+
+template <class Pair>
+struct SelectSecond {
+  const typename Pair::second_type &operator()(const Pair &value) const
+      noexcept {
+    return value.second;
+  }
+};
+
+// Готовые моноиды для MonoidAugment. Project выбирает из элемента
+// величину: сам элемент для set и multiset, SelectSecond для значений
+// map.
+template <class V, class Project = Identity<V>>
+struct Sum {
+  using value_type = V;
+
+  static V identity() noexcept { return V(); }
+
+  template <class T>
+  static V lift(const T &element) noexcept {
+    return Project()(element);
+  }
+
+  static V combine(const V &a, const V &b) noexcept { return a + b; }
+};
+
+template <class V, class Project = Identity<V>>
+struct Min {
+  using value_type = V;
+
+  static V identity() noexcept { return std::numeric_limits<V>::max(); }
+
+  template <class T>
+  static V lift(const T &element) noexcept {
+    return Project()(element);
+  }
+
+  static V combine(const V &a, const V &b) noexcept {
+    return b < a ? b : a;
+  }
+};
+
+template <class V, class Project = Identity<V>>
+struct Max {
+  using value_type = V;
+
+  static V identity() noexcept { return std::numeric_limits<V>::lowest(); }
+
+  template <class T>
+  static V lift(const T &element) noexcept {
+    return Project()(element);
+  }
+
+  static V combine(const V &a, const V &b) noexcept {
+    return a < b ? b : a;
+  }
+};
+
+// Инструментирование дерева: Stats получает вызов на каждое сравнение,
+// поворот, выделение и освобождение узла, новую высоту и шаг итератора,
+// а Stats::Timer живёт на время публичной операции. У NoStats все
+// функции пустые и компилятор убирает их целиком; считающая политика -
+// TreeStats из tree_stats.h.
+enum class TreeOp { kInsert, kErase, kFind, kBounds };
+inline constexpr size_t kTreeOps = 4;
+inline constexpr size_t kLatencyBuckets = 32;
+
+// Снимок счётчиков. latency[op][b] - число замеров операции op
+// длительностью [2^b, 2^(b+1)) нс; в нулевую корзину попадают и 0 нс.
+struct TreeCounters {
+  size_t comparisons = 0;
+  size_t rotations = 0;
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  size_t max_height = 0;
+  size_t iterator_steps = 0;
+  size_t latency[kTreeOps][kLatencyBuckets] = {};
+};
+
+struct NoStats {
+  struct Timer {
+    explicit Timer(TreeOp) noexcept {}
+  };
+
+  static void OnCompare() noexcept {}
+  static void OnRotate() noexcept {}
+  static void OnAllocate() noexcept {}
+  static void OnFree() noexcept {}
+  static void OnHeight(size_t) noexcept {}
+  static void OnStep() noexcept {}
+  static TreeCounters Snapshot() noexcept { return {}; }
+};
+
+// Ограничение для шаблонных конструкторов от диапазона: отсекает
+// перегрузки вроде map::insert(key, obj), когда аргументы не итераторы.
+template <class It>
+using RequireIterator = typename std::iterator_traits<It>::iterator_category;
+
+template <class T, class KeyOfValue>
+using TreeKey = std::remove_cv_t<std::remove_reference_t<decltype(
+    KeyOfValue()(std::declval<const T &>()))>>;
+
+// Компаратор с is_transparent разрешает искать ключом любого сравнимого
+// типа; контейнеры открывают такие перегрузки только для него.
+template <class Compare, class = void>
+struct IsTransparent : std::false_type {};
+
+template <class Compare>
+struct IsTransparent<Compare, std::void_t<typename Compare::is_transparent>>
+    : std::true_type {};
+
+template <class T, class KeyOfValue, class Compare, class Allocator,
+          class Augment, class Stats, bool Threaded>
+class Tree;
+
+// Узел, вынутый из дерева через extract, вместе с копией аллокатора.
+// Обратно в дерево (то же или другое с равным аллокатором) он встаёт без
+// выделения памяти; пока узел в руке, его значение - и ключ тоже - можно
+// менять. Неиспользованный узел освобождается в деструкторе и
+// засчитывается в Stats дерева, из которого вынут.
+template <class Node, class NodeAllocator, class Stats = NoStats>
+class NodeHandle {
+  using node_traits = std::allocator_traits<NodeAllocator>;
+
+ public:
+  using value_type = decltype(std::declval<Node &>().key);
+  using allocator_type = typename node_traits::template rebind_alloc<
+      value_type>;
+
+  NodeHandle() noexcept : node_(nullptr) {}
+
+  NodeHandle(NodeHandle &&other) noexcept
+      : node_(other.node_), alloc_(std::move(other.alloc_)) {
+    other.node_ = nullptr;
+    other.alloc_.reset();
+  }
+
+  NodeHandle &operator=(NodeHandle &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      std::swap(node_, other.node_);
+      std::swap(alloc_, other.alloc_);
+    }
+    return *this;
+  }
+
+  ~NodeHandle() { Reset(); }
+
+  bool empty() const noexcept { return !node_; }
+  explicit operator bool() const noexcept { return node_; }
+
+  allocator_type get_allocator() const { return allocator_type(*alloc_); }
+
+  value_type &value() const {
+    if (!node_) throw std::logic_error("nullptr");
+    return node_->key;
+  }
+
+  // Для map: части пары по отдельности.
+  auto &key() const { return value().first; }
+  auto &mapped() const { return value().second; }
+
+ private:
+  NodeHandle(Node *node, const NodeAllocator &alloc) noexcept
+      : node_(node), alloc_(alloc) {}
+
+  Node *Release() noexcept {
+    Node *node = node_;
+    node_ = nullptr;
+    alloc_.reset();
+    return node;
+  }
+
+  void Reset() noexcept {
+    if (!node_) return;
+    Stats::OnFree();
+    node_traits::destroy(*alloc_, std::addressof(node_->key));
+    node_traits::deallocate(*alloc_, node_, 1);
+    node_ = nullptr;
+    alloc_.reset();
+  }
+
+  Node *node_;
+  std::optional<NodeAllocator> alloc_;
+
+  template <class, class, class, class, class, class, bool>
+  friend class Tree;
+};
+
+// Результат вставки узла в контейнер с уникальными ключами: при занятом
+// ключе узел возвращается в node, position - на мешающий элемент.
+template <class Iterator, class NodeType>
+struct InsertReturn {
+  Iterator position;
+  bool inserted;
+  NodeType node;
+};
+
+// Бэкенды без extract/insert узлов: тип-заглушка, чтобы объявления в
+// контейнерах оставались корректными.
+struct NoNodeHandle {};
+
+template <class Tree, class = void>
+struct NodeTypeOf {
+  using type = NoNodeHandle;
+};
+
+template <class Tree>
+struct NodeTypeOf<Tree, std::void_t<typename Tree::node_type>> {
+  using type = typename Tree::node_type;
+};
+
+// Счётчики бэкенда для stats() контейнеров: у Tree - снимок его
+// политики Stats, у бэкендов без инструментирования - нули.
+template <class Tree, class = void>
+struct TreeStatsOf {
+  static TreeCounters Get(const Tree &) noexcept { return {}; }
+};
+
+template <class Tree>
+struct TreeStatsOf<
+    Tree, std::void_t<decltype(std::declval<const Tree &>().stats())>> {
+  static TreeCounters Get(const Tree &tree) { return tree.stats(); }
+};
+
+// Якорь итераторов: блок в куче с адресом контейнера, которому сейчас
+// принадлежат элементы. swap и перемещение передают якорь вместе с
+// элементами, поэтому итератор, взятый до них, - и end(), до которого
+// он потом дошёл, - ведёт в нынешний контейнер, а не в старый объект.
+// Без якоря остаётся только дерево, из которого элементы переместили,
+// пока в него снова не вставят.
+template <class Owner, class Allocator>
+class IteratorAnchor {
+ public:
+  struct Cell {
+    const Owner *owner;
+  };
+
+  IteratorAnchor() noexcept : cell_(nullptr) {}
+  IteratorAnchor(const IteratorAnchor &) = delete;
+  IteratorAnchor &operator=(const IteratorAnchor &) = delete;
+
+  const Cell *get() const noexcept { return cell_; }
+
+  template <class Alloc>
+  void Ensure(const Owner *owner, const Alloc &alloc) {
+    if (cell_) return;
+    cell_allocator cells(alloc);
+    cell_ = cell_traits::allocate(cells, 1);
+    ::new (static_cast<void *>(cell_)) Cell{owner};
+  }
+
+  template <class Alloc>
+  void Free(const Alloc &alloc) noexcept {
+    if (!cell_) return;
+    cell_allocator cells(alloc);
+    cell_traits::deallocate(cells, cell_, 1);
+    cell_ = nullptr;
+  }
+
+  // Элементы other переходят к owner, и якорь вместе с ними. Свой якорь
+  // к этому моменту уже освобождён.
+  void Take(IteratorAnchor &other, const Owner *owner) noexcept {
+    cell_ = other.cell_;
+    other.cell_ = nullptr;
+    if (cell_) cell_->owner = owner;
+  }
+
+ private:
+  using cell_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Cell>;
+  using cell_traits = std::allocator_traits<cell_allocator>;
+
+  Cell *cell_;
+};
+
+template <class T, class KeyOfValue = Identity<T>,
+          class Compare = std::less<TreeKey<T, KeyOfValue>>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment,
+          class Stats = NoStats, bool Threaded = false>
 class Tree {
  public:
-  class iterator {
+  using key_type = TreeKey<T, KeyOfValue>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using Node = TreeNode<T, Augment, Threaded>;
+
+ private:
+  using Anchor = IteratorAnchor<Tree, Allocator>;
+  using AnchorCell = typename Anchor::Cell;
+
+ public:
+  // Шаг итератора - Next/Prev: в прошитом дереве одно чтение ссылки,
+  // иначе подъём по parent. end() - пустой узел; шаг назад от него ведёт
+  // в rightmost_ дерева, которому сейчас принадлежат узлы, за O(1).
+  template <bool Const>
+  class Iterator {
    public:
-    explicit iterator(TreeNode<T> *current) : current_(current) {}
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const Tree *tree, Node *current)
+        : Iterator(tree->anchor_.get(), current) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(anchor_, current_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.anchor_, other.current_) {}
 
-    iterator &operator++() {
+    Iterator &operator++() {
       if (!current_) throw std::out_of_range("Out of range");
-      if (current_->right) {
-        current_ = findmin(current_->right);
-      } else {
-        if (current_->parent) {
-          TreeNode<T> *tmp = current_->parent;
-          if (tmp->left == current_) {
-            current_ = tmp;
-          } else {
-            do {
-              current_ = tmp;
-              tmp = current_->parent;
-            } while (tmp && tmp->right == current_);
-            if (tmp)
-              current_ = tmp;
-            else
-              current_ = nullptr;
-          }
-        } else
-          current_ = nullptr;
-      }
+      Stats::OnStep();
+      current_ = Tree::Next(current_);
       return *this;
     }
 
-    iterator operator++(int) {
-      iterator tmp = *this;
+    Iterator operator++(int) {
+      Iterator tmp = *this;
       ++(*this);
       return tmp;
     }
 
-    iterator &operator--() {
+    Iterator &operator--() {
+      Stats::OnStep();
+      if (current_)
+        current_ = Tree::Prev(current_);
+      else if (anchor_)
+        current_ = anchor_->owner->rightmost_;
       if (!current_) throw std::out_of_range("Out of range");
-      if (current_->left) {
-        current_ = findmax(current_->left);
-      }
-
-      else {
-        if (current_->parent) {
-          TreeNode<T> *tmp = current_->parent;
-          if (tmp->right == current_) {
-            current_ = tmp;
-          } else {
-            do {
-              current_ = tmp;
-              tmp = current_->parent;
-            } while (tmp && tmp->left == current_);
-            if (tmp)
-              current_ = tmp;
-            else
-              current_ = nullptr;
-          }
-        } else
-          current_ = nullptr;
-      }
       return *this;
     }
 
-    iterator operator--(int) {
-      iterator tmp = *this;
+    Iterator operator--(int) {
+      Iterator tmp = *this;
       --(*this);
       return tmp;
     }
 
-    TreeNode<T> *node() const { return current_; }
+    Node *node() const { return current_; }
 
-    T &operator*() const {
+    reference operator*() const {
       if (!current_) throw std::logic_error("nullptr");
       return current_->key;
     }
 
-    TreeNode<T> *findmin(TreeNode<T> *root) const {
-      return root->left ? findmin(root->left) : root;
-    }
-
-    TreeNode<T> *findmax(TreeNode<T> *root) const {
-      return root->right ? findmax(root->right) : root;
-    }
-
-    bool operator==(const iterator &other) const {
+    bool operator==(const Iterator &other) const {
       return current_ == other.current_;
     }
-    bool operator!=(const iterator &other) const {
+    bool operator!=(const Iterator &other) const {
       return current_ != other.current_;
     }
 
    private:
-    TreeNode<T> *current_;
-    friend Tree<T>;
+    Iterator(const AnchorCell *anchor, Node *current) noexcept
+        : anchor_(anchor), current_(current) {}
+
+    const AnchorCell *anchor_;
+    Node *current_;
+    friend Tree;
+    friend Iterator<!Const>;
   };
 
-  class const_iterator {
-   public:
-    explicit const_iterator(TreeNode<T> *current) : current_(current) {}
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using node_type = NodeHandle<
+      Node,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>,
+      Stats>;
 
-    const_iterator &operator++() {
-      if (!current_) throw std::out_of_range("Out of range");
-      if (current_->right) {
-        current_ = findmin(current_->right);
-      }
+  Tree() : Tree(Compare(), Allocator()) {}
 
-      else {
-        if (current_->parent) {
-          TreeNode<T> *tmp = current_->parent;
-          if (tmp->left == current_) {
-            current_ = tmp;
-          } else {
-            do {
-              current_ = tmp;
-              tmp = current_->parent;
-            } while (tmp && tmp->right == current_);
-            if (tmp)
-              current_ = tmp;
-            else
-              current_ = nullptr;
-          }
-        } else
-          current_ = nullptr;
-      }
+  explicit Tree(const Allocator &alloc) : Tree(Compare(), alloc) {}
+
+  explicit Tree(const Compare &comp, const Allocator &alloc = Allocator())
+      : size_(0),
+        root_(nullptr),
+        leftmost_(nullptr),
+        rightmost_(nullptr),
+        comp_(comp),
+        alloc_(alloc) {
+    anchor_.Ensure(this, alloc_);
+  }
+
+  Tree(const Tree &other)
+      : size_(0),
+        root_(nullptr),
+        leftmost_(nullptr),
+        rightmost_(nullptr),
+        comp_(other.comp_),
+        alloc_(node_traits::select_on_container_copy_construction(
+            other.alloc_)) {
+    anchor_.Ensure(this, alloc_);
+    auto create = [this](const T &value) { return CreateNode(value); };
+    CopyFrom(other, create);
+  }
+
+  Tree(Tree &&other) noexcept
+      : size_(std::move(other.size_)),
+        root_(std::move(other.root_)),
+        leftmost_(other.leftmost_),
+        rightmost_(other.rightmost_),
+        comp_(other.comp_),
+        alloc_(std::move(other.alloc_)) {
+    anchor_.Take(other.anchor_, this);
+    other.size_ = 0;
+    other.root_ = other.leftmost_ = other.rightmost_ = nullptr;
+  }
+
+  // Узлы старого содержимого переиспользуются под копию, если аллокатор
+  // остаётся прежним.
+  Tree &operator=(const Tree &other) {
+    if (this == &other) return *this;
+    if (node_traits::propagate_on_container_copy_assignment::value &&
+        !(alloc_ == other.alloc_)) {
+      clear();
+      anchor_.Free(alloc_);
+      alloc_ = other.alloc_;
+      anchor_.Ensure(this, alloc_);
+    }
+    comp_ = other.comp_;
+    NodeRecycler recycler(*this);
+    CopyFrom(other, recycler);
+    return *this;
+  }
+
+  Tree &operator=(Tree &&other) noexcept(
+      node_traits::propagate_on_container_move_assignment::value ||
+      node_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    clear();
+    comp_ = other.comp_;
+    if (node_traits::propagate_on_container_move_assignment::value) {
+      anchor_.Free(alloc_);
+      alloc_ = std::move(other.alloc_);
+    } else if (!(alloc_ == other.alloc_)) {
+      // Чужой аллокатор: узлы забрать нельзя, копируем форму дерева.
+      auto create = [this](const T &value) { return CreateNode(value); };
+      CopyFrom(other, create);
+      other.clear();
       return *this;
     }
+    anchor_.Free(alloc_);
+    anchor_.Take(other.anchor_, this);
+    root_ = std::move(other.root_);
+    size_ = std::move(other.size_);
+    leftmost_ = other.leftmost_;
+    rightmost_ = other.rightmost_;
+    other.root_ = other.leftmost_ = other.rightmost_ = nullptr;
+    other.size_ = 0;
+    return *this;
+  }
 
-    const_iterator operator++(int) {
-      const_iterator tmp = *this;
-      ++(*this);
-      return tmp;
+  ~Tree() {
+    if (root_ != nullptr) {
+      ClearTreeNode(root_);  // CHANGE IT, NO METHODS IN DESTRUCTORS
     }
+    size_ = 0;
+    anchor_.Free(alloc_);
+  }
 
-    const_iterator &operator--() {
-      if (!current_) throw std::out_of_range("Out of range");
-      if (current_->left) {
-        current_ = findmax(current_->left);
+  void AppendValue(const T &value) { InsertEqual(value); }
+
+  // Вставка за один спуск: ищем место, подвешиваем узел и балансируем
+  // снизу вверх. Возвращает узел с ключом value и признак вставки.
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  // Равные ключи уходят вправо, новый элемент встаёт после уже имеющихся.
+  iterator InsertEqual(const T &value) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    return At(LinkNode(EqualPos(KeyOfValue()(value)), CreateNode(value)));
+  }
+
+  // Позиция ищется до переноса value: порядок вычисления аргументов
+  // не задан, и узел мог бы встать по уже перенесённому ключу.
+  iterator InsertEqual(T &&value) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = EqualPos(KeyOfValue()(value));
+    return At(LinkNode(pos, CreateNode(std::move(value))));
+  }
+
+  // Вставка с подсказкой: если value встаёт рядом с hint, спуска нет вовсе,
+  // иначе откатываемся к обычной вставке.
+  std::pair<iterator, bool> InsertUnique(iterator hint, const T &value) {
+    return TryEmplaceHintUnique(hint, KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator hint, T &&value) {
+    return TryEmplaceHintUnique(hint, KeyOfValue()(value), std::move(value));
+  }
+
+  iterator InsertEqual(iterator hint, const T &value) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    return At(
+        LinkNode(EqualPos(hint, KeyOfValue()(value)), CreateNode(value)));
+  }
+
+  iterator InsertEqual(iterator hint, T &&value) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = EqualPos(hint, KeyOfValue()(value));
+    return At(LinkNode(pos, CreateNode(std::move(value))));
+  }
+
+  // Значение строится из args прямо в узле и только если ключа ещё нет:
+  // map::try_emplace и operator[] не создают лишних объектов.
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = UniquePos(key);
+    if (pos.existing) return std::make_pair(At(pos.existing), false);
+    return std::make_pair(
+        At(LinkNode(pos, CreateNode(std::forward<Args>(args)...))), true);
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceHintUnique(iterator hint, const K &key,
+                                                 Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = UniquePos(hint, key);
+    if (pos.existing) return std::make_pair(At(pos.existing), false);
+    return std::make_pair(
+        At(LinkNode(pos, CreateNode(std::forward<Args>(args)...))), true);
+  }
+
+  // Ключ известен только после конструирования, поэтому узел создаётся
+  // заранее и уничтожается, если такой ключ уже есть.
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    Node *node = CreateNode(std::forward<Args>(args)...);
+    InsertPos pos = UniquePos(KeyOf(node));
+    if (pos.existing) {
+      DestroyNode(node);
+      return std::make_pair(At(pos.existing), false);
+    }
+    return std::make_pair(At(LinkNode(pos, node)), true);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceHintUnique(iterator hint, Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    Node *node = CreateNode(std::forward<Args>(args)...);
+    InsertPos pos = UniquePos(hint, KeyOf(node));
+    if (pos.existing) {
+      DestroyNode(node);
+      return std::make_pair(At(pos.existing), false);
+    }
+    return std::make_pair(At(LinkNode(pos, node)), true);
+  }
+
+  template <class... Args>
+  iterator EmplaceEqual(Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    Node *node = CreateNode(std::forward<Args>(args)...);
+    return At(LinkNode(EqualPos(KeyOf(node)), node));
+  }
+
+  template <class... Args>
+  iterator EmplaceHintEqual(iterator hint, Args &&...args) {
+    typename Stats::Timer timer(TreeOp::kInsert);
+    Node *node = CreateNode(std::forward<Args>(args)...);
+    return At(LinkNode(EqualPos(hint, KeyOf(node)), node));
+  }
+
+  // Заменяет содержимое элементами [first, last). Упорядоченный вход
+  // собирается в идеально сбалансированное дерево за O(n) без сравнений
+  // и поворотов, высоты считаются сразу. Иначе вход копируется,
+  // сортируется и собирается так же. Узлы прежнего содержимого
+  // переиспользуются.
+  template <class InputIt>
+  void AssignSorted(InputIt first, InputIt last) {
+    Assign<false>(first, last);
+  }
+
+  // То же для уникальных ключей: из равных остаётся первый.
+  template <class InputIt>
+  void AssignSortedUnique(InputIt first, InputIt last) {
+    Assign<true>(first, last);
+  }
+
+  // Переносит в дерево узлы other без перевыделения памяти. Ключи,
+  // которые уже есть (для уникальных), остаются в other. При равных
+  // аллокаторах это объединение через split/join за O(m log(n/m + 1)),
+  // иначе значения перемещаются поэлементно.
+  void MergeUnique(Tree &other) { Merge<true>(other); }
+  void MergeEqual(Tree &other) { Merge<false>(other); }
+
+  // Операции над множествами уникальных ключей. Дерево разрезается по
+  // корням other, поэтому other не меняется, а работа - O(m log(n/m + 1)).
+  // Исключение из Compare посреди разреза оставляет дерево испорченным:
+  // сравнение, которое может бросить, здесь не годится.
+  void UniteUnique(const Tree &other) {
+    if (this == &other || !other.root_) return;
+    Tree copy(comp_, get_allocator());
+    auto make_node = [&copy](const T &value) {
+      return copy.CreateNode(value);
+    };
+    copy.CopyFrom(other, make_node);
+    Merge<true>(copy);
+  }
+
+  void IntersectUnique(const Tree &other) noexcept(kNothrowCompare) {
+    if (this == &other) return;
+    size_t kept = 0;
+    Node *root = Intersect(DetachRoot(), other.root_, kept);
+    SetRoot(root, kept);
+  }
+
+  void SubtractUnique(const Tree &other) noexcept(kNothrowCompare) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    size_t count = size_;
+    Node *root = Subtract(DetachRoot(), other.root_, count);
+    SetRoot(root, count);
+  }
+
+  // Удаляет именно узел pos (важно для равных ключей) и возвращает
+  // итератор на следующий за ним элемент.
+  iterator erase(iterator pos) noexcept {
+    typename Stats::Timer timer(TreeOp::kErase);
+    Node *node = pos.node();
+    iterator next = At(Next(node));
+    remove(node);
+    return next;
+  }
+
+  // Узел выходит из дерева целиком, память не освобождается.
+  node_type Extract(iterator pos) noexcept {
+    typename Stats::Timer timer(TreeOp::kErase);
+    Node *node = pos.node();
+    Unlink(node);
+    node->parent = node->left = node->right = nullptr;
+    fixheight(node);
+    return node_type(node, alloc_);
+  }
+
+  // Пустой узел не вставляется; при занятом ключе узел остаётся у
+  // вызывающего.
+  InsertReturn<iterator, node_type> InsertNodeUnique(node_type &&node) {
+    if (node.empty()) return {end(), false, node_type()};
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = UniquePos(KeyOf(node.node_));
+    if (pos.existing) return {At(pos.existing), false, std::move(node)};
+    return {At(LinkNode(pos, Adopt(node))), true, node_type()};
+  }
+
+  iterator InsertNodeUnique(iterator hint, node_type &&node) {
+    if (node.empty()) return end();
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = UniquePos(hint, KeyOf(node.node_));
+    if (pos.existing) return At(pos.existing);
+    return At(LinkNode(pos, Adopt(node)));
+  }
+
+  iterator InsertNodeEqual(node_type &&node) {
+    if (node.empty()) return end();
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = EqualPos(KeyOf(node.node_));
+    return At(LinkNode(pos, Adopt(node)));
+  }
+
+  iterator InsertNodeEqual(iterator hint, node_type &&node) {
+    if (node.empty()) return end();
+    typename Stats::Timer timer(TreeOp::kInsert);
+    InsertPos pos = EqualPos(hint, KeyOf(node.node_));
+    return At(LinkNode(pos, Adopt(node)));
+  }
+
+  void clear() noexcept {
+    if (root_) ClearTreeNode(root_);
+    root_ = leftmost_ = rightmost_ = nullptr;
+    size_ = 0;
+  }
+
+  // Поиск шаблонный: с прозрачным компаратором контейнеры передают сюда
+  // ключ другого типа (например, string_view), и временный key_type не
+  // создаётся.
+  template <class K>
+  iterator FindTreeNode(const K &key) const {
+    typename Stats::Timer timer(TreeOp::kFind);
+    Node *node = root_;
+    while (node) {
+      if (Less(key, KeyOf(node)))
+        node = node->left;
+      else if (Less(KeyOf(node), key))
+        node = node->right;
+      else
+        break;
+    }
+    return At(node);
+  }
+
+  // Первый узел с ключом не меньше key.
+  template <class K>
+  iterator LowerBound(const K &key) const {
+    typename Stats::Timer timer(TreeOp::kBounds);
+    return At(LowerBound(root_, nullptr, key));
+  }
+
+  // Первый узел с ключом больше key.
+  template <class K>
+  iterator UpperBound(const K &key) const {
+    typename Stats::Timer timer(TreeOp::kBounds);
+    return At(UpperBound(root_, nullptr, key));
+  }
+
+  // Обе границы за один спуск: общий путь проходится один раз, а после
+  // первого равного узла поиск расходится в его левое и правое поддеревья.
+  template <class K>
+  std::pair<iterator, iterator> EqualRange(const K &key) const {
+    typename Stats::Timer timer(TreeOp::kBounds);
+    Node *node = root_;
+    Node *upper = nullptr;
+    while (node) {
+      if (Less(KeyOf(node), key)) {
+        node = node->right;
+      } else if (Less(key, KeyOf(node))) {
+        upper = node;
+        node = node->left;
+      } else {
+        return std::make_pair(At(LowerBound(node->left, node, key)),
+                              At(UpperBound(node->right, upper, key)));
       }
+    }
+    return std::make_pair(At(upper), At(upper));
+  }
 
-      else {
-        if (current_->parent) {
-          TreeNode<T> *tmp = current_->parent;
-          if (tmp->right == current_) {
-            current_ = tmp;
-          } else {
-            do {
-              current_ = tmp;
-              tmp = current_->parent;
-            } while (tmp && tmp->left == current_);
-            if (tmp)
-              current_ = tmp;
-            else
-              current_ = nullptr;
-          }
-        } else
-          current_ = nullptr;
+  // Порядковые статистики; нужен Augment с размером поддерева
+  // (SubtreeSize). Select возвращает k-й элемент с нуля или end(),
+  // Rank - число элементов с ключом меньше key.
+  iterator Select(size_t k) const noexcept {
+    Node *node = root_;
+    while (node) {
+      size_t left = Augment::size(node->left);
+      if (k == left) return At(node);
+      if (k < left) {
+        node = node->left;
+      } else {
+        k -= left + 1;
+        node = node->right;
       }
-      return *this;
     }
+    return At(nullptr);
+  }
 
-    operator iterator() const { return iterator(current_); }
+  template <class K>
+  size_t Rank(const K &key) const {
+    size_t rank = 0;
+    Node *node = root_;
+    while (node) {
+      if (Less(KeyOf(node), key)) {
+        rank += Augment::size(node->left) + 1;
+        node = node->right;
+      } else {
+        node = node->left;
+      }
+    }
+    return rank;
+  }
 
-    TreeNode<T> *node() const { return current_; }
+  // Пересчитывает дополнения от node до корня после того, как значение
+  // в узле изменили на месте (ключ менять нельзя).
+  void Refresh(iterator pos) noexcept {
+    if (kAugmented)
+      for (Node *node = pos.node(); node; node = node->parent)
+        Augment::update(node);
+  }
 
-    const T &operator*() const {
-      if (!current_) throw std::logic_error("nullptr");
-      return current_->key;
+  // Свёртка элементов с ключами из [lo, hi) для Augment = MonoidAugment:
+  // узел, где пути к lo и hi расходятся, и по одной ветке вниз от него.
+  template <class K1, class K2>
+  auto Aggregate(const K1 &lo, const K2 &hi) const {
+    using Monoid = typename Augment::monoid_type;
+    Node *split = root_;
+    while (split) {
+      if (Less(KeyOf(split), lo))
+        split = split->right;
+      else if (!Less(KeyOf(split), hi))
+        split = split->left;
+      else
+        break;
+    }
+    if (!split) return Monoid::identity();
+    typename Augment::value_type left = Monoid::identity();
+    for (Node *node = split->left; node;) {
+      if (Less(KeyOf(node), lo)) {
+        node = node->right;
+      } else {
+        left = Monoid::combine(
+            Monoid::combine(Monoid::lift(node->key),
+                            Augment::aggregate(node->right)),
+            left);
+        node = node->left;
+      }
     }
+    typename Augment::value_type right = Monoid::identity();
+    for (Node *node = split->right; node;) {
+      if (!Less(KeyOf(node), hi)) {
+        node = node->left;
+      } else {
+        right = Monoid::combine(right,
+                                Monoid::combine(Augment::aggregate(node->left),
+                                                Monoid::lift(node->key)));
+        node = node->right;
+      }
+    }
+    return Monoid::combine(Monoid::combine(left, Monoid::lift(split->key)),
+                           right);
+  }
+
+  iterator begin() noexcept { return At(leftmost_); }
+
+  iterator end() noexcept { return At(nullptr); }
 
-    TreeNode<T> *findmin(TreeNode<T> *root) const {
-      return root->left ? findmin(root->left) : root;
+  const_iterator begin() const noexcept {
+    return const_iterator(this, leftmost_);
+  }
+
+  const_iterator end() const noexcept { return const_iterator(this, nullptr); }
+
+  size_t size() const noexcept { return size_; }
+
+  TreeCounters stats() const { return Stats::Snapshot(); }
+
+  size_t &GetSize() noexcept { return size_; }
+
+  key_compare key_comp() const { return comp_; }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+ protected:
+  // Границы в поддереве node; result - ответ, если в поддереве его нет.
+  template <class K>
+  Node *LowerBound(Node *node, Node *result, const K &key) const {
+    while (node) {
+      if (Less(KeyOf(node), key)) {
+        node = node->right;
+      } else {
+        result = node;
+        node = node->left;
+      }
     }
+    return result;
+  }
 
-    TreeNode<T> *findmax(TreeNode<T> *root) const {
-      return root->right ? findmax(root->right) : root;
+  template <class K>
+  Node *UpperBound(Node *node, Node *result, const K &key) const {
+    while (node) {
+      if (Less(key, KeyOf(node))) {
+        result = node;
+        node = node->left;
+      } else {
+        node = node->right;
+      }
     }
+    return result;
+  }
 
-    bool operator==(const const_iterator &other) const {
-      return current_ == other.current_;
+  static const key_type &KeyOf(const Node *node) noexcept {
+    return KeyOfValue()(node->key);
+  }
+
+  iterator At(Node *node) const noexcept { return iterator(this, node); }
+
+  template <class A, class B>
+  bool Less(const A &a, const B &b) const {
+    Stats::OnCompare();
+    return comp_(a, b);
+  }
+
+  // Разрез и всё, что на нём построено, не бросает сами, но зовут
+  // Compare: noexcept у них ровно такой, как у сравнения.
+  static constexpr bool kNothrowCompare =
+      noexcept(Stats::OnCompare()) &&
+      std::is_nothrow_invocable_v<const Compare &, const key_type &,
+                                  const key_type &>;
+
+  using node_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+
+  template <class... Args>
+  Node *CreateNode(Args &&...args) {
+    anchor_.Ensure(this, alloc_);
+    Node *node = node_traits::allocate(alloc_, 1);
+    try {
+      node_traits::construct(alloc_, std::addressof(node->key),
+                             std::forward<Args>(args)...);
+    } catch (...) {
+      node_traits::deallocate(alloc_, node, 1);
+      throw;
     }
+    Stats::OnAllocate();
+    node->parent = node->left = node->right = nullptr;
+    fixheight(node);
+    return node;
+  }
 
-    bool operator!=(const const_iterator &other) const {
-      return current_ != other.current_;
+  void DestroyNode(Node *node) noexcept {
+    Stats::OnFree();
+    node_traits::destroy(alloc_, std::addressof(node->key));
+    node_traits::deallocate(alloc_, node, 1);
+  }
+
+  // Узел из node_type: при равных аллокаторах берётся как есть, иначе,
+  // как в MergeValues, переезжает только значение, а старый узел
+  // освобождает handle - его аллокатором и с OnFree. Значение в руке
+  // могли поменять, поэтому дополнение узла пересчитывается.
+  Node *Adopt(node_type &handle) {
+    if (*handle.alloc_ == alloc_) {
+      anchor_.Ensure(this, alloc_);
+      Node *node = handle.Release();
+      fixheight(node);
+      return node;
+    }
+    Node *node = CreateNode(std::move(handle.node_->key));
+    handle.Reset();
+    return node;
+  }
+
+  // Источник узлов для копирующего присваивания: сначала отдаёт узлы
+  // прежнего содержимого дерева (значение пересоздаётся на месте), потом
+  // выделяет новые. Невостребованные узлы освобождаются в деструкторе.
+  class NodeRecycler {
+   public:
+    explicit NodeRecycler(Tree &tree) noexcept
+        : tree_(tree), free_(tree.DetachNodes()) {}
+
+    NodeRecycler(const NodeRecycler &) = delete;
+    NodeRecycler &operator=(const NodeRecycler &) = delete;
+
+    ~NodeRecycler() {
+      while (free_) {
+        Node *next = free_->right;
+        tree_.DestroyNode(free_);
+        free_ = next;
+      }
+    }
+
+    template <class V>
+    Node *operator()(V &&value) {
+      if (!free_) return tree_.CreateNode(std::forward<V>(value));
+      Node *node = free_;
+      free_ = node->right;
+      node_traits::destroy(tree_.alloc_, std::addressof(node->key));
+      try {
+        node_traits::construct(tree_.alloc_, std::addressof(node->key),
+                               std::forward<V>(value));
+      } catch (...) {
+        node_traits::deallocate(tree_.alloc_, node, 1);
+        Stats::OnFree();
+        throw;
+      }
+      node->parent = node->left = node->right = nullptr;
+      return node;
     }
 
    private:
-    TreeNode<T> *current_;
-    friend Tree<T>;
+    Tree &tree_;
+    Node *free_;
   };
 
-  Tree() noexcept : size_(0), root_(nullptr) {}
+  // Отцепляет все узлы от дерева и возвращает их списком по right, не
+  // трогая значения. Тот же поворотный обход, что в ClearTreeNode.
+  Node *DetachNodes() noexcept {
+    Node *list = nullptr;
+    Node *node = root_;
+    while (node) {
+      if (Node *left = node->left) {
+        node->left = left->right;
+        left->right = node;
+        node = left;
+      } else {
+        Node *right = node->right;
+        node->right = list;
+        list = node;
+        node = right;
+      }
+    }
+    root_ = leftmost_ = rightmost_ = nullptr;
+    size_ = 0;
+    return list;
+  }
 
-  Tree(const Tree<T> &other) : size_(0), root_(nullptr) {
-    for (auto val : other) {
-      AppendValue(val);
+  // Копирует other узел в узел вместе с высотами, без сравнений и
+  // поворотов. Обход идёт по ссылкам parent синхронно в обоих деревьях.
+  template <class NodeGen>
+  void CopyFrom(const Tree &other, NodeGen &make_node) {
+    if (!other.root_) return;
+    const Node *source = other.root_;
+    Node *root = make_node(source->key);
+    Node *copy = root;
+    CopyHeight(copy, source);
+    try {
+      while (true) {
+        if (source->left && !copy->left) {
+          source = source->left;
+          copy->left = make_node(source->key);
+          copy->left->parent = copy;
+          copy = copy->left;
+        } else if (source->right && !copy->right) {
+          source = source->right;
+          copy->right = make_node(source->key);
+          copy->right->parent = copy;
+          copy = copy->right;
+        } else if (source != other.root_) {
+          source = source->parent;
+          copy = copy->parent;
+          continue;
+        } else {
+          break;
+        }
+        CopyHeight(copy, source);
+      }
+    } catch (...) {
+      ClearTreeNode(root);
+      throw;
     }
+    root_ = root;
+    leftmost_ = findmin(root);
+    rightmost_ = findmax(root);
+    size_ = other.size_;
+    if constexpr (Threaded) Rethread();
+    Stats::OnHeight(root->height);
   }
 
-  Tree(Tree<T> &&other) noexcept
-      : size_(std::move(other.size_)), root_(std::move(other.root_)) {
-    other.size_ = 0;
-    other.root_ = nullptr;
+  static void CopyHeight(Node *copy, const Node *source) noexcept {
+    copy->height = source->height;
+    using Data = typename Augment::node_data;
+    static_cast<Data &>(*copy) = static_cast<const Data &>(*source);
   }
 
-  Tree<T> &operator=(const Tree<T> &other) {
-    clear();
-    for (auto val : other) {
-      AppendValue(val);
+  // Место для нового узла: ребёнок parent слева или справа. Для
+  // уникальной вставки existing указывает на узел с тем же ключом.
+  struct InsertPos {
+    Node *parent;
+    bool to_left;
+    Node *existing;
+  };
+
+  template <class K>
+  InsertPos UniquePos(const K &key) const {
+    Node *parent = nullptr;
+    Node *node = root_;
+    bool to_left = false;
+    while (node) {
+      parent = node;
+      if (Less(key, KeyOf(node))) {
+        to_left = true;
+        node = node->left;
+      } else if (Less(KeyOf(node), key)) {
+        to_left = false;
+        node = node->right;
+      } else {
+        return InsertPos{nullptr, false, node};
+      }
     }
-    return *this;
+    return InsertPos{parent, to_left, nullptr};
   }
 
-  Tree<T> &operator=(Tree<T> &&other) noexcept {
-    root_ = std::move(other.root_);
-    size_ = std::move(other.size_);
-    other.root_ = nullptr;
-    other.size_ = 0;
-    return *this;
+  template <class K>
+  InsertPos UniquePos(iterator hint, const K &key) const {
+    Node *pos = hint.node();
+    if (!pos) {
+      if (rightmost_ && Less(KeyOf(rightmost_), key))
+        return InsertPos{rightmost_, false, nullptr};
+      return UniquePos(key);
+    }
+    if (Less(key, KeyOf(pos))) {
+      if (pos == leftmost_) return InsertPos{pos, true, nullptr};
+      Node *before = Prev(pos);
+      if (!Less(KeyOf(before), key)) return UniquePos(key);
+      return before->right ? InsertPos{pos, true, nullptr}
+                           : InsertPos{before, false, nullptr};
+    }
+    if (Less(KeyOf(pos), key)) {
+      if (pos == rightmost_) return InsertPos{pos, false, nullptr};
+      Node *after = Next(pos);
+      if (!Less(key, KeyOf(after))) return UniquePos(key);
+      return pos->right ? InsertPos{after, true, nullptr}
+                        : InsertPos{pos, false, nullptr};
+    }
+    return InsertPos{nullptr, false, pos};
   }
 
-  ~Tree() {
-    if (root_ != nullptr) {
-      ClearTreeNode(*root_);  // CHANGE IT, NO METHODS IN DESTRUCTORS
+  InsertPos EqualPos(const key_type &key) const {
+    Node *parent = nullptr;
+    Node *node = root_;
+    bool to_left = false;
+    while (node) {
+      parent = node;
+      to_left = Less(key, KeyOf(node));
+      node = to_left ? node->left : node->right;
     }
-    size_ = 0;
+    return InsertPos{parent, to_left, nullptr};
   }
 
-  void AppendValue(const T &value) {
-    root_ = insert(root_, value);
-    size_++;
+  InsertPos EqualPos(iterator hint, const key_type &key) const {
+    Node *pos = hint.node();
+    if (!pos) {
+      if (rightmost_ && !Less(key, KeyOf(rightmost_)))
+        return InsertPos{rightmost_, false, nullptr};
+      return EqualPos(key);
+    }
+    if (!Less(KeyOf(pos), key)) {
+      if (pos == leftmost_) return InsertPos{pos, true, nullptr};
+      Node *before = Prev(pos);
+      if (Less(key, KeyOf(before))) return EqualPos(key);
+      return before->right ? InsertPos{pos, true, nullptr}
+                           : InsertPos{before, false, nullptr};
+    }
+    if (pos == rightmost_) return InsertPos{pos, false, nullptr};
+    Node *after = Next(pos);
+    if (Less(KeyOf(after), key)) return EqualPos(key);
+    return pos->right ? InsertPos{after, true, nullptr}
+                      : InsertPos{pos, false, nullptr};
   }
 
-  void erase(iterator pos) noexcept {
-    root_ = remove(root_, pos.node()->key);
-    size_--;
+  template <bool Unique, class InputIt>
+  void Assign(InputIt first, InputIt last) {
+    using traits = std::iterator_traits<InputIt>;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                    typename traits::iterator_category> &&
+                  std::is_same_v<std::decay_t<typename traits::reference>,
+                                 T>) {
+      if (IsOrdered<Unique>(first, last)) {
+        BuildFrom(first, std::distance(first, last));
+        return;
+      }
+    }
+    std::vector<T> values(first, last);
+    if (!IsOrdered<Unique>(values.begin(), values.end())) {
+      auto less = [this](const T &a, const T &b) {
+        return Less(KeyOfValue()(a), KeyOfValue()(b));
+      };
+      std::stable_sort(values.begin(), values.end(), less);
+      if (Unique) {
+        auto same = [&less](const T &a, const T &b) { return !less(a, b); };
+        values.erase(std::unique(values.begin(), values.end(), same),
+                     values.end());
+      }
+    }
+    BuildFrom(std::make_move_iterator(values.begin()), values.size());
   }
 
-  void clear() noexcept {
-    if (root_) ClearTreeNode(*root_);
-    root_ = nullptr;
+  template <bool Unique, class ForwardIt>
+  bool IsOrdered(ForwardIt first, ForwardIt last) const {
+    if (first == last) return true;
+    for (ForwardIt next = std::next(first); next != last; first = next++) {
+      const key_type &prev_key = KeyOfValue()(*first);
+      const key_type &key = KeyOfValue()(*next);
+      if (Unique ? !Less(prev_key, key) : Less(key, prev_key)) return false;
+    }
+    return true;
+  }
+
+  template <class It>
+  void BuildFrom(It it, size_t count) {
+    NodeRecycler recycler(*this);
+    SetRoot(BuildSubtree(it, count, recycler), count);
+  }
+
+  // Забирает всё дерево как отдельное поддерево; дерево остаётся пустым.
+  Node *DetachRoot() noexcept {
+    Node *root = root_;
+    root_ = leftmost_ = rightmost_ = nullptr;
     size_ = 0;
+    return root;
   }
 
-  TreeNode<T> *FindTreeNode(const T &val) const {
-    iterator tmp = this->begin();
-    while (tmp.current_ != nullptr && tmp.current_->key != val) {
-      ++tmp;
+  void SetRoot(Node *root, size_t count) noexcept {
+    root_ = root;
+    size_ = count;
+    if (!root) {
+      leftmost_ = rightmost_ = nullptr;
+      return;
     }
-    return tmp.current_;
+    root->parent = nullptr;
+    leftmost_ = findmin(root);
+    rightmost_ = findmax(root);
+    if constexpr (Threaded) Rethread();
+    Stats::OnHeight(root->height);
   }
 
-  TreeNode<T> *FindMapTreeNode(const T &val) const {
-    iterator tmp = begin();
-    while (tmp.current_ != nullptr && tmp.current_->key.first != val.first) {
-      ++tmp;
+  // Левое и правое поддеревья отличаются по размеру не больше чем на
+  // единицу, поэтому и по высоте тоже. Глубина рекурсии - log2(count).
+  template <class It, class NodeGen>
+  Node *BuildSubtree(It &it, size_t count, NodeGen &make_node) {
+    if (!count) return nullptr;
+    Node *left = BuildSubtree(it, count / 2, make_node);
+    Node *node;
+    try {
+      node = make_node(*it);
+    } catch (...) {
+      if (left) ClearTreeNode(left);
+      throw;
+    }
+    ++it;
+    node->left = left;
+    if (left) left->parent = node;
+    try {
+      node->right = BuildSubtree(it, count - count / 2 - 1, make_node);
+    } catch (...) {
+      ClearTreeNode(node);
+      throw;
     }
-    return tmp.current_;
+    if (node->right) node->right->parent = node;
+    fixheight(node);
+    return node;
   }
 
-  iterator begin() noexcept {
-    return root_ ? iterator(findmin(root_)) : iterator(nullptr);
+  template <bool Unique>
+  void Merge(Tree &other) {
+    if (this == &other || !other.root_) return;
+    if (!(alloc_ == other.alloc_)) {
+      MergeValues<Unique>(other);
+      return;
+    }
+    size_t total = size_ + other.size_;
+    NodeList rest;
+    Node *root = Union<Unique>(DetachRoot(), other.DetachRoot(), rest);
+    SetRoot(root, total - rest.count);
+    // Отвергнутые узлы уже идут по порядку и собираются обратно в other.
+    typename NodeList::iterator it{rest.head};
+    auto same_node = [](Node *node) noexcept { return node; };
+    other.SetRoot(other.BuildSubtree(it, rest.count, same_node), rest.count);
   }
 
-  iterator end() noexcept {  // FIXFIXFIXFIX
-    return iterator(nullptr);
+  // Узлы разных аллокаторов смешивать нельзя: значения перемещаются.
+  template <bool Unique>
+  void MergeValues(Tree &other) {
+    for (Node *node = other.leftmost_; node;) {
+      Node *next = Next(node);
+      InsertPos pos =
+          Unique ? UniquePos(KeyOf(node)) : EqualPos(KeyOf(node));
+      if (!pos.existing) {
+        LinkNode(pos, CreateNode(std::move(node->key)));
+        other.remove(node);
+      }
+      node = next;
+    }
   }
 
-  const_iterator begin() const noexcept {
-    return root_ ? const_iterator(findmin(root_)) : const_iterator(nullptr);
+  // Односвязный список узлов по right, в порядке добавления.
+  struct NodeList {
+    struct iterator {
+      Node *node;
+      Node *operator*() const noexcept { return node; }
+      iterator &operator++() noexcept {
+        node = node->right;
+        return *this;
+      }
+    };
+
+    void push_back(Node *node) noexcept {
+      node->right = nullptr;
+      if (tail)
+        tail->right = node;
+      else
+        head = node;
+      tail = node;
+      ++count;
+    }
+
+    Node *head = nullptr;
+    Node *tail = nullptr;
+    size_t count = 0;
+  };
+
+  // Части разреза: ключи меньше key, узел с ключом key (только для
+  // уникальных) и остальные. Все три - самостоятельные AVL-деревья.
+  struct SplitResult {
+    Node *left;
+    Node *middle;
+    Node *right;
+  };
+
+  // Для равных ключей узлы с key уходят вправо, поэтому при слиянии
+  // элементы other встают после равных им элементов дерева.
+  template <bool Unique, class K>
+  SplitResult Split(Node *node, const K &key) noexcept(kNothrowCompare) {
+    if (!node) return SplitResult{nullptr, nullptr, nullptr};
+    Node *left = Detach(node->left);
+    Node *right = Detach(node->right);
+    if (Less(KeyOf(node), key)) {
+      SplitResult result = Split<Unique>(right, key);
+      result.left = Join(left, node, result.left);
+      return result;
+    }
+    if (!Unique || Less(key, KeyOf(node))) {
+      SplitResult result = Split<Unique>(left, key);
+      result.right = Join(result.right, node, right);
+      return result;
+    }
+    node->left = node->right = nullptr;
+    fixheight(node);
+    return SplitResult{left, node, right};
   }
 
-  const_iterator end() const noexcept {  // FIXFIXFIXFIX
-    return const_iterator(nullptr);
+  static Node *Detach(Node *node) noexcept {
+    if (node) node->parent = nullptr;
+    return node;
   }
 
-  size_t size() const noexcept { return size_; }
+  // Соединяет деревья left < middle < right. Меньшее по высоте дерево
+  // подвешивается на край большего, где высоты почти равны, и
+  // балансировка идёт вверх только пока высота меняется: O(|hl - hr|).
+  Node *Join(Node *left, Node *middle, Node *right) noexcept {
+    unsigned int hl = height(left);
+    unsigned int hr = height(right);
+    if (hl > hr + 1) {
+      Node *parent = left;
+      while (height(parent->right) > hr + 1) parent = parent->right;
+      Attach(middle, parent->right, right);
+      parent->right = middle;
+      middle->parent = parent;
+      return RebalanceSubtree(parent, left);
+    }
+    if (hr > hl + 1) {
+      Node *parent = right;
+      while (height(parent->left) > hl + 1) parent = parent->left;
+      Attach(middle, left, parent->left);
+      parent->left = middle;
+      middle->parent = parent;
+      return RebalanceSubtree(parent, right);
+    }
+    Attach(middle, left, right);
+    middle->parent = nullptr;
+    return middle;
+  }
 
-  size_t &GetSize() noexcept { return size_; }
+  // Соединение без разделителя: им становится максимум левого дерева.
+  Node *Join(Node *left, Node *right) noexcept {
+    if (!left) return right;
+    if (!right) return left;
+    Node *max = findmax(left);
+    Node *parent = max->parent;
+    if (max->left) max->left->parent = parent;
+    if (parent) {
+      parent->right = max->left;
+      left = RebalanceSubtree(parent, left);
+    } else {
+      left = max->left;
+    }
+    return Join(left, max, right);
+  }
 
- protected:
-  TreeNode<T> *insert(TreeNode<T> *root, const T &value) {
-    if (!root) {
-      TreeNode<T> *another_one = new TreeNode<T>;
-      another_one->key = value;
-      another_one->height = 1;
-      another_one->left = nullptr;
-      another_one->right = nullptr;
-      another_one->parent = nullptr;
-      return another_one;
-    }
-    if (value < root->key) {
-      root->left = insert(root->left, value);
-      root->left->parent = root;
+  void Attach(Node *node, Node *left, Node *right) noexcept {
+    node->left = left;
+    node->right = right;
+    if (left) left->parent = node;
+    if (right) right->parent = node;
+    fixheight(node);
+  }
+
+  // Дерево a разрезается по корню b, половины объединяются рекурсивно.
+  // Глубина рекурсии не больше высоты a.
+  template <bool Unique>
+  Node *Union(Node *a, Node *b, NodeList &rejected) noexcept(kNothrowCompare) {
+    if (!a) return b;
+    if (!b) return a;
+    Node *left = Detach(a->left);
+    Node *right = Detach(a->right);
+    SplitResult parts = Split<Unique>(b, KeyOf(a));
+    left = Union<Unique>(left, parts.left, rejected);
+    if (parts.middle) rejected.push_back(parts.middle);
+    right = Union<Unique>(right, parts.right, rejected);
+    return Join(left, a, right);
+  }
+
+  Node *Intersect(Node *a, const Node *b,
+                  size_t &kept) noexcept(kNothrowCompare) {
+    if (!a) return nullptr;
+    if (!b) {
+      ClearTreeNode(a);
+      return nullptr;
+    }
+    SplitResult parts = Split<true>(a, KeyOf(b));
+    Node *left = Intersect(parts.left, b->left, kept);
+    Node *right = Intersect(parts.right, b->right, kept);
+    if (!parts.middle) return Join(left, right);
+    ++kept;
+    return Join(left, parts.middle, right);
+  }
+
+  Node *Subtract(Node *a, const Node *b,
+                 size_t &count) noexcept(kNothrowCompare) {
+    if (!a || !b) return a;
+    SplitResult parts = Split<true>(a, KeyOf(b));
+    Node *left = Subtract(parts.left, b->left, count);
+    Node *right = Subtract(parts.right, b->right, count);
+    if (parts.middle) {
+      DestroyNode(parts.middle);
+      --count;
+    }
+    return Join(left, right);
+  }
+
+  Node *LinkNode(const InsertPos &pos, Node *node) noexcept {
+    Node *parent = pos.parent;
+    node->parent = parent;
+    if (!parent) {
+      root_ = leftmost_ = rightmost_ = node;
+    } else if (pos.to_left) {
+      parent->left = node;
+      if (parent == leftmost_) leftmost_ = node;
     } else {
-      root->right = insert(root->right, value);
-      root->right->parent = root;
+      parent->right = node;
+      if (parent == rightmost_) rightmost_ = node;
+    }
+    if constexpr (Threaded) ThreadLeaf(pos, node);
+    size_++;
+    RebalanceUp(parent);
+    Stats::OnHeight(root_->height);
+    return node;
+  }
+
+  // Поднимаемся по parent, пока высота поддерева меняется.
+  void RebalanceUp(Node *node) noexcept {
+    root_ = RebalanceSubtree(node, root_);
+  }
+
+  // То же внутри отдельного поддерева с корнем root (его parent пуст);
+  // возвращает корень после поворотов.
+  Node *RebalanceSubtree(Node *node, Node *root) noexcept {
+    while (node) {
+      unsigned int old_height = node->height;
+      Node *parent = node->parent;
+      Node *subtree = balance(node);
+      if (!parent) return subtree;
+      ReplaceChild(parent, node, subtree);
+      node = parent;
+      if (subtree->height == old_height) break;
     }
-    return balance(root);
+    // Выше высоты уже не меняются, но дополнения предков устарели.
+    for (; kAugmented && node; node = node->parent) Augment::update(node);
+    return root;
   }
 
-  TreeNode<T> *remove(TreeNode<T> *root, T value) noexcept {
-    if (!root) return 0;
-    if (value < root->key) {
-      root->left = remove(root->left, value);
-      if (root->left) root->left->parent = root;
-    } else if (value > root->key) {
-      root->right = remove(root->right, value);
-      if (root->right) {
-        root->right->parent = root;
-      }
-    } else  //  k == p->key
-    {
-      TreeNode<T> *l = root->left;
-      TreeNode<T> *r = root->right;
-      delete root;
-      if (!r) {
-        if (l) l->parent = nullptr;
-        return l;
+  void ReplaceChild(Node *parent, Node *old_child, Node *new_child) noexcept {
+    if (!parent)
+      root_ = new_child;
+    else if (parent->left == old_child)
+      parent->left = new_child;
+    else
+      parent->right = new_child;
+  }
+
+  void remove(Node *node) noexcept {
+    Unlink(node);
+    DestroyNode(node);
+  }
+
+  // Вырезает узел из дерева, не освобождая его. Узел с двумя детьми
+  // заменяется своим преемником (минимумом правого поддерева),
+  // балансировка идёт вверх от самого нижнего изменённого узла.
+  void Unlink(Node *node) noexcept {
+    if (node == leftmost_) leftmost_ = Next(node);
+    if (node == rightmost_) rightmost_ = Prev(node);
+    Node *rebalance_from = node->parent;
+    if (!node->left || !node->right) {
+      Node *child = node->left ? node->left : node->right;
+      if (child) child->parent = node->parent;
+      ReplaceChild(node->parent, node, child);
+    } else {
+      Node *min = Next(node);
+      if (min->parent == node) {
+        rebalance_from = min;
+      } else {
+        rebalance_from = min->parent;
+        min->parent->left = min->right;
+        if (min->right) min->right->parent = min->parent;
+        min->right = node->right;
+        min->right->parent = min;
       }
-      TreeNode<T> *min = findmin(r);
-      min->parent = nullptr;
-      min->right = removemin(r);
-      if (min->right) min->right->parent = min;
-      min->left = l;
-      if (min->left) min->left->parent = min;
-      return balance(min);
+      min->left = node->left;
+      min->left->parent = min;
+      min->parent = node->parent;
+      min->height = node->height;
+      ReplaceChild(node->parent, node, min);
     }
-    return balance(root);
+    RebalanceUp(rebalance_from);
+    if constexpr (Threaded) Unthread(node);
+    size_--;
   }
 
-  TreeNode<T> *rotateright(
-      TreeNode<T> *root) noexcept {  // правый поворот вокруг root
-    TreeNode<T> *tmp = root->left;
+  Node *rotateright(Node *root) noexcept {  // правый поворот вокруг root
+    Stats::OnRotate();
+    Node *tmp = root->left;
     root->left = tmp->right;
     tmp->parent = root->parent;
     if (tmp->right) tmp->right->parent = root;
@@ -367,9 +1634,9 @@ class Tree {
     return tmp;
   }
 
-  TreeNode<T> *rotateleft(
-      TreeNode<T> *root) noexcept {  // левый поворот вокруг root
-    TreeNode<T> *tmp = root->right;
+  Node *rotateleft(Node *root) noexcept {  // левый поворот вокруг root
+    Stats::OnRotate();
+    Node *tmp = root->right;
     root->right = tmp->left;
     tmp->parent = root->parent;
     if (tmp->left) tmp->left->parent = root;
@@ -380,7 +1647,7 @@ class Tree {
     return tmp;
   }
 
-  TreeNode<T> *balance(TreeNode<T> *root) noexcept {  // балансировка узла root
+  Node *balance(Node *root) noexcept {  // балансировка узла root
     fixheight(root);
     if (bfactor(root) > 1) {
       if (bfactor(root->right) < 0) root->right = rotateright(root->right);
@@ -388,66 +1655,149 @@ class Tree {
     }
     if (bfactor(root) < -1) {
       if (bfactor(root->left) > 0) root->left = rotateleft(root->left);
-      TreeNode<T> *tmp = rotateright(root);
+      Node *tmp = rotateright(root);
       return tmp;
     }
     return root;  // балансировка не нужна
   }
 
-  unsigned int height(TreeNode<T> *root) const noexcept {
+  unsigned int height(Node *root) const noexcept {
     return root ? root->height : 0;
   }
 
-  int bfactor(TreeNode<T> *root) const noexcept {
+  int bfactor(Node *root) const noexcept {
     return height(root->right) - height(root->left);
   }
 
-  void fixheight(TreeNode<T> *root) const noexcept {
+  void fixheight(Node *root) const noexcept {
     unsigned int hl = height(root->left);
     unsigned int hr = height(root->right);
     root->height = (hl > hr ? hl : hr) + 1;
+    Augment::update(root);
   }
 
-  TreeNode<T> *findmin(TreeNode<T> *root) const
-      noexcept {  // поиск узла с минимальным ключом в дереве с корнем root
-    return root->left ? findmin(root->left) : root;
+  static Node *findmin(Node *root) noexcept {
+    while (root->left) root = root->left;
+    return root;
   }
 
-  TreeNode<T> *findmax(TreeNode<T> *root) const
-      noexcept {  // поиск узла с максимальным ключом в дереве с корнем root
-    return root->right ? findmax(root->right) : root;
+  static Node *findmax(Node *root) noexcept {
+    while (root->right) root = root->right;
+    return root;
   }
 
-  TreeNode<T> *removemin(
-      TreeNode<T> *root) noexcept {  // удаление узла с минимальным ключом из
-                                     // дерева с корнем root
-    if (root->left == 0) return root->right;
-    root->left = removemin(root->left);
-    return balance(root);
+  static Node *Next(Node *node) noexcept {
+    if constexpr (Threaded) {
+      return node->next;
+    } else {
+      return Successor(node);
+    }
   }
 
-  void ClearTreeNode(TreeNode<T> &root) noexcept {
-    if (root.left != nullptr) {
-      if (root.left->left == nullptr && root.left->right == nullptr)
-        delete root.left;
-      else
-        ClearTreeNode(*(root.left));
+  static Node *Prev(Node *node) noexcept {
+    if constexpr (Threaded) {
+      return node->prev;
+    } else {
+      return Predecessor(node);
     }
+  }
 
-    if (root.right != nullptr) {
-      if (root.right->left == nullptr && root.right->right == nullptr)
-        delete root.right;
-      else
-        ClearTreeNode(*(root.right));
+  // Соседи по дереву: минимум правого поддерева или первый предок, в
+  // левом поддереве которого лежит node (для Predecessor - наоборот).
+  static Node *Successor(Node *node) noexcept {
+    if (node->right) return findmin(node->right);
+    Node *parent = node->parent;
+    while (parent && parent->right == node) {
+      node = parent;
+      parent = node->parent;
     }
+    return parent;
+  }
 
-    delete &root;
+  static Node *Predecessor(Node *node) noexcept {
+    if (node->left) return findmax(node->left);
+    Node *parent = node->parent;
+    while (parent && parent->left == node) {
+      node = parent;
+      parent = node->parent;
+    }
+    return parent;
+  }
+
+  // Новый лист встаёт в цепочку рядом с родителем: левый ребёнок - перед
+  // ним, правый - после.
+  void ThreadLeaf(const InsertPos &pos, Node *node) noexcept {
+    Node *parent = pos.parent;
+    node->prev = parent && pos.to_left ? parent->prev : parent;
+    node->next = parent && !pos.to_left ? parent->next : parent;
+    if (node->prev) node->prev->next = node;
+    if (node->next) node->next->prev = node;
+  }
+
+  static void Unthread(Node *node) noexcept {
+    if (node->prev) node->prev->next = node->next;
+    if (node->next) node->next->prev = node->prev;
+  }
+
+  // Цепочка заново по обходу дерева за O(n): после сборки, копирования
+  // и операций через split/join.
+  void Rethread() noexcept {
+    Node *prev = nullptr;
+    for (Node *node = leftmost_; node; node = Successor(node)) {
+      node->prev = prev;
+      if (prev) prev->next = node;
+      prev = node;
+    }
+    if (prev) prev->next = nullptr;
+  }
+
+  // Освобождает поддерево без рекурсии и без стека: левый ребёнок
+  // поворотом поднимается наверх, пока у узла не останется только правая
+  // ветка, тогда узел удаляется. Дополнительная память O(1).
+  void ClearTreeNode(Node *node) noexcept {
+    while (node) {
+      if (Node *left = node->left) {
+        node->left = left->right;
+        left->right = node;
+        node = left;
+      } else {
+        Node *right = node->right;
+        DestroyNode(node);
+        node = right;
+      }
+    }
   }
 
  private:
+  static constexpr bool kAugmented =
+      !std::is_empty_v<typename Augment::node_data>;
+
   size_t size_;
-  TreeNode<T> *root_;
+  Node *root_;
+  Node *leftmost_;
+  Node *rightmost_;
+  Compare comp_;
+  node_allocator alloc_;
+  Anchor anchor_;
+};
+
+// Бэкенд контейнера - шаблон дерева, на котором он построен. AvlBackend
+// по умолчанию, BTreeBackend из btree.h.
+struct AvlBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = Tree<T, KeyOfValue, Compare, Allocator, Augment>;
+};
+
+// Прошитое AVL-дерево: узлы связаны в порядке ключей, шаг итератора -
+// одно чтение без подъёма по parent. Узел больше на два указателя, а
+// merge, unite, intersect и subtract после split/join перешивают
+// цепочку за O(n).
+struct ThreadedBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = Tree<T, KeyOfValue, Compare, Allocator, Augment, NoStats, true>;
 };
 }  // namespace STL
 
-#endif  // STLCONTAINERS_SET_H
+#endif  // STLCONTAINERS_DREVO_H
@@ -0,0 +1,141 @@
+#ifndef STLCONTAINERS_EPOCH_H
+#define STLCONTAINERS_EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace STL {
+
+// Отложенное освобождение узлов для структур без блокировок. Читатель
+// на время работы с узлами входит в текущую эпоху (Guard), писатель
+// отдаёт отцепленный узел в Retire. Эпоха продвигается, когда в
+// предыдущей не осталось читателей, и узлы, списанные две эпохи назад,
+// освобождаются: до них уже никто не может дотянуться. Читатели
+// только увеличивают и уменьшают счётчик своей полосы и никогда не
+// ждут писателей.
+class EpochReclaimer {
+ public:
+  // Узел, который можно списать: ссылка для списка ожидающих.
+  struct Retired {
+    Retired *retired_next = nullptr;
+  };
+
+  class Guard {
+   public:
+    Guard() noexcept : reclaimer_(nullptr), epoch_(0), stripe_(0) {}
+
+    explicit Guard(const EpochReclaimer *reclaimer) noexcept
+        : reclaimer_(reclaimer), stripe_(Stripe()) {
+      epoch_ = reclaimer_->Enter(stripe_);
+    }
+
+    // Копия остаётся в той же эпохе, что и оригинал, поэтому защищает
+    // те же узлы.
+    Guard(const Guard &other) noexcept
+        : reclaimer_(other.reclaimer_),
+          epoch_(other.epoch_),
+          stripe_(other.stripe_) {
+      if (reclaimer_) reclaimer_->Counter(epoch_, stripe_).fetch_add(1);
+    }
+
+    Guard(Guard &&other) noexcept
+        : reclaimer_(other.reclaimer_),
+          epoch_(other.epoch_),
+          stripe_(other.stripe_) {
+      other.reclaimer_ = nullptr;
+    }
+
+    Guard &operator=(Guard other) noexcept {
+      std::swap(reclaimer_, other.reclaimer_);
+      std::swap(epoch_, other.epoch_);
+      std::swap(stripe_, other.stripe_);
+      return *this;
+    }
+
+    ~Guard() {
+      if (reclaimer_) reclaimer_->Counter(epoch_, stripe_).fetch_sub(1);
+    }
+
+   private:
+    const EpochReclaimer *reclaimer_;
+    size_t epoch_;
+    size_t stripe_;
+  };
+
+  EpochReclaimer() = default;
+  EpochReclaimer(const EpochReclaimer &) = delete;
+  EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+  // Вызывается изнутри Guard, после того как узел отцеплен.
+  void Retire(Retired *node) noexcept {
+    std::atomic<Retired *> &list = retired_[epoch_.load() % 3];
+    node->retired_next = list.load();
+    while (!list.compare_exchange_weak(node->retired_next, node)) {
+    }
+  }
+
+  // Продвигает эпоху, если в предыдущей не осталось читателей, и
+  // отдаёт free узлы, списанные до неё.
+  template <class Free>
+  void TryAdvance(Free free) noexcept {
+    uint64_t epoch = epoch_.load();
+    size_t previous = (epoch + 2) % 3;
+    for (size_t stripe = 0; stripe < kStripes; ++stripe)
+      if (Counter(previous, stripe).load()) return;
+    if (!epoch_.compare_exchange_strong(epoch, epoch + 1)) return;
+    FreeList(retired_[previous].exchange(nullptr), free);
+  }
+
+  // Освобождает всё списанное; только когда читателей больше нет.
+  template <class Free>
+  void Drain(Free free) noexcept {
+    for (auto &list : retired_) FreeList(list.exchange(nullptr), free);
+  }
+
+ private:
+  static constexpr size_t kStripes = 16;
+
+  struct alignas(64) PaddedCounter {
+    std::atomic<long> value{0};
+  };
+
+  static size_t Stripe() noexcept {
+    thread_local size_t stripe =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % kStripes;
+    return stripe;
+  }
+
+  std::atomic<long> &Counter(size_t epoch, size_t stripe) const noexcept {
+    return counters_[epoch][stripe].value;
+  }
+
+  // Вход в текущую эпоху; повтор, только если эпоха сменилась между
+  // чтением и отметкой.
+  size_t Enter(size_t stripe) const noexcept {
+    for (;;) {
+      uint64_t epoch = epoch_.load();
+      std::atomic<long> &counter = Counter(epoch % 3, stripe);
+      counter.fetch_add(1);
+      if (epoch_.load() == epoch) return epoch % 3;
+      counter.fetch_sub(1);
+    }
+  }
+
+  template <class Free>
+  static void FreeList(Retired *node, Free free) noexcept {
+    while (node) {
+      Retired *next = node->retired_next;
+      free(node);
+      node = next;
+    }
+  }
+
+  std::atomic<uint64_t> epoch_{0};
+  mutable PaddedCounter counters_[3][kStripes];
+  std::atomic<Retired *> retired_[3] = {};
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_EPOCH_H
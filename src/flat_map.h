@@ -0,0 +1,17 @@
+#ifndef STLCONTAINERS_FLAT_MAP_H
+#define STLCONTAINERS_FLAT_MAP_H
+
+#include "flat_tree.h"
+#include "my_map.h"
+
+namespace STL {
+
+// map поверх упорядоченного массива: тот же интерфейс, меньше памяти и
+// быстрее поиск, но вставка и удаление за O(n). Из map с другим
+// бэкендом собирается за O(n) явным конструктором.
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>>
+using flat_map = map<Key, T, Compare, Allocator, NoAugment, FlatBackend>;
+}  // namespace STL
+
+#endif  // STLCONTAINERS_FLAT_MAP_H
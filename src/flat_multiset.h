@@ -0,0 +1,17 @@
+#ifndef STLCONTAINERS_FLAT_MULTISET_H
+#define STLCONTAINERS_FLAT_MULTISET_H
+
+#include "flat_tree.h"
+#include "my_multiset.h"
+
+namespace STL {
+
+// multiset поверх упорядоченного массива: тот же интерфейс, меньше памяти и
+// быстрее поиск, но вставка и удаление за O(n). Из multiset с другим
+// бэкендом собирается за O(n) явным конструктором.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+using flat_multiset = multiset<T, Compare, Allocator, NoAugment, FlatBackend>;
+}  // namespace STL
+
+#endif  // STLCONTAINERS_FLAT_MULTISET_H
@@ -0,0 +1,17 @@
+#ifndef STLCONTAINERS_FLAT_SET_H
+#define STLCONTAINERS_FLAT_SET_H
+
+#include "flat_tree.h"
+#include "my_set.h"
+
+namespace STL {
+
+// set поверх упорядоченного массива: тот же интерфейс, меньше памяти и
+// быстрее поиск, но вставка и удаление за O(n). Из set с другим
+// бэкендом собирается за O(n) явным конструктором.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+using flat_set = set<T, Compare, Allocator, NoAugment, FlatBackend>;
+}  // namespace STL
+
+#endif  // STLCONTAINERS_FLAT_SET_H
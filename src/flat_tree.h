@@ -0,0 +1,375 @@
+#ifndef STLCONTAINERS_FLAT_TREE_H
+#define STLCONTAINERS_FLAT_TREE_H
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "drevo.h"
+
+namespace STL {
+
+// Упорядоченный массив с интерфейсом Tree. Поиск - бинарный без
+// ветвлений, вставка и удаление сдвигают хвост за O(n). Подходит для
+// таблиц, которые собираются один раз и потом в основном читаются.
+// Любое изменение делает итераторы и ссылки недействительными. Итератор
+// - это номер в массиве конкретного дерева, поэтому swap и перемещение
+// тоже их инвалидируют, в отличие от остальных бэкендов.
+template <class T, class KeyOfValue = Identity<T>,
+          class Compare = std::less<TreeKey<T, KeyOfValue>>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment>
+class FlatTree {
+  static_assert(std::is_same_v<Augment, NoAugment>,
+                "FlatTree does not support node augmentation");
+
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const FlatTree *tree, size_t index)
+        : tree_(tree), index_(index) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(tree_, index_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.tree_, other.index_) {}
+
+    Iterator &operator++() {
+      if (index_ == tree_->size()) throw std::out_of_range("Out of range");
+      ++index_;
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    Iterator &operator--() {
+      if (!index_) throw std::out_of_range("Out of range");
+      --index_;
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    reference operator*() const {
+      if (index_ == tree_->size()) throw std::logic_error("nullptr");
+      return const_cast<T &>(tree_->data_[index_]);
+    }
+
+    bool operator==(const Iterator &other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const FlatTree *tree_;
+    size_t index_;
+    friend FlatTree;
+    friend Iterator<!Const>;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatTree() : FlatTree(Compare(), Allocator()) {}
+
+  explicit FlatTree(const Allocator &alloc) : FlatTree(Compare(), alloc) {}
+
+  explicit FlatTree(const Compare &comp, const Allocator &alloc = Allocator())
+      : comp_(comp), data_(value_allocator(alloc)) {}
+
+  FlatTree(const FlatTree &other) = default;
+  FlatTree(FlatTree &&other) noexcept = default;
+  FlatTree &operator=(const FlatTree &other) = default;
+  FlatTree &operator=(FlatTree &&other) = default;
+  ~FlatTree() = default;
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  iterator InsertEqual(const T &value) { return EmplaceEqual(value); }
+
+  iterator InsertEqual(T &&value) { return EmplaceEqual(std::move(value)); }
+
+  std::pair<iterator, bool> InsertUnique(iterator, const T &value) {
+    return InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator, T &&value) {
+    return InsertUnique(std::move(value));
+  }
+
+  iterator InsertEqual(iterator, const T &value) { return InsertEqual(value); }
+
+  iterator InsertEqual(iterator, T &&value) {
+    return InsertEqual(std::move(value));
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    size_t pos = LowerIndex(key);
+    if (pos != data_.size() && !comp_(key, KeyOf(pos)))
+      return std::make_pair(iterator(this, pos), false);
+    data_.emplace(data_.begin() + pos, std::forward<Args>(args)...);
+    return std::make_pair(iterator(this, pos), true);
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceHintUnique(iterator, const K &key,
+                                                 Args &&...args) {
+    return TryEmplaceUnique(key, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    T value(std::forward<Args>(args)...);
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceHintUnique(iterator, Args &&...args) {
+    return EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator EmplaceEqual(Args &&...args) {
+    T value(std::forward<Args>(args)...);
+    size_t pos = UpperIndex(KeyOfValue()(value));
+    data_.insert(data_.begin() + pos, std::move(value));
+    return iterator(this, pos);
+  }
+
+  template <class... Args>
+  iterator EmplaceHintEqual(iterator, Args &&...args) {
+    return EmplaceEqual(std::forward<Args>(args)...);
+  }
+
+  // Диапазон копируется целиком и сортируется, только если он ещё не
+  // упорядочен; из равных ключей остаётся первый.
+  template <class InputIt>
+  void AssignSorted(InputIt first, InputIt last) {
+    auto less = [this](const T &lhs, const T &rhs) {
+      return comp_(KeyOfValue()(lhs), KeyOfValue()(rhs));
+    };
+    data_.assign(first, last);
+    if (!std::is_sorted(data_.begin(), data_.end(), less))
+      std::stable_sort(data_.begin(), data_.end(), less);
+  }
+
+  template <class InputIt>
+  void AssignSortedUnique(InputIt first, InputIt last) {
+    AssignSorted(first, last);
+    auto equal = [this](const T &lhs, const T &rhs) {
+      return !comp_(KeyOfValue()(lhs), KeyOfValue()(rhs));
+    };
+    data_.erase(std::unique(data_.begin(), data_.end(), equal), data_.end());
+  }
+
+  // Слияние двух упорядоченных массивов за O(n + m). Равные элементы
+  // other идут после своих; для уникальных ключей они остаются в other.
+  void MergeUnique(FlatTree &other) { Merge<true>(other); }
+  void MergeEqual(FlatTree &other) { Merge<false>(other); }
+
+  void UniteUnique(const FlatTree &other) {
+    if (this == &other) return;
+    FlatTree copy(other);
+    Merge<true>(copy);
+  }
+
+  // Пересечение и разность за один проход по обоим массивам.
+  void IntersectUnique(const FlatTree &other) noexcept(kNothrowFilter) {
+    if (this == &other) return;
+    Filter(other, true);
+  }
+
+  void SubtractUnique(const FlatTree &other) noexcept(kNothrowFilter) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    Filter(other, false);
+  }
+
+  iterator erase(iterator pos) noexcept {
+    data_.erase(data_.begin() + pos.index_);
+    return pos;
+  }
+
+  void clear() noexcept { data_.clear(); }
+
+  template <class K>
+  iterator FindTreeNode(const K &key) const {
+    size_t pos = LowerIndex(key);
+    if (pos != data_.size() && comp_(key, KeyOf(pos))) pos = data_.size();
+    return iterator(this, pos);
+  }
+
+  template <class K>
+  iterator LowerBound(const K &key) const {
+    return iterator(this, LowerIndex(key));
+  }
+
+  template <class K>
+  iterator UpperBound(const K &key) const {
+    return iterator(this, UpperIndex(key));
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> EqualRange(const K &key) const {
+    return std::make_pair(LowerBound(key), UpperBound(key));
+  }
+
+  // Порядковые статистики массиву достаются даром: k-й элемент - за
+  // O(1), ранг - одним бинарным поиском.
+  iterator Select(size_t k) const {
+    return iterator(this, k < data_.size() ? k : data_.size());
+  }
+
+  template <class K>
+  size_t Rank(const K &key) const {
+    return LowerIndex(key);
+  }
+
+  void Refresh(iterator) noexcept {}
+
+  iterator begin() noexcept { return iterator(this, 0); }
+
+  iterator end() noexcept { return iterator(this, data_.size()); }
+
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+
+  const_iterator end() const noexcept {
+    return const_iterator(this, data_.size());
+  }
+
+  size_t size() const noexcept { return data_.size(); }
+
+  key_compare key_comp() const { return comp_; }
+
+  allocator_type get_allocator() const {
+    return allocator_type(data_.get_allocator());
+  }
+
+ private:
+  using value_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<T>;
+
+  const key_type &KeyOf(size_t index) const noexcept {
+    return KeyOfValue()(data_[index]);
+  }
+
+  // Бинарный поиск без ветвлений: на каждом шаге база сдвигается
+  // условным присваиванием, которое компилятор превращает в cmov, а
+  // число шагов зависит только от размера массива.
+  template <class K, class Less>
+  size_t BranchlessSearch(const K &key, Less less) const {
+    size_t length = data_.size();
+    if (!length) return 0;
+    const T *base = data_.data();
+    while (length > 1) {
+      size_t half = length / 2;
+      base = less(KeyOfValue()(base[half - 1]), key) ? base + half : base;
+      length -= half;
+    }
+    return size_t(base - data_.data()) + less(KeyOfValue()(*base), key);
+  }
+
+  template <class K>
+  size_t LowerIndex(const K &key) const {
+    return BranchlessSearch(key, [this](const auto &lhs, const auto &rhs) {
+      return comp_(lhs, rhs);
+    });
+  }
+
+  template <class K>
+  size_t UpperIndex(const K &key) const {
+    return BranchlessSearch(key, [this](const auto &lhs, const auto &rhs) {
+      return !comp_(rhs, lhs);
+    });
+  }
+
+  template <bool Unique>
+  void Merge(FlatTree &other) {
+    if (this == &other || other.data_.empty()) return;
+    std::vector<T, value_allocator> merged(data_.get_allocator());
+    std::vector<T, value_allocator> rest(other.data_.get_allocator());
+    merged.reserve(data_.size() + other.data_.size());
+    auto own = data_.begin();
+    for (auto it = other.data_.begin(); it != other.data_.end(); ++it) {
+      const key_type &key = KeyOfValue()(*it);
+      while (own != data_.end() && !comp_(key, KeyOfValue()(*own)))
+        merged.push_back(std::move(*own++));
+      if (Unique && !merged.empty() &&
+          !comp_(KeyOfValue()(merged.back()), key))
+        rest.push_back(std::move(*it));
+      else
+        merged.push_back(std::move(*it));
+    }
+    std::move(own, data_.end(), std::back_inserter(merged));
+    data_ = std::move(merged);
+    other.data_ = std::move(rest);
+  }
+
+  // Проход сравнивает ключи и сдвигает значения, так что не бросает,
+  // только если не бросают Compare и перемещающее присваивание T.
+  static constexpr bool kNothrowFilter =
+      std::is_nothrow_invocable_v<const Compare &, const key_type &,
+                                  const key_type &> &&
+      std::is_nothrow_move_assignable_v<T>;
+
+  void Filter(const FlatTree &other, bool keep_common) noexcept(
+      kNothrowFilter) {
+    auto theirs = other.data_.begin();
+    auto last = std::remove_if(data_.begin(), data_.end(), [&](const T &v) {
+      const key_type &key = KeyOfValue()(v);
+      while (theirs != other.data_.end() &&
+             comp_(KeyOfValue()(*theirs), key))
+        ++theirs;
+      bool common =
+          theirs != other.data_.end() && !comp_(key, KeyOfValue()(*theirs));
+      return common != keep_common;
+    });
+    data_.erase(last, data_.end());
+  }
+
+  Compare comp_;
+  std::vector<T, value_allocator> data_;
+};
+
+// Бэкенд на упорядоченном массиве для map, set и multiset.
+struct FlatBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = FlatTree<T, KeyOfValue, Compare, Allocator, Augment>;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_FLAT_TREE_H
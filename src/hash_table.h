@@ -0,0 +1,571 @@
+#ifndef STLCONTAINERS_HASH_TABLE_H
+#define STLCONTAINERS_HASH_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include "drevo.h"
+#include "simd_search.h"
+
+namespace STL {
+
+// Хеш и равенство с is_transparent разрешают искать ключом другого
+// типа, как прозрачный компаратор в деревьях.
+template <class Hash, class KeyEqual>
+struct IsHashTransparent
+    : std::bool_constant<IsTransparent<Hash>::value &&
+                         IsTransparent<KeyEqual>::value> {};
+
+// std::hash для целых - тождество, а таблице нужны и старшие биты
+// (номер группы), и младшие (байт слота). Умножение на нечётную
+// константу и свёртка половин перемешивают их.
+inline size_t MixHash(size_t hash) noexcept {
+  uint64_t mixed = uint64_t(hash) * 0x9e3779b97f4a7c15ull;
+  return size_t(mixed ^ (mixed >> 32));
+}
+
+// Группа управляющих байтов, которые проверяются за одну команду. Байт
+// слота: 0..127 - занят (младшие 7 бит хеша), kEmpty - свободен,
+// kDeleted - удалён.
+struct HashGroup {
+  static constexpr size_t kWidth = 16;
+  static constexpr signed char kEmpty = -128;
+  static constexpr signed char kDeleted = -2;
+
+#ifdef STL_SIMD_X86
+  explicit HashGroup(const signed char *ctrl) noexcept
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+  uint32_t Match(signed char h2) const noexcept {
+    return uint32_t(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2))));
+  }
+
+  uint32_t MatchEmpty() const noexcept { return Match(kEmpty); }
+
+  uint32_t MatchEmptyOrDeleted() const noexcept {
+    return uint32_t(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_)));
+  }
+
+  uint32_t MatchFull() const noexcept {
+    return uint32_t(~_mm_movemask_epi8(ctrl_)) & 0xffffu;
+  }
+
+ private:
+  __m128i ctrl_;
+#else
+  explicit HashGroup(const signed char *ctrl) noexcept {
+    std::memcpy(ctrl_, ctrl, kWidth);
+  }
+
+  uint32_t Match(signed char h2) const noexcept {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; ++i) mask |= uint32_t(ctrl_[i] == h2) << i;
+    return mask;
+  }
+
+  uint32_t MatchEmpty() const noexcept { return Match(kEmpty); }
+
+  uint32_t MatchEmptyOrDeleted() const noexcept {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; ++i) mask |= uint32_t(ctrl_[i] < -1) << i;
+    return mask;
+  }
+
+  uint32_t MatchFull() const noexcept {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kWidth; ++i) mask |= uint32_t(ctrl_[i] >= 0) << i;
+    return mask;
+  }
+
+ private:
+  signed char ctrl_[kWidth];
+#endif
+};
+
+// Хеш-таблица с открытой адресацией в духе SwissTable: значения лежат в
+// массиве слотов, рядом - массив управляющих байтов, и пробирование
+// идёт группами по 16 байт. Ёмкость - степень двойки; первые kWidth
+// управляющих байтов продублированы в конце, чтобы группа читалась без
+// проверки на перенос. Рехеширование делает итераторы и ссылки
+// недействительными.
+template <class T, class KeyOfValue, class Hash, class KeyEqual,
+          class Allocator>
+class HashTable {
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+
+  // Поиск ключа типа K не бросает, только если не бросают hasher и
+  // key_equal; от этого зависит noexcept удаления по ключу и фильтров.
+  template <class K = key_type>
+  static constexpr bool kNothrowLookup =
+      std::is_nothrow_invocable_v<const Hash &, const K &> &&
+      std::is_nothrow_invocable_v<const KeyEqual &, const key_type &,
+                                  const K &>;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const HashTable *table, size_t index)
+        : table_(table), index_(index) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(table_, index_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.table_, other.index_) {}
+
+    Iterator &operator++() {
+      if (index_ == table_->capacity_) throw std::out_of_range("Out of range");
+      index_ = table_->NextFull(index_ + 1);
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    reference operator*() const {
+      if (index_ == table_->capacity_) throw std::logic_error("nullptr");
+      return table_->slots_[index_];
+    }
+
+    bool operator==(const Iterator &other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const HashTable *table_;
+    size_t index_;
+    friend HashTable;
+    friend Iterator<!Const>;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  HashTable() : HashTable(0) {}
+
+  explicit HashTable(size_t buckets, const Hash &hash = Hash(),
+                     const KeyEqual &equal = KeyEqual(),
+                     const Allocator &alloc = Allocator())
+      : hash_(hash), equal_(equal), alloc_(alloc) {
+    if (buckets) Resize(CapacityFor(buckets));
+  }
+
+  HashTable(const HashTable &other)
+      : hash_(other.hash_),
+        equal_(other.equal_),
+        alloc_(slot_traits::select_on_container_copy_construction(
+            other.alloc_)),
+        max_load_factor_(other.max_load_factor_) {
+    CopyFrom(other);
+  }
+
+  HashTable(HashTable &&other) noexcept
+      : hash_(other.hash_),
+        equal_(other.equal_),
+        alloc_(std::move(other.alloc_)),
+        max_load_factor_(other.max_load_factor_) {
+    StealState(other);
+  }
+
+  HashTable &operator=(const HashTable &other) {
+    if (this == &other) return *this;
+    Release();
+    if (slot_traits::propagate_on_container_copy_assignment::value)
+      alloc_ = other.alloc_;
+    hash_ = other.hash_;
+    equal_ = other.equal_;
+    max_load_factor_ = other.max_load_factor_;
+    CopyFrom(other);
+    return *this;
+  }
+
+  HashTable &operator=(HashTable &&other) noexcept(
+      slot_traits::propagate_on_container_move_assignment::value ||
+      slot_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    Release();
+    hash_ = other.hash_;
+    equal_ = other.equal_;
+    max_load_factor_ = other.max_load_factor_;
+    if (!slot_traits::propagate_on_container_move_assignment::value &&
+        !(alloc_ == other.alloc_)) {
+      CopyFrom(other);
+      other.clear();
+      return *this;
+    }
+    if (slot_traits::propagate_on_container_move_assignment::value)
+      alloc_ = std::move(other.alloc_);
+    StealState(other);
+    return *this;
+  }
+
+  ~HashTable() { Release(); }
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  // Значение строится, только если ключа ещё нет.
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    size_t hash = HashOf(key);
+    size_t found = FindIndex(key, hash);
+    if (found != capacity_) return std::make_pair(iterator(this, found), false);
+    size_t index = PrepareInsert(hash);
+    slot_traits::construct(alloc_, slots_ + index, std::forward<Args>(args)...);
+    CommitInsert(index, hash);
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    T value(std::forward<Args>(args)...);
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  // Элементы other, ключей которых ещё нет, переезжают сюда; остальные
+  // остаются в other.
+  void MergeUnique(HashTable &other) {
+    if (this == &other) return;
+    for (size_t i = other.NextFull(0); i != other.capacity_;
+         i = other.NextFull(i + 1)) {
+      T &value = other.slots_[i];
+      if (TryEmplaceUnique(KeyOfValue()(value), std::move(value)).second)
+        other.EraseIndex(i);
+    }
+  }
+
+  void UniteUnique(const HashTable &other) {
+    if (this == &other) return;
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      InsertUnique(*it);
+  }
+
+  void IntersectUnique(const HashTable &other) noexcept(kNothrowLookup<>) {
+    if (this == &other) return;
+    Filter([&other](const key_type &key) {
+      return other.Find(key) != other.end();
+    });
+  }
+
+  void SubtractUnique(const HashTable &other) noexcept(kNothrowLookup<>) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    Filter([&other](const key_type &key) {
+      return other.Find(key) == other.end();
+    });
+  }
+
+  iterator erase(iterator pos) noexcept {
+    EraseIndex(pos.index_);
+    return iterator(this, NextFull(pos.index_ + 1));
+  }
+
+  template <class K>
+  size_t EraseKey(const K &key) noexcept(kNothrowLookup<K>) {
+    size_t index = FindIndex(key, HashOf(key));
+    if (index == capacity_) return 0;
+    EraseIndex(index);
+    return 1;
+  }
+
+  void clear() noexcept {
+    if (!capacity_) return;
+    DestroySlots();
+    std::memset(ctrl_, HashGroup::kEmpty, capacity_ + HashGroup::kWidth);
+    size_ = 0;
+    growth_left_ = GrowthLimit(capacity_);
+  }
+
+  template <class K>
+  iterator Find(const K &key) const {
+    return iterator(this, FindIndex(key, HashOf(key)));
+  }
+
+  iterator begin() noexcept { return iterator(this, NextFull(0)); }
+
+  iterator end() noexcept { return iterator(this, capacity_); }
+
+  const_iterator begin() const noexcept {
+    return const_iterator(this, NextFull(0));
+  }
+
+  const_iterator end() const noexcept {
+    return const_iterator(this, capacity_);
+  }
+
+  size_t size() const noexcept { return size_; }
+
+  size_t bucket_count() const noexcept { return capacity_; }
+
+  float load_factor() const noexcept {
+    return capacity_ ? float(size_) / float(capacity_) : 0.0f;
+  }
+
+  float max_load_factor() const noexcept { return max_load_factor_; }
+
+  // Пробирование держится на том, что в таблице всегда есть пустой
+  // слот, поэтому коэффициент ограничен сверху 15/16.
+  void max_load_factor(float factor) {
+    if (!(factor > 0.0f)) throw std::invalid_argument("Invalid load factor");
+    max_load_factor_ = factor < kMaxLoadFactor ? factor : kMaxLoadFactor;
+    if (size_ > GrowthLimit(capacity_))
+      Resize(CapacityFor(size_));
+    else if (capacity_)
+      Resize(capacity_);
+  }
+
+  // Ёмкость хотя бы на buckets слотов и на size() элементов.
+  void rehash(size_t buckets) {
+    size_t capacity = CapacityFor(size_);
+    while (capacity < buckets) capacity *= 2;
+    if (!size_ && !buckets) {
+      Release();
+      return;
+    }
+    Resize(capacity);
+  }
+
+  // Вставки до count элементов после reserve(count) не перестраивают
+  // таблицу. Удалённые слоты не возвращают запас роста, поэтому
+  // считается growth_left_, а не ёмкость.
+  void reserve(size_t count) {
+    if (count > size_ + growth_left_) Resize(CapacityFor(count));
+  }
+
+  hasher hash_function() const { return hash_; }
+
+  key_equal key_eq() const { return equal_; }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+ private:
+  using slot_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<T>;
+  using slot_traits = std::allocator_traits<slot_allocator>;
+  using ctrl_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<signed char>;
+  using ctrl_traits = std::allocator_traits<ctrl_allocator>;
+
+  static constexpr float kMaxLoadFactor = 0.9375f;
+
+  template <class K>
+  size_t HashOf(const K &key) const {
+    return MixHash(hash_(key));
+  }
+
+  static size_t H1(size_t hash) noexcept { return hash >> 7; }
+
+  static signed char H2(size_t hash) noexcept {
+    return static_cast<signed char>(hash & 0x7f);
+  }
+
+  size_t GrowthLimit(size_t capacity) const noexcept {
+    if (!capacity) return 0;
+    size_t limit = size_t(float(capacity) * max_load_factor_);
+    return limit < capacity ? limit : capacity - 1;
+  }
+
+  size_t CapacityFor(size_t count) const noexcept {
+    size_t capacity = HashGroup::kWidth;
+    while (GrowthLimit(capacity) < count) capacity *= 2;
+    return capacity;
+  }
+
+  static size_t LowestBit(uint32_t mask) noexcept {
+    return size_t(__builtin_ctz(mask));
+  }
+
+  // Пробирование по треугольным числам групп обходит всю таблицу, если
+  // число групп - степень двойки.
+  template <class K>
+  size_t FindIndex(const K &key, size_t hash) const {
+    if (!capacity_) return 0;
+    size_t mask = capacity_ - 1;
+    size_t pos = H1(hash) & mask;
+    for (size_t step = HashGroup::kWidth;; step += HashGroup::kWidth) {
+      HashGroup group(ctrl_ + pos);
+      for (uint32_t match = group.Match(H2(hash)); match;
+           match &= match - 1) {
+        size_t index = (pos + LowestBit(match)) & mask;
+        if (equal_(KeyOfValue()(slots_[index]), key)) return index;
+      }
+      if (group.MatchEmpty()) return capacity_;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  size_t FindFirstNonFull(size_t hash) const noexcept {
+    size_t mask = capacity_ - 1;
+    size_t pos = H1(hash) & mask;
+    for (size_t step = HashGroup::kWidth;; step += HashGroup::kWidth) {
+      uint32_t free = HashGroup(ctrl_ + pos).MatchEmptyOrDeleted();
+      if (free) return (pos + LowestBit(free)) & mask;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  size_t NextFull(size_t index) const noexcept {
+    while (index < capacity_) {
+      uint32_t full = HashGroup(ctrl_ + index).MatchFull();
+      size_t left = capacity_ - index;
+      if (left < HashGroup::kWidth) full &= (uint32_t(1) << left) - 1;
+      if (full) return index + LowestBit(full);
+      index += HashGroup::kWidth;
+    }
+    return capacity_;
+  }
+
+  void SetCtrl(size_t index, signed char value) noexcept {
+    ctrl_[index] = value;
+    if (index < HashGroup::kWidth) ctrl_[capacity_ + index] = value;
+  }
+
+  // Место под новый элемент с хешем hash. Удалённые слоты тоже годятся,
+  // но только пустые уменьшают запас роста; когда запас кончился,
+  // таблица растёт или, если в ней в основном удалённые, пересобирается
+  // в той же ёмкости.
+  size_t PrepareInsert(size_t hash) {
+    if (!capacity_) {
+      Resize(HashGroup::kWidth);
+    } else if (!growth_left_) {
+      Resize(size_ * 2 < GrowthLimit(capacity_) ? capacity_ : capacity_ * 2);
+    }
+    return FindFirstNonFull(hash);
+  }
+
+  void CommitInsert(size_t index, size_t hash) noexcept {
+    if (ctrl_[index] == HashGroup::kEmpty) growth_left_--;
+    SetCtrl(index, H2(hash));
+    size_++;
+  }
+
+  void EraseIndex(size_t index) noexcept {
+    slot_traits::destroy(alloc_, slots_ + index);
+    SetCtrl(index, HashGroup::kDeleted);
+    size_--;
+  }
+
+  template <class Predicate>
+  void Filter(Predicate keep) {
+    for (size_t i = NextFull(0); i != capacity_; i = NextFull(i + 1))
+      if (!keep(KeyOfValue()(slots_[i]))) EraseIndex(i);
+  }
+
+  // Перекладывает элементы в новые массивы ёмкости capacity. Если
+  // перемещение может бросить, значения копируются, и при исключении
+  // старая таблица остаётся целой.
+  void Resize(size_t capacity) {
+    ctrl_allocator ctrl_alloc(alloc_);
+    signed char *ctrl =
+        ctrl_traits::allocate(ctrl_alloc, capacity + HashGroup::kWidth);
+    T *slots;
+    try {
+      slots = slot_traits::allocate(alloc_, capacity);
+    } catch (...) {
+      ctrl_traits::deallocate(ctrl_alloc, ctrl, capacity + HashGroup::kWidth);
+      throw;
+    }
+    std::memset(ctrl, HashGroup::kEmpty, capacity + HashGroup::kWidth);
+    HashTable fresh(hash_, equal_, alloc_, max_load_factor_);
+    fresh.ctrl_ = ctrl;
+    fresh.slots_ = slots;
+    fresh.capacity_ = capacity;
+    fresh.growth_left_ = fresh.GrowthLimit(capacity);
+    for (size_t i = NextFull(0); i != capacity_; i = NextFull(i + 1)) {
+      size_t hash = HashOf(KeyOfValue()(slots_[i]));
+      size_t index = fresh.FindFirstNonFull(hash);
+      slot_traits::construct(alloc_, slots + index,
+                             std::move_if_noexcept(slots_[i]));
+      fresh.CommitInsert(index, hash);
+    }
+    Release();
+    StealState(fresh);
+  }
+
+  HashTable(const Hash &hash, const KeyEqual &equal,
+            const slot_allocator &alloc, float max_load_factor)
+      : hash_(hash),
+        equal_(equal),
+        alloc_(alloc),
+        max_load_factor_(max_load_factor) {}
+
+  void CopyFrom(const HashTable &other) {
+    if (!other.size_) return;
+    Resize(CapacityFor(other.size_));
+    for (const_iterator it = other.begin(); it != other.end(); ++it) {
+      size_t hash = HashOf(KeyOfValue()(*it));
+      size_t index = FindFirstNonFull(hash);
+      slot_traits::construct(alloc_, slots_ + index, *it);
+      CommitInsert(index, hash);
+    }
+  }
+
+  void DestroySlots() noexcept {
+    for (size_t i = NextFull(0); i != capacity_; i = NextFull(i + 1))
+      slot_traits::destroy(alloc_, slots_ + i);
+  }
+
+  void Release() noexcept {
+    if (!capacity_) return;
+    DestroySlots();
+    ctrl_allocator ctrl_alloc(alloc_);
+    ctrl_traits::deallocate(ctrl_alloc, ctrl_, capacity_ + HashGroup::kWidth);
+    slot_traits::deallocate(alloc_, slots_, capacity_);
+    ctrl_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = size_ = growth_left_ = 0;
+  }
+
+  void StealState(HashTable &other) noexcept {
+    ctrl_ = other.ctrl_;
+    slots_ = other.slots_;
+    capacity_ = other.capacity_;
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+    other.ctrl_ = nullptr;
+    other.slots_ = nullptr;
+    other.capacity_ = other.size_ = other.growth_left_ = 0;
+  }
+
+  Hash hash_;
+  KeyEqual equal_;
+  slot_allocator alloc_;
+  float max_load_factor_ = 0.875f;
+  signed char *ctrl_ = nullptr;
+  T *slots_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t growth_left_ = 0;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_HASH_TABLE_H
@@ -0,0 +1,149 @@
+#ifndef STLCONTAINERS_LOCKFREE_MAP_H
+#define STLCONTAINERS_LOCKFREE_MAP_H
+
+#include "skip_list.h"
+
+namespace STL {
+
+// map без блокировок на списке с пропусками, см. lockfree_set. Значение
+// неизменно, пока пара в контейнере: читатели видят его без
+// синхронизации. Заменить значение можно только через erase и insert,
+// поэтому at() возвращает копию, а operator[] нет.
+template <class T, class K, class Compare = std::less<T>,
+          class Allocator = std::allocator<std::pair<T, K>>>
+class lockfree_map {
+ public:
+  using key_type = T;
+  using value_type = K;
+  using tree_type = std::pair<T, K>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using list_type =
+      SkipList<tree_type, SelectFirst<tree_type>, Compare, Allocator>;
+  using reference = const tree_type &;
+  using const_reference = const tree_type &;
+  using iterator = typename list_type::iterator;
+  using const_iterator = typename list_type::const_iterator;
+  using size_type = size_t;
+
+  lockfree_map() {}
+
+  explicit lockfree_map(const Compare &comp,
+                        const Allocator &alloc = Allocator())
+      : List(comp, alloc) {}
+
+  explicit lockfree_map(std::initializer_list<tree_type> const &values)
+      : lockfree_map(values.begin(), values.end()) {}
+
+  template <class InputIt, class = RequireIterator<InputIt>>
+  lockfree_map(InputIt first, InputIt last, const Compare &comp = Compare(),
+               const Allocator &alloc = Allocator())
+      : List(comp, alloc) {
+    for (; first != last; ++first) List.InsertUnique(*first);
+  }
+
+  lockfree_map(const lockfree_map &) = delete;
+  lockfree_map &operator=(const lockfree_map &) = delete;
+
+  ~lockfree_map() {}
+
+  K at(const T &key) const {
+    iterator it(List.Find(key));
+    if (it == end()) throw std::out_of_range("Incorrect index");
+    return (*it).second;
+  }
+
+  iterator begin() const { return List.begin(); }
+
+  iterator end() const noexcept { return List.end(); }
+
+  key_compare key_comp() const { return List.key_comp(); }
+
+  allocator_type get_allocator() const { return List.get_allocator(); }
+
+  bool empty() const noexcept { return List.size() ? false : true; }
+
+  size_type size() const noexcept { return List.size(); }
+
+  void clear() { List.clear(); }
+
+  std::pair<iterator, bool> insert(const tree_type &value) {
+    return List.InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> insert(tree_type &&value) {
+    return List.InsertUnique(std::move(value));
+  }
+
+  std::pair<iterator, bool> insert(const T &key, const K &obj) {
+    return try_emplace(key, obj);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    return List.EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  // Пара строится, только если ключа ещё нет.
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const T &key, Args &&...args) {
+    return List.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(T &&key, Args &&...args) {
+    return List.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  size_type erase(const T &key) { return List.EraseUnique(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type erase(const Key &key) {
+    return List.EraseUnique(key);
+  }
+
+  iterator find(const T &key) const { return List.Find(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator find(const Key &key) const {
+    return List.Find(key);
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  bool contains(const T &key) const { return List.Contains(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  bool contains(const Key &key) const {
+    return List.Contains(key);
+  }
+
+  iterator lower_bound(const T &key) const { return List.LowerBound(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator lower_bound(const Key &key) const {
+    return List.LowerBound(key);
+  }
+
+  iterator upper_bound(const T &key) const { return List.UpperBound(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator upper_bound(const Key &key) const {
+    return List.UpperBound(key);
+  }
+
+ private:
+  list_type List;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_LOCKFREE_MAP_H
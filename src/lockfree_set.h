@@ -0,0 +1,124 @@
+#ifndef STLCONTAINERS_LOCKFREE_SET_H
+#define STLCONTAINERS_LOCKFREE_SET_H
+
+#include "skip_list.h"
+
+namespace STL {
+
+// set для нагрузки, где чтений намного больше, чем записей: список с
+// пропусками без блокировок. find, contains, lower_bound и обход
+// никогда не ждут писателей, а вставки и удаления не ждут друг друга.
+// Итераторы только на чтение и держат эпоху: узел под итератором не
+// освобождается, пока итератор жив, поэтому долго живущий итератор
+// задерживает освобождение памяти, но никого не блокирует.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+class lockfree_set {
+ public:
+  using key_type = T;
+  using value_type = T;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using list_type = SkipList<T, Identity<T>, Compare, Allocator>;
+  using reference = const T &;
+  using const_reference = const T &;
+  using iterator = typename list_type::iterator;
+  using const_iterator = typename list_type::const_iterator;
+  using size_type = size_t;
+
+  lockfree_set() {}
+
+  explicit lockfree_set(const Compare &comp,
+                        const Allocator &alloc = Allocator())
+      : List(comp, alloc) {}
+
+  explicit lockfree_set(std::initializer_list<T> const &values)
+      : lockfree_set(values.begin(), values.end()) {}
+
+  template <class InputIt, class = RequireIterator<InputIt>>
+  lockfree_set(InputIt first, InputIt last, const Compare &comp = Compare(),
+               const Allocator &alloc = Allocator())
+      : List(comp, alloc) {
+    for (; first != last; ++first) List.InsertUnique(*first);
+  }
+
+  lockfree_set(const lockfree_set &) = delete;
+  lockfree_set &operator=(const lockfree_set &) = delete;
+
+  ~lockfree_set() {}
+
+  iterator begin() const { return List.begin(); }
+
+  iterator end() const noexcept { return List.end(); }
+
+  key_compare key_comp() const { return List.key_comp(); }
+
+  allocator_type get_allocator() const { return List.get_allocator(); }
+
+  bool empty() const noexcept { return List.size() ? false : true; }
+
+  size_type size() const noexcept { return List.size(); }
+
+  void clear() { List.clear(); }
+
+  std::pair<iterator, bool> insert(const T &value) {
+    return List.InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> insert(T &&value) {
+    return List.InsertUnique(std::move(value));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    return List.EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  size_type erase(const T &key) { return List.EraseUnique(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type erase(const Key &key) {
+    return List.EraseUnique(key);
+  }
+
+  iterator find(const T &key) const { return List.Find(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator find(const Key &key) const {
+    return List.Find(key);
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  bool contains(const T &key) const { return List.Contains(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  bool contains(const Key &key) const {
+    return List.Contains(key);
+  }
+
+  iterator lower_bound(const T &key) const { return List.LowerBound(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator lower_bound(const Key &key) const {
+    return List.LowerBound(key);
+  }
+
+  iterator upper_bound(const T &key) const { return List.UpperBound(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator upper_bound(const Key &key) const {
+    return List.UpperBound(key);
+  }
+
+ private:
+  list_type List;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_LOCKFREE_SET_H
@@ -5,26 +5,64 @@
 
 namespace STL {
 
-template <class T, class K>
+// Backend выбирает дерево под map. С AvlBackend итераторы и ссылки
+// переживают вставку и удаление других элементов; у других бэкендов
+// гарантии свои (для BTreeBackend см. btree.h).
+template <class T, class K, class Compare = std::less<T>,
+          class Allocator = std::allocator<std::pair<T, K>>,
+          class Augment = NoAugment, class Backend = AvlBackend>
 class map {
  public:
   using key_type = T;
   using value_type = K;
   using tree_type = std::pair<T, K>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using avl_tree_type =
+      typename Backend::template tree<tree_type, SelectFirst<tree_type>,
+                                      Compare, Allocator, Augment>;
   using reference = tree_type &;
   using const_reference = const tree_type &;
-  using iterator = typename Tree<tree_type>::iterator;
-  using const_iterator = typename Tree<tree_type>::const_iterator;
+  using iterator = typename avl_tree_type::iterator;
+  using const_iterator = typename avl_tree_type::const_iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
   using size_type = size_t;
+  // Значения, которые читает Augment (например, Sum по SelectSecond),
+  // at и [] отдают только для чтения; менять их - через
+  // insert_or_assign или modify.
+  using mapped_reference =
+      std::conditional_t<ReadsElements<Augment>::value, const K &, K &>;
+  using node_type = typename NodeTypeOf<avl_tree_type>::type;
+  using insert_return_type = InsertReturn<iterator, node_type>;
 
   map() {}
 
+  explicit map(const Allocator &alloc) : AVLTree(alloc) {}
+
+  explicit map(const Compare &comp, const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {}
+
   explicit map(std::initializer_list<tree_type> const &values) {
-    for (auto val : values) {
-      insert(val);
-    }
+    AVLTree.AssignSortedUnique(values.begin(), values.end());
+  }
+
+  // Отсортированный диапазон собирается за O(n), остальные сортируются.
+  template <class InputIt, class = RequireIterator<InputIt>>
+  map(InputIt first, InputIt last, const Compare &comp = Compare(),
+      const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {
+    AVLTree.AssignSortedUnique(first, last);
   }
 
+  // Перенос из контейнера с другим бэкендом или Augment: элементы
+  // other уже упорядочены, поэтому сортировки нет.
+  template <class OtherAugment, class OtherBackend>
+  explicit map(
+      const map<T, K, Compare, Allocator, OtherAugment, OtherBackend> &other)
+      : map(other.begin(), other.end(), other.key_comp(),
+            other.get_allocator()) {}
+
   map(const map &other) : AVLTree(other.AVLTree) {}
 
   map(map &&other) : AVLTree(std::move(other.AVLTree)) {}
@@ -41,66 +79,381 @@ class map {
 
   ~map() {}
 
-  K &at(const T &key) const {
-    TreeNode<tree_type> *t = AVLTree.FindMapTreeNode(std::make_pair(key, 0));
-    if (!(t)) throw std::out_of_range("Incorrect index");
-    return t->key.second;
+  mapped_reference at(const T &key) {
+    iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Incorrect index");
+    return (*it).second;
+  }
+
+  const K &at(const T &key) const {
+    const_iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Incorrect index");
+    return (*it).second;
+  }
+
+  mapped_reference operator[](const T &key) {
+    return (*try_emplace(key).first).second;
+  }
+
+  mapped_reference operator[](T &&key) {
+    return (*try_emplace(std::move(key)).first).second;
+  }
+
+  // Константные методы отдают const_iterator: с PersistentBackend
+  // чтение через него никогда не копирует узлы.
+  iterator begin() noexcept { return AVLTree.begin(); }
+
+  const_iterator begin() const noexcept { return AVLTree.begin(); }
+
+  iterator end() noexcept { return AVLTree.end(); }
+
+  const_iterator end() const noexcept { return AVLTree.end(); }
+
+  // Обход с конца: шаг назад от end() попадает в последний элемент, у
+  // AvlBackend - за O(1).
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
   }
-  K &operator[](const T &key) {
-    bool status = contains(key);
-    if (!status) insert(key, K{});
-    return at(key);
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
   }
 
-  iterator begin() const noexcept { return AVLTree.begin(); }
+  // Первый и последний элементы; на пустом контейнере - исключение.
+  reference front() { return *begin(); }
+
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *rbegin(); }
 
-  iterator end() const noexcept { return AVLTree.end(); }
+  const_reference back() const { return *rbegin(); }
+
+  key_compare key_comp() const { return AVLTree.key_comp(); }
+
+  allocator_type get_allocator() const { return AVLTree.get_allocator(); }
 
   bool empty() const noexcept { return AVLTree.size() ? false : true; }
 
   size_type size() const noexcept { return AVLTree.size(); }
 
+  // Счётчики дерева; ненулевые только со StatsBackend из tree_stats.h.
+  // Это не счётчики этого map: TreeStats копит их на все деревья с той
+  // же политикой, отдельный счёт даёт свой Tag.
+  TreeCounters stats() const {
+    return TreeStatsOf<avl_tree_type>::Get(AVLTree);
+  }
+
   void clear() { AVLTree.clear(); }
 
   std::pair<iterator, bool> insert(const tree_type &value) {
-    bool status = contains(value.first);
-    if (!status) AVLTree.AppendValue(value);
-    iterator t = iterator(AVLTree.FindMapTreeNode(value));
-    return std::make_pair(t, !status);
+    auto result = AVLTree.InsertUnique(value);
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  std::pair<iterator, bool> insert(tree_type &&value) {
+    auto result = AVLTree.InsertUnique(std::move(value));
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  iterator insert(iterator hint, const tree_type &value) {
+    return iterator(AVLTree.InsertUnique(hint, value).first);
+  }
+
+  iterator insert(iterator hint, tree_type &&value) {
+    return iterator(AVLTree.InsertUnique(hint, std::move(value)).first);
+  }
+
+  // Вставка вынутого extract узла без выделения памяти; только для
+  // AVL-бэкендов.
+  insert_return_type insert(node_type &&node) {
+    return AVLTree.InsertNodeUnique(std::move(node));
+  }
+
+  iterator insert(iterator hint, node_type &&node) {
+    return AVLTree.InsertNodeUnique(hint, std::move(node));
   }
 
   std::pair<iterator, bool> insert(const T &key, const K &obj) {
-    tree_type value = std::make_pair(key, obj);
-    return insert(value);
+    return try_emplace(key, obj);
   }
 
-  std::pair<iterator, bool> insert_or_assign(const T &key, const K &obj) {
-    bool status = contains(key);
-    if (status)
-      at(key) = obj;
-    else {
-      tree_type value = std::make_pair(key, obj);
-      insert(value);
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const T &key, M &&obj) {
+    auto result = try_emplace(key, std::forward<M>(obj));
+    if (!result.second) {
+      (*result.first).second = std::forward<M>(obj);
+      AVLTree.Refresh(result.first);
     }
-    iterator t = iterator(AVLTree.FindMapTreeNode(std::make_pair(key, K{})));
-    return std::make_pair(t, !status);
+    return result;
   }
 
-  void erase(iterator pos) noexcept { AVLTree.erase(pos); }
-  void swap(map &other) { std::swap(*this, other); }
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(T &&key, M &&obj) {
+    auto result = try_emplace(std::move(key), std::forward<M>(obj));
+    if (!result.second) {
+      (*result.first).second = std::forward<M>(obj);
+      AVLTree.Refresh(result.first);
+    }
+    return result;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    auto result = AVLTree.EmplaceUnique(std::forward<Args>(args)...);
+    return std::make_pair(iterator(result.first), result.second);
+  }
 
-  void merge(map &other) {
-    for (auto val : other) {
-      insert(val);
+  template <class... Args>
+  iterator emplace_hint(iterator hint, Args &&...args) {
+    return iterator(
+        AVLTree.EmplaceHintUnique(hint, std::forward<Args>(args)...).first);
+  }
+
+  // Пара строится в узле по частям и только если ключа ещё нет; при
+  // неудаче args остаются нетронутыми.
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const T &key, Args &&...args) {
+    auto result = AVLTree.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(T &&key, Args &&...args) {
+    auto result = AVLTree.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  template <class... Args>
+  iterator try_emplace(iterator hint, const T &key, Args &&...args) {
+    return iterator(AVLTree
+                        .TryEmplaceHintUnique(
+                            hint, key, std::piecewise_construct,
+                            std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...))
+                        .first);
+  }
+
+  // Меняет значение элемента на месте и пересчитывает свёртки от его
+  // узла до корня, даже если f бросила исключение.
+  template <class F>
+  void modify(iterator pos, F &&f) {
+    try {
+      std::forward<F>(f)((*pos).second);
+    } catch (...) {
+      AVLTree.Refresh(pos);
+      throw;
     }
+    AVLTree.Refresh(pos);
+  }
+
+  // То же после записи в значение через итератор.
+  void refresh(iterator pos) noexcept { AVLTree.Refresh(pos); }
+
+  // С PersistentBackend удаление из дерева, которое делит узлы с
+  // копией, копирует путь и может бросить bad_alloc.
+  void erase(iterator pos) noexcept(noexcept(AVLTree.erase(pos))) {
+    AVLTree.erase(pos);
+  }
+
+  // Узел уходит из map вместе с памятью: его можно вставить в другой map
+  // или сменить ключ через key() и вставить обратно. Ключа нет - пустой
+  // узел.
+  node_type extract(iterator pos) noexcept { return AVLTree.Extract(pos); }
+
+  node_type extract(const T &key) {
+    iterator it = find(key);
+    return it == end() ? node_type() : AVLTree.Extract(it);
+  }
+
+  void swap(map &other) { std::swap(*this, other); }
+
+  // Копия содержимого на момент вызова. С PersistentBackend - за O(1):
+  // узлы общие, пока одна из сторон их не изменит.
+  map snapshot() const { return *this; }
+
+  // Узлы переносятся без копирования; ключи, которые уже есть, остаются
+  // в other.
+  void merge(map &other) { AVLTree.MergeUnique(other.AVLTree); }
+  void merge(map &&other) { merge(other); }
+
+  // Объединение, пересечение и разность за O(m log(n/m + 1)). При
+  // совпадении ключей остаётся свой элемент.
+  void unite(const map &other) { AVLTree.UniteUnique(other.AVLTree); }
+  void unite(map &&other) {
+    AVLTree.MergeUnique(other.AVLTree);
     other.clear();
   }
-  bool contains(const T &key) const noexcept {
-    return AVLTree.FindMapTreeNode(std::make_pair(key, K{})) ? true : false;
+  void intersect(const map &other) noexcept(
+      noexcept(AVLTree.IntersectUnique(other.AVLTree))) {
+    AVLTree.IntersectUnique(other.AVLTree);
+  }
+  void subtract(const map &other) noexcept(
+      noexcept(AVLTree.SubtractUnique(other.AVLTree))) {
+    AVLTree.SubtractUnique(other.AVLTree);
+  }
+  iterator find(const T &key) {
+    return iterator(AVLTree.FindTreeNode(key));
+  }
+
+  const_iterator find(const T &key) const {
+    return const_iterator(AVLTree.FindTreeNode(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator find(const Key &key) {
+    return iterator(AVLTree.FindTreeNode(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator find(const Key &key) const {
+    return const_iterator(AVLTree.FindTreeNode(key));
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count(const Key &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool contains(const T &key) const {
+    return find(key) != end();
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  bool contains(const Key &key) const {
+    return find(key) != end();
+  }
+
+  iterator lower_bound(const key_type &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  const_iterator lower_bound(const key_type &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator lower_bound(const Key &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator lower_bound(const Key &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  iterator upper_bound(const key_type &key) {
+    return iterator(AVLTree.UpperBound(key));
+  }
+
+  const_iterator upper_bound(const key_type &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator upper_bound(const Key &key) {
+    return iterator(AVLTree.UpperBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator upper_bound(const Key &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<iterator, iterator> equal_range(const Key &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
+  }
+
+  // Порядковые статистики за O(log n), только с Augment = SubtreeSize:
+  // k-й элемент с нуля (end(), если k >= size()), число ключей меньше
+  // key и число ключей в [lo, hi).
+  iterator nth(size_type k) { return iterator(AVLTree.Select(k)); }
+
+  const_iterator nth(size_type k) const {
+    return const_iterator(AVLTree.Select(k));
+  }
+
+  size_type rank(const key_type &key) const { return AVLTree.Rank(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type rank(const Key &key) const {
+    return AVLTree.Rank(key);
+  }
+
+  size_type count_range(const key_type &lo, const key_type &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count_range(const Key &lo, const Key &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  // Свёртка элементов с ключами из [lo, hi) за O(log n), только с
+  // Augment = MonoidAugment<...>. Запись в значение через итератор
+  // видна в свёртке только после refresh.
+  auto aggregate(const key_type &lo, const key_type &hi) const {
+    return AVLTree.Aggregate(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  auto aggregate(const Key &lo, const Key &hi) const {
+    return AVLTree.Aggregate(lo, hi);
   }
 
  private:
-  Tree<tree_type> AVLTree;
+  template <class Key>
+  size_type CountBetween(const Key &lo, const Key &hi) const {
+    size_type below_hi = AVLTree.Rank(hi);
+    size_type below_lo = AVLTree.Rank(lo);
+    return below_hi > below_lo ? below_hi - below_lo : 0;
+  }
+
+  avl_tree_type AVLTree;
 };
 }  // namespace STL
 
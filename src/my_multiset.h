@@ -6,65 +6,57 @@
 #include "drevo.h"
 
 namespace STL {
-template <class T>
+// Бэкенды с узлом на элемент (AvlBackend и его варианты) сохраняют
+// итераторы на остальные элементы при вставке и удалении. BTreeBackend
+// этого не делает, см. btree.h.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>,
+          class Augment = NoAugment, class Backend = AvlBackend>
 class multiset {
  public:
-  class multisetIterator;
-  using key_type = std::pair<T, size_t>;
+  using key_type = T;
   using value_type = T;
   using reference = T &;
   using const_reference = const T &;
-  using iterator = multisetIterator;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using avl_tree_type =
+      typename Backend::template tree<T, Identity<T>, Compare, Allocator,
+                                      Augment>;
+  using iterator = typename avl_tree_type::iterator;
+  using const_iterator = typename avl_tree_type::const_iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
   using size_type = size_t;
-  class multisetIterator {
-   public:
-    explicit multisetIterator(typename Tree<key_type>::iterator other)
-        : iter_(other) {
-      if (other.node() != nullptr)
-        counter = (*other).second;
-      else
-        counter = 0;
-    }
-
-    multisetIterator &operator++() {
-      if (counter > 1)
-        --counter;
-      else {
-        ++iter_;
-        if (iter_.node() != nullptr)
-          counter = (*iter_).second;
-        else
-          counter = 0;
-      }
-      return *this;
-    }
-
-    reference operator*() const {
-      if (!iter_.node()) throw std::logic_error("nullptr");
-      return (*iter_).first;
-    }
-
-    bool operator==(const iterator &other) const {
-      return iter_.node() == other.iter_.node();
-    }
-    bool operator!=(const iterator &other) const {
-      return iter_.node() != other.iter_.node();
-    }
-
-   private:
-    typename Tree<key_type>::iterator iter_;
-    size_type counter;
-    friend class multiset;
-  };
+  using node_type = typename NodeTypeOf<avl_tree_type>::type;
 
   multiset() {}
 
+  explicit multiset(const Allocator &alloc) : AVLTree(alloc) {}
+
+  explicit multiset(const Compare &comp, const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {}
+
   explicit multiset(std::initializer_list<T> const &values) {
-    for (auto val : values) {
-      insert(val);
-    }
+    AVLTree.AssignSorted(values.begin(), values.end());
+  }
+
+  // Отсортированный диапазон собирается за O(n), остальные сортируются.
+  template <class InputIt, class = RequireIterator<InputIt>>
+  multiset(InputIt first, InputIt last, const Compare &comp = Compare(),
+           const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {
+    AVLTree.AssignSorted(first, last);
   }
 
+  // Перенос из контейнера с другим бэкендом или Augment: элементы
+  // other уже упорядочены, поэтому сортировки нет.
+  template <class OtherAugment, class OtherBackend>
+  explicit multiset(
+      const multiset<T, Compare, Allocator, OtherAugment, OtherBackend> &other)
+      : multiset(other.begin(), other.end(), other.key_comp(),
+                 other.get_allocator()) {}
+
   multiset(const multiset &other) : AVLTree(other.AVLTree) {}
 
   multiset(multiset &&other) noexcept : AVLTree(std::move(other.AVLTree)) {}
@@ -81,77 +73,273 @@ class multiset {
 
   ~multiset() {}
 
+  key_compare key_comp() const { return AVLTree.key_comp(); }
+
+  allocator_type get_allocator() const { return AVLTree.get_allocator(); }
+
   bool empty() const noexcept { return AVLTree.size() ? false : true; }
 
   size_type size() const noexcept { return AVLTree.size(); }
 
+  // Счётчики политики TreeStats на все multiset с тем же Tag, а не
+  // только на этот; без StatsBackend - нули.
+  TreeCounters stats() const {
+    return TreeStatsOf<avl_tree_type>::Get(AVLTree);
+  }
+
   void clear() { AVLTree.clear(); }
 
   std::pair<iterator, bool> insert(const value_type &value) {
-    bool status = false;
-    auto target = AVLTree.FindMapTreeNode(std::make_pair(value, size_t{}));
-    target ? (++(target->key.second), ++AVLTree.GetSize()) : (status = true);
-    if (status) AVLTree.AppendValue(std::make_pair(value, 1));
-    return std::make_pair(
-        iterator(typename Tree<key_type>::iterator(
-            AVLTree.FindMapTreeNode(std::make_pair(value, size_t{})))),
-        status);
+    return std::make_pair(iterator(AVLTree.InsertEqual(value)), true);
   }
 
-  void erase(iterator pos) noexcept { AVLTree.erase(pos.iter_); }
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return std::make_pair(iterator(AVLTree.InsertEqual(std::move(value))),
+                          true);
+  }
+
+  iterator insert(iterator hint, const value_type &value) {
+    return iterator(AVLTree.InsertEqual(hint, value));
+  }
+
+  iterator insert(iterator hint, value_type &&value) {
+    return iterator(AVLTree.InsertEqual(hint, std::move(value)));
+  }
+
+  // Вставка вынутого extract узла без выделения памяти, после равных;
+  // только для AVL-бэкендов.
+  iterator insert(node_type &&node) {
+    return AVLTree.InsertNodeEqual(std::move(node));
+  }
+
+  iterator insert(iterator hint, node_type &&node) {
+    return AVLTree.InsertNodeEqual(hint, std::move(node));
+  }
+
+  template <class... Args>
+  iterator emplace(Args &&...args) {
+    return iterator(AVLTree.EmplaceEqual(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(iterator hint, Args &&...args) {
+    return iterator(
+        AVLTree.EmplaceHintEqual(hint, std::forward<Args>(args)...));
+  }
+
+  void erase(iterator pos) noexcept { AVLTree.erase(pos); }
+
+  // Узел уходит из multiset вместе с памятью; по значению вынимается
+  // первый из равных, значения нет - пустой узел.
+  node_type extract(iterator pos) noexcept { return AVLTree.Extract(pos); }
+
+  node_type extract(const value_type &value) {
+    iterator it = lower_bound(value);
+    if (it == end() || key_comp()(value, *it)) return node_type();
+    return AVLTree.Extract(it);
+  }
 
   void swap(multiset &other) { std::swap(*this, other); }
 
-  void merge(multiset &other) {
-    for (auto val : other) {
-      insert(val);
-    }
-    other.clear();
+  // Узлы переносятся без копирования; элементы other встают после
+  // равных им.
+  void merge(multiset &other) { AVLTree.MergeEqual(other.AVLTree); }
+  void merge(multiset &&other) { merge(other); }
+
+  size_type count(const value_type &key) const { return CountRange(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count(const Key &key) const {
+    return CountRange(key);
+  }
+
+  iterator find(const value_type &value) {
+    return iterator(AVLTree.FindTreeNode(value));
+  }
+
+  const_iterator find(const value_type &value) const {
+    return const_iterator(AVLTree.FindTreeNode(value));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator find(const Key &key) {
+    return iterator(AVLTree.FindTreeNode(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator find(const Key &key) const {
+    return const_iterator(AVLTree.FindTreeNode(key));
+  }
+
+  bool contains(const value_type &value) const {
+    return find(value) != end();
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  bool contains(const Key &key) const {
+    return find(key) != end();
+  }
+
+  iterator lower_bound(const key_type &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  const_iterator lower_bound(const key_type &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator lower_bound(const Key &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator lower_bound(const Key &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  iterator upper_bound(const key_type &key) {
+    return iterator(AVLTree.UpperBound(key));
+  }
+
+  const_iterator upper_bound(const key_type &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
   }
 
-  size_type count(const value_type &key) const noexcept {
-    TreeNode<key_type> *tmp =
-        AVLTree.FindMapTreeNode(std::make_pair(key, size_t{}));
-    return tmp ? tmp->key.second : 0;
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator upper_bound(const Key &key) {
+    return iterator(AVLTree.UpperBound(key));
   }
 
-  iterator find(const value_type &value) const {
-    return iterator(typename Tree<key_type>::iterator(
-        AVLTree.FindMapTreeNode(std::make_pair(value, size_t{}))));
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator upper_bound(const Key &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
   }
 
-  bool contains(const value_type &value) const noexcept {
-    return AVLTree.FindMapTreeNode(std::make_pair(value, size_t{})) ? true
-                                                                    : false;
+  std::pair<iterator, iterator> equal_range(const key_type &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
   }
 
-  iterator lower_bound(const value_type &key) const noexcept {
-    iterator tmp = begin();
-    while (tmp.iter_.node() && *tmp < key) {
-      ++tmp;
-    }
-    return tmp;
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
   }
 
-  iterator upper_bound(const value_type &key) const noexcept {
-    iterator tmp = begin();
-    while (tmp.iter_.node() && *tmp <= key) {
-      ++tmp;
-    }
-    return tmp;
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<iterator, iterator> equal_range(const Key &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
   }
 
-  std::pair<iterator, iterator> equal_range(
-      const value_type &key) const noexcept {
-    return std::make_pair(lower_bound(key), upper_bound(key));
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
+  }
+
+  // Константные методы отдают const_iterator, как в std::multiset.
+  iterator begin() { return AVLTree.begin(); }
+
+  const_iterator begin() const { return AVLTree.begin(); }
+
+  iterator end() { return AVLTree.end(); }
+
+  const_iterator end() const { return AVLTree.end(); }
+
+  // Обход с конца: шаг назад от end() попадает в последний элемент, у
+  // AvlBackend - за O(1).
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
   }
 
-  iterator begin() const { return iterator(AVLTree.begin()); }
+  // Первый и последний элементы; на пустом контейнере - исключение.
+  reference front() { return *begin(); }
 
-  iterator end() const { return iterator(AVLTree.end()); }
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *rbegin(); }
+
+  const_reference back() const { return *rbegin(); }
+
+  // Порядковые статистики за O(log n), только с Augment = SubtreeSize:
+  // k-й элемент с нуля (end(), если k >= size()), число ключей меньше
+  // key и число ключей в [lo, hi).
+  iterator nth(size_type k) { return iterator(AVLTree.Select(k)); }
+
+  const_iterator nth(size_type k) const {
+    return const_iterator(AVLTree.Select(k));
+  }
+
+  size_type rank(const key_type &key) const { return AVLTree.Rank(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type rank(const Key &key) const {
+    return AVLTree.Rank(key);
+  }
+
+  size_type count_range(const key_type &lo, const key_type &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count_range(const Key &lo, const Key &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  // Свёртка элементов с ключами из [lo, hi) за O(log n), только с
+  // Augment = MonoidAugment<...>.
+  auto aggregate(const key_type &lo, const key_type &hi) const {
+    return AVLTree.Aggregate(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  auto aggregate(const Key &lo, const Key &hi) const {
+    return AVLTree.Aggregate(lo, hi);
+  }
 
  private:
-  Tree<key_type> AVLTree;
+  template <class Key>
+  size_type CountBetween(const Key &lo, const Key &hi) const {
+    size_type below_hi = AVLTree.Rank(hi);
+    size_type below_lo = AVLTree.Rank(lo);
+    return below_hi > below_lo ? below_hi - below_lo : 0;
+  }
+
+  template <class Key>
+  size_type CountRange(const Key &key) const {
+    auto range = equal_range(key);
+    size_type result = 0;
+    for (iterator it = range.first; it != range.second; ++it) ++result;
+    return result;
+  }
+
+  avl_tree_type AVLTree;
 };
 }  // namespace STL
 #endif  // STLCONTAINERS_MULTISET_H
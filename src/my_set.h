@@ -5,79 +5,356 @@
 
 namespace STL {
 
-template <class T>
+// Backend - дерево под set (AvlBackend по умолчанию). Стабильность
+// итераторов при изменениях гарантирует только дерево с узлом на
+// элемент; ограничения BTreeBackend описаны в btree.h.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>,
+          class Augment = NoAugment, class Backend = AvlBackend>
 class set {
  public:
   using key_type = T;
   using value_type = key_type;
   using reference = T &;
   using const_reference = const T &;
-  using iterator = typename Tree<T>::iterator;
-  using const_iterator = typename Tree<T>::const_iterator;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using avl_tree_type =
+      typename Backend::template tree<T, Identity<T>, Compare, Allocator,
+                                      Augment>;
+  using iterator = typename avl_tree_type::iterator;
+  using const_iterator = typename avl_tree_type::const_iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
   using size_type = size_t;
+  using node_type = typename NodeTypeOf<avl_tree_type>::type;
+  using insert_return_type = InsertReturn<iterator, node_type>;
 
   set() {}
 
+  explicit set(const Allocator &alloc) : AVLTree(alloc) {}
+
+  explicit set(const Compare &comp, const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {}
+
   explicit set(std::initializer_list<T> const &values) {
-    for (auto val : values) {
-      insert(val);
-    }
+    AVLTree.AssignSortedUnique(values.begin(), values.end());
+  }
+
+  // Отсортированный диапазон собирается за O(n), остальные сортируются.
+  template <class InputIt, class = RequireIterator<InputIt>>
+  set(InputIt first, InputIt last, const Compare &comp = Compare(),
+      const Allocator &alloc = Allocator())
+      : AVLTree(comp, alloc) {
+    AVLTree.AssignSortedUnique(first, last);
   }
 
+  // Перенос из контейнера с другим бэкендом или Augment: элементы
+  // other уже упорядочены, поэтому сортировки нет.
+  template <class OtherAugment, class OtherBackend>
+  explicit set(
+      const set<T, Compare, Allocator, OtherAugment, OtherBackend> &other)
+      : set(other.begin(), other.end(), other.key_comp(),
+            other.get_allocator()) {}
+
   set(const set &other) : AVLTree(other.AVLTree) {}
 
   set(set &&other) : AVLTree(std::move(other.AVLTree)) {}
 
-  set<T> &operator=(const set &other) {
+  set &operator=(const set &other) {
     AVLTree = other.AVLTree;
     return *this;
   }
 
-  set<T> &operator=(set &&other) {
+  set &operator=(set &&other) {
     AVLTree = std::move(other.AVLTree);
     return *this;
   }
 
   ~set() {}
 
+  key_compare key_comp() const { return AVLTree.key_comp(); }
+
+  allocator_type get_allocator() const { return AVLTree.get_allocator(); }
+
   bool empty() const { return AVLTree.size() ? false : true; }
 
   size_type size() const { return AVLTree.size(); }
 
+  // Общие счётчики политики StatsBackend (не этого set, см. map); у
+  // остальных бэкендов - нули.
+  TreeCounters stats() const {
+    return TreeStatsOf<avl_tree_type>::Get(AVLTree);
+  }
+
   void clear() { AVLTree.clear(); }
 
   std::pair<iterator, bool> insert(const value_type &value) {
-    bool status = (AVLTree.FindTreeNode(value) == nullptr) ? true : false;
-    if (status) AVLTree.AppendValue(value);
-    iterator t = iterator(AVLTree.FindTreeNode(value));
-    return std::make_pair(t, status);
+    auto result = AVLTree.InsertUnique(value);
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    auto result = AVLTree.InsertUnique(std::move(value));
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  iterator insert(iterator hint, const value_type &value) {
+    return iterator(AVLTree.InsertUnique(hint, value).first);
+  }
+
+  iterator insert(iterator hint, value_type &&value) {
+    return iterator(AVLTree.InsertUnique(hint, std::move(value)).first);
+  }
+
+  // Вставка вынутого extract узла без выделения памяти; только для
+  // AVL-бэкендов.
+  insert_return_type insert(node_type &&node) {
+    return AVLTree.InsertNodeUnique(std::move(node));
+  }
+
+  iterator insert(iterator hint, node_type &&node) {
+    return AVLTree.InsertNodeUnique(hint, std::move(node));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    auto result = AVLTree.EmplaceUnique(std::forward<Args>(args)...);
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  template <class... Args>
+  iterator emplace_hint(iterator hint, Args &&...args) {
+    return iterator(
+        AVLTree.EmplaceHintUnique(hint, std::forward<Args>(args)...).first);
+  }
+
+  // Бросает, только если бросает erase дерева (PersistentBackend).
+  void erase(iterator pos) noexcept(noexcept(AVLTree.erase(pos))) {
+    AVLTree.erase(pos);
   }
 
-  void erase(iterator pos) noexcept { AVLTree.erase(pos); }
+  // Узел уходит из set вместе с памятью; значения нет - пустой узел.
+  node_type extract(iterator pos) noexcept { return AVLTree.Extract(pos); }
+
+  node_type extract(const key_type &key) {
+    iterator it = find(key);
+    return it == end() ? node_type() : AVLTree.Extract(it);
+  }
 
   void swap(set &other) { std::swap(*this, other); }
 
-  void merge(set &other) {
-    for (auto val : other) {
-      insert(val);
-    }
+  // Копия содержимого на момент вызова. С PersistentBackend - за O(1):
+  // узлы общие, пока одна из сторон их не изменит.
+  set snapshot() const { return *this; }
+
+  // Узлы переносятся без копирования; ключи, которые уже есть, остаются
+  // в other.
+  void merge(set &other) { AVLTree.MergeUnique(other.AVLTree); }
+  void merge(set &&other) { merge(other); }
+
+  // Объединение, пересечение и разность за O(m log(n/m + 1)). При
+  // совпадении ключей остаётся свой элемент.
+  void unite(const set &other) { AVLTree.UniteUnique(other.AVLTree); }
+  void unite(set &&other) {
+    AVLTree.MergeUnique(other.AVLTree);
     other.clear();
   }
+  void intersect(const set &other) noexcept(
+      noexcept(AVLTree.IntersectUnique(other.AVLTree))) {
+    AVLTree.IntersectUnique(other.AVLTree);
+  }
+  void subtract(const set &other) noexcept(
+      noexcept(AVLTree.SubtractUnique(other.AVLTree))) {
+    AVLTree.SubtractUnique(other.AVLTree);
+  }
+
+  iterator find(const key_type &key) {
+    return iterator(AVLTree.FindTreeNode(key));
+  }
+
+  const_iterator find(const key_type &key) const {
+    return const_iterator(AVLTree.FindTreeNode(key));
+  }
 
-  iterator find(const key_type &key) const noexcept {
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator find(const Key &key) {
     return iterator(AVLTree.FindTreeNode(key));
   }
 
-  bool contains(const key_type &key) const noexcept {
-    return AVLTree.FindTreeNode(key) ? true : false;
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator find(const Key &key) const {
+    return const_iterator(AVLTree.FindTreeNode(key));
   }
 
-  iterator begin() const noexcept { return AVLTree.begin(); }
+  size_type count(const key_type &key) const { return contains(key) ? 1 : 0; }
 
-  iterator end() const noexcept { return AVLTree.end(); }
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count(const Key &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool contains(const key_type &key) const {
+    return find(key) != end();
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  bool contains(const Key &key) const {
+    return find(key) != end();
+  }
+
+  iterator lower_bound(const key_type &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  const_iterator lower_bound(const key_type &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator lower_bound(const Key &key) {
+    return iterator(AVLTree.LowerBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator lower_bound(const Key &key) const {
+    return const_iterator(AVLTree.LowerBound(key));
+  }
+
+  iterator upper_bound(const key_type &key) {
+    return iterator(AVLTree.UpperBound(key));
+  }
+
+  const_iterator upper_bound(const key_type &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  iterator upper_bound(const Key &key) {
+    return iterator(AVLTree.UpperBound(key));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  const_iterator upper_bound(const Key &key) const {
+    return const_iterator(AVLTree.UpperBound(key));
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<iterator, iterator> equal_range(const Key &key) {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key &key) const {
+    auto range = AVLTree.EqualRange(key);
+    return std::make_pair(const_iterator(range.first),
+                          const_iterator(range.second));
+  }
+
+  // У константного set - только const_iterator, см. map.
+  iterator begin() noexcept { return AVLTree.begin(); }
+
+  const_iterator begin() const noexcept { return AVLTree.begin(); }
+
+  iterator end() noexcept { return AVLTree.end(); }
+
+  const_iterator end() const noexcept { return AVLTree.end(); }
+
+  // Обход с конца: шаг назад от end() попадает в последний элемент, у
+  // AvlBackend - за O(1).
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  // Первый и последний элементы; на пустом контейнере - исключение.
+  reference front() { return *begin(); }
+
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *rbegin(); }
+
+  const_reference back() const { return *rbegin(); }
+
+  // Порядковые статистики за O(log n), только с Augment = SubtreeSize:
+  // k-й элемент с нуля (end(), если k >= size()), число ключей меньше
+  // key и число ключей в [lo, hi).
+  iterator nth(size_type k) { return iterator(AVLTree.Select(k)); }
+
+  const_iterator nth(size_type k) const {
+    return const_iterator(AVLTree.Select(k));
+  }
+
+  size_type rank(const key_type &key) const { return AVLTree.Rank(key); }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type rank(const Key &key) const {
+    return AVLTree.Rank(key);
+  }
+
+  size_type count_range(const key_type &lo, const key_type &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  size_type count_range(const Key &lo, const Key &hi) const {
+    return CountBetween(lo, hi);
+  }
+
+  // Свёртка элементов с ключами из [lo, hi) за O(log n), только с
+  // Augment = MonoidAugment<...>.
+  auto aggregate(const key_type &lo, const key_type &hi) const {
+    return AVLTree.Aggregate(lo, hi);
+  }
+
+  template <class Key, class C = Compare,
+            class = std::enable_if_t<IsTransparent<C>::value>>
+  auto aggregate(const Key &lo, const Key &hi) const {
+    return AVLTree.Aggregate(lo, hi);
+  }
 
  private:
-  Tree<T> AVLTree;
+  template <class Key>
+  size_type CountBetween(const Key &lo, const Key &hi) const {
+    size_type below_hi = AVLTree.Rank(hi);
+    size_type below_lo = AVLTree.Rank(lo);
+    return below_hi > below_lo ? below_hi - below_lo : 0;
+  }
+
+  avl_tree_type AVLTree;
 };
 }  // namespace STL
 #endif  // STLCONTAINERS_SET_H
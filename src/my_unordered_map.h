@@ -0,0 +1,284 @@
+#ifndef STLCONTAINERS_UNORDERED_MAP_H
+#define STLCONTAINERS_UNORDERED_MAP_H
+
+#include "hash_table.h"
+
+namespace STL {
+
+template <class T, class K, class Hash = std::hash<T>,
+          class KeyEqual = std::equal_to<T>,
+          class Allocator = std::allocator<std::pair<T, K>>>
+class unordered_map {
+ public:
+  using key_type = T;
+  using value_type = K;
+  using tree_type = std::pair<T, K>;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using hash_table_type =
+      HashTable<tree_type, SelectFirst<tree_type>, Hash, KeyEqual, Allocator>;
+  using reference = tree_type &;
+  using const_reference = const tree_type &;
+  using iterator = typename hash_table_type::iterator;
+  using const_iterator = typename hash_table_type::const_iterator;
+  using size_type = size_t;
+  // Удаление по ключу и фильтры не бросают, если не бросают Hash и
+  // KeyEqual.
+  static constexpr bool kNothrowLookup =
+      hash_table_type::template kNothrowLookup<>;
+
+  unordered_map() {}
+
+  explicit unordered_map(size_type buckets, const Hash &hash = Hash(),
+                         const KeyEqual &equal = KeyEqual(),
+                         const Allocator &alloc = Allocator())
+      : Table(buckets, hash, equal, alloc) {}
+
+  explicit unordered_map(const Allocator &alloc)
+      : Table(0, Hash(), KeyEqual(), alloc) {}
+
+  explicit unordered_map(std::initializer_list<tree_type> const &values)
+      : unordered_map(values.begin(), values.end()) {}
+
+  template <class InputIt, class = RequireIterator<InputIt>>
+  unordered_map(InputIt first, InputIt last, size_type buckets = 0,
+                const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual(),
+                const Allocator &alloc = Allocator())
+      : Table(buckets, hash, equal, alloc) {
+    for (; first != last; ++first) Table.InsertUnique(*first);
+  }
+
+  unordered_map(const unordered_map &other) : Table(other.Table) {}
+
+  unordered_map(unordered_map &&other) noexcept
+      : Table(std::move(other.Table)) {}
+
+  unordered_map &operator=(const unordered_map &other) {
+    Table = other.Table;
+    return *this;
+  }
+
+  unordered_map &operator=(unordered_map &&other) {
+    Table = std::move(other.Table);
+    return *this;
+  }
+
+  ~unordered_map() {}
+
+  K &at(const T &key) {
+    iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Incorrect index");
+    return (*it).second;
+  }
+
+  const K &at(const T &key) const {
+    const_iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Incorrect index");
+    return (*it).second;
+  }
+
+  K &operator[](const T &key) { return (*try_emplace(key).first).second; }
+
+  K &operator[](T &&key) {
+    return (*try_emplace(std::move(key)).first).second;
+  }
+
+  iterator begin() noexcept { return Table.begin(); }
+
+  iterator end() noexcept { return Table.end(); }
+
+  // Константная таблица отдаёт только const_iterator: значения через неё
+  // не меняются.
+  const_iterator begin() const noexcept { return Table.begin(); }
+
+  const_iterator end() const noexcept { return Table.end(); }
+
+  hasher hash_function() const { return Table.hash_function(); }
+
+  key_equal key_eq() const { return Table.key_eq(); }
+
+  allocator_type get_allocator() const { return Table.get_allocator(); }
+
+  bool empty() const noexcept { return Table.size() ? false : true; }
+
+  size_type size() const noexcept { return Table.size(); }
+
+  void clear() { Table.clear(); }
+
+  std::pair<iterator, bool> insert(const tree_type &value) {
+    return Table.InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> insert(tree_type &&value) {
+    return Table.InsertUnique(std::move(value));
+  }
+
+  iterator insert(iterator, const tree_type &value) {
+    return Table.InsertUnique(value).first;
+  }
+
+  iterator insert(iterator, tree_type &&value) {
+    return Table.InsertUnique(std::move(value)).first;
+  }
+
+  std::pair<iterator, bool> insert(const T &key, const K &obj) {
+    return try_emplace(key, obj);
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const T &key, M &&obj) {
+    auto result = try_emplace(key, std::forward<M>(obj));
+    if (!result.second) (*result.first).second = std::forward<M>(obj);
+    return result;
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(T &&key, M &&obj) {
+    auto result = try_emplace(std::move(key), std::forward<M>(obj));
+    if (!result.second) (*result.first).second = std::forward<M>(obj);
+    return result;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    return Table.EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator emplace_hint(iterator, Args &&...args) {
+    return Table.EmplaceUnique(std::forward<Args>(args)...).first;
+  }
+
+  // Пара строится в слоте по частям и только если ключа ещё нет; при
+  // неудаче args остаются нетронутыми.
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const T &key, Args &&...args) {
+    return Table.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(T &&key, Args &&...args) {
+    return Table.TryEmplaceUnique(
+        key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  iterator try_emplace(iterator, const T &key, Args &&...args) {
+    return try_emplace(key, std::forward<Args>(args)...).first;
+  }
+
+  void erase(iterator pos) noexcept { Table.erase(pos); }
+
+  size_type erase(const T &key) noexcept(kNothrowLookup) {
+    return Table.EraseKey(key);
+  }
+
+  void swap(unordered_map &other) { std::swap(*this, other); }
+
+  // Ключи, которые уже есть, остаются в other.
+  void merge(unordered_map &other) { Table.MergeUnique(other.Table); }
+  void merge(unordered_map &&other) { merge(other); }
+
+  // Объединение, пересечение и разность за O(m) и O(n) ожидаемо. При
+  // совпадении ключей остаётся свой элемент.
+  void unite(const unordered_map &other) { Table.UniteUnique(other.Table); }
+  void unite(unordered_map &&other) {
+    Table.MergeUnique(other.Table);
+    other.clear();
+  }
+  void intersect(const unordered_map &other) noexcept(kNothrowLookup) {
+    Table.IntersectUnique(other.Table);
+  }
+  void subtract(const unordered_map &other) noexcept(kNothrowLookup) {
+    Table.SubtractUnique(other.Table);
+  }
+
+  iterator find(const T &key) { return Table.Find(key); }
+
+  const_iterator find(const T &key) const {
+    return const_iterator(Table.Find(key));
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  iterator find(const Key &key) {
+    return Table.Find(key);
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  const_iterator find(const Key &key) const {
+    return const_iterator(Table.Find(key));
+  }
+
+  size_type count(const T &key) const { return contains(key) ? 1 : 0; }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  size_type count(const Key &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool contains(const T &key) const { return find(key) != end(); }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  bool contains(const Key &key) const {
+    return find(key) != end();
+  }
+
+  std::pair<iterator, iterator> equal_range(const T &key) {
+    auto range = EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const T &key) const {
+    return EqualRange(key);
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  std::pair<iterator, iterator> equal_range(const Key &key) {
+    auto range = EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key &key) const {
+    return EqualRange(key);
+  }
+
+  // Управление ёмкостью. Рехеширование делает итераторы и ссылки
+  // недействительными.
+  size_type bucket_count() const noexcept { return Table.bucket_count(); }
+
+  float load_factor() const noexcept { return Table.load_factor(); }
+
+  float max_load_factor() const noexcept { return Table.max_load_factor(); }
+
+  void max_load_factor(float factor) { Table.max_load_factor(factor); }
+
+  void rehash(size_type buckets) { Table.rehash(buckets); }
+
+  void reserve(size_type count) { Table.reserve(count); }
+
+ private:
+  template <class Key>
+  std::pair<const_iterator, const_iterator> EqualRange(const Key &key) const {
+    const_iterator first = find(key);
+    const_iterator last = first;
+    if (first != end()) ++last;
+    return std::make_pair(first, last);
+  }
+
+  hash_table_type Table;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_UNORDERED_MAP_H
@@ -0,0 +1,226 @@
+#ifndef STLCONTAINERS_UNORDERED_SET_H
+#define STLCONTAINERS_UNORDERED_SET_H
+
+#include "hash_table.h"
+
+namespace STL {
+
+template <class T, class Hash = std::hash<T>,
+          class KeyEqual = std::equal_to<T>,
+          class Allocator = std::allocator<T>>
+class unordered_set {
+ public:
+  using key_type = T;
+  using value_type = key_type;
+  using reference = T &;
+  using const_reference = const T &;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using hash_table_type =
+      HashTable<T, Identity<T>, Hash, KeyEqual, Allocator>;
+  using iterator = typename hash_table_type::iterator;
+  using const_iterator = typename hash_table_type::const_iterator;
+  using size_type = size_t;
+  // Hash и KeyEqual без исключений делают noexcept удаление по ключу и
+  // intersect/subtract.
+  static constexpr bool kNothrowLookup =
+      hash_table_type::template kNothrowLookup<>;
+
+  unordered_set() {}
+
+  explicit unordered_set(size_type buckets, const Hash &hash = Hash(),
+                         const KeyEqual &equal = KeyEqual(),
+                         const Allocator &alloc = Allocator())
+      : Table(buckets, hash, equal, alloc) {}
+
+  explicit unordered_set(const Allocator &alloc)
+      : Table(0, Hash(), KeyEqual(), alloc) {}
+
+  explicit unordered_set(std::initializer_list<T> const &values)
+      : unordered_set(values.begin(), values.end()) {}
+
+  template <class InputIt, class = RequireIterator<InputIt>>
+  unordered_set(InputIt first, InputIt last, size_type buckets = 0,
+                const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual(),
+                const Allocator &alloc = Allocator())
+      : Table(buckets, hash, equal, alloc) {
+    for (; first != last; ++first) Table.InsertUnique(*first);
+  }
+
+  unordered_set(const unordered_set &other) : Table(other.Table) {}
+
+  unordered_set(unordered_set &&other) noexcept
+      : Table(std::move(other.Table)) {}
+
+  unordered_set &operator=(const unordered_set &other) {
+    Table = other.Table;
+    return *this;
+  }
+
+  unordered_set &operator=(unordered_set &&other) {
+    Table = std::move(other.Table);
+    return *this;
+  }
+
+  ~unordered_set() {}
+
+  hasher hash_function() const { return Table.hash_function(); }
+
+  key_equal key_eq() const { return Table.key_eq(); }
+
+  allocator_type get_allocator() const { return Table.get_allocator(); }
+
+  bool empty() const noexcept { return Table.size() ? false : true; }
+
+  size_type size() const noexcept { return Table.size(); }
+
+  void clear() { Table.clear(); }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return Table.InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return Table.InsertUnique(std::move(value));
+  }
+
+  iterator insert(iterator, const value_type &value) {
+    return Table.InsertUnique(value).first;
+  }
+
+  iterator insert(iterator, value_type &&value) {
+    return Table.InsertUnique(std::move(value)).first;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    return Table.EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator emplace_hint(iterator, Args &&...args) {
+    return Table.EmplaceUnique(std::forward<Args>(args)...).first;
+  }
+
+  void erase(iterator pos) noexcept { Table.erase(pos); }
+
+  size_type erase(const key_type &key) noexcept(kNothrowLookup) {
+    return Table.EraseKey(key);
+  }
+
+  void swap(unordered_set &other) { std::swap(*this, other); }
+
+  // Ключи, которые уже есть, остаются в other.
+  void merge(unordered_set &other) { Table.MergeUnique(other.Table); }
+  void merge(unordered_set &&other) { merge(other); }
+
+  // Объединение, пересечение и разность за O(m) и O(n) ожидаемо. При
+  // совпадении ключей остаётся свой элемент.
+  void unite(const unordered_set &other) { Table.UniteUnique(other.Table); }
+  void unite(unordered_set &&other) {
+    Table.MergeUnique(other.Table);
+    other.clear();
+  }
+  void intersect(const unordered_set &other) noexcept(kNothrowLookup) {
+    Table.IntersectUnique(other.Table);
+  }
+  void subtract(const unordered_set &other) noexcept(kNothrowLookup) {
+    Table.SubtractUnique(other.Table);
+  }
+
+  iterator find(const key_type &key) { return Table.Find(key); }
+
+  const_iterator find(const key_type &key) const {
+    return const_iterator(Table.Find(key));
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  iterator find(const Key &key) {
+    return Table.Find(key);
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  const_iterator find(const Key &key) const {
+    return const_iterator(Table.Find(key));
+  }
+
+  size_type count(const key_type &key) const { return contains(key) ? 1 : 0; }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  size_type count(const Key &key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool contains(const key_type &key) const { return find(key) != end(); }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  bool contains(const Key &key) const {
+    return find(key) != end();
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type &key) {
+    auto range = EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type &key) const {
+    return EqualRange(key);
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  std::pair<iterator, iterator> equal_range(const Key &key) {
+    auto range = EqualRange(key);
+    return std::make_pair(iterator(range.first), iterator(range.second));
+  }
+
+  template <class Key, class H = Hash, class E = KeyEqual,
+            class = std::enable_if_t<IsHashTransparent<H, E>::value>>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key &key) const {
+    return EqualRange(key);
+  }
+
+  iterator begin() noexcept { return Table.begin(); }
+
+  iterator end() noexcept { return Table.end(); }
+
+  // У константного множества - только const_iterator.
+  const_iterator begin() const noexcept { return Table.begin(); }
+
+  const_iterator end() const noexcept { return Table.end(); }
+
+  // Управление ёмкостью. Рехеширование делает итераторы и ссылки
+  // недействительными.
+  size_type bucket_count() const noexcept { return Table.bucket_count(); }
+
+  float load_factor() const noexcept { return Table.load_factor(); }
+
+  float max_load_factor() const noexcept { return Table.max_load_factor(); }
+
+  void max_load_factor(float factor) { Table.max_load_factor(factor); }
+
+  void rehash(size_type buckets) { Table.rehash(buckets); }
+
+  void reserve(size_type count) { Table.reserve(count); }
+
+ private:
+  template <class Key>
+  std::pair<const_iterator, const_iterator> EqualRange(const Key &key) const {
+    const_iterator first = find(key);
+    const_iterator last = first;
+    if (first != end()) ++last;
+    return std::make_pair(first, last);
+  }
+
+  hash_table_type Table;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_UNORDERED_SET_H
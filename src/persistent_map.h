@@ -0,0 +1,18 @@
+#ifndef STLCONTAINERS_PERSISTENT_MAP_H
+#define STLCONTAINERS_PERSISTENT_MAP_H
+
+#include "my_map.h"
+#include "persistent_tree.h"
+
+namespace STL {
+
+// map с копированием путей: snapshot() и копирование за O(1), каждое
+// изменение после них копирует O(log n) узлов. Снимок можно читать в
+// другом потоке, пока исходный map меняется.
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>>
+using persistent_map =
+    map<Key, T, Compare, Allocator, NoAugment, PersistentBackend>;
+}  // namespace STL
+
+#endif  // STLCONTAINERS_PERSISTENT_MAP_H
@@ -0,0 +1,15 @@
+#ifndef STLCONTAINERS_PERSISTENT_SET_H
+#define STLCONTAINERS_PERSISTENT_SET_H
+
+#include "my_set.h"
+#include "persistent_tree.h"
+
+namespace STL {
+
+// set с копированием путей, см. persistent_map.
+template <class T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+using persistent_set = set<T, Compare, Allocator, NoAugment, PersistentBackend>;
+}  // namespace STL
+
+#endif  // STLCONTAINERS_PERSISTENT_SET_H
@@ -0,0 +1,718 @@
+#ifndef STLCONTAINERS_PERSISTENT_TREE_H
+#define STLCONTAINERS_PERSISTENT_TREE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "drevo.h"
+
+namespace STL {
+
+// Персистентное AVL-дерево с копированием путей для map и set. Узлы
+// без ссылок на родителя и со счётчиком ссылок, поэтому поддеревья
+// делятся между копиями: копия дерева - это O(1), один указатель на
+// корень. Изменение копирует только узлы на пути от корня, которые
+// видит кто-то ещё (счётчик больше 1), - O(log n) узлов. Разделяемые
+// узлы никогда не меняются, а счётчики атомарные, поэтому копию можно
+// читать и уничтожать в другом потоке, пока исходное дерево меняется.
+//
+// Ключи только уникальные. Родителей нет, поэтому ++ и -- ищут соседа
+// от корня за O(log n). iterator отдают только неконстантные методы:
+// его разыменование после копирования сначала копирует путь к
+// элементу, чтобы запись через ссылку не попала в копию. Константное
+// дерево отдаёт const_iterator, который ничего не копирует и ничего не
+// пишет, поэтому одну копию могут читать несколько потоков сразу.
+// Изменение дерева может сделать итераторы недействительными, если
+// копии ещё живы.
+template <class T, class KeyOfValue = Identity<T>,
+          class Compare = std::less<TreeKey<T, KeyOfValue>>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment>
+class PersistentTree {
+  static_assert(std::is_same_v<Augment, NoAugment>,
+                "PersistentTree does not support node augmentation");
+
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+
+  struct Node {
+    T key;
+    Node *left;
+    Node *right;
+    std::atomic<uint32_t> refs;
+    unsigned char height;
+  };
+
+ private:
+  using Anchor = IteratorAnchor<PersistentTree, Allocator>;
+  using AnchorCell = typename Anchor::Cell;
+
+ public:
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iterator(const PersistentTree *tree, Node *node)
+        : Iterator(tree->anchor_.get(), node) {}
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    operator Iterator<false>() const {
+      return Iterator<false>(anchor_, node_);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : Iterator(other.anchor_, other.node_) {}
+
+    // У узлов нет parent, шаг идёт от корня владельца. Владельца знает
+    // якорь: swap и перемещение дерева переносят его вместе с корнем.
+    Iterator &operator++() {
+      if (!node_) throw std::out_of_range("Out of range");
+      node_ = anchor_->owner->Next(node_);
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    Iterator &operator--() {
+      const PersistentTree *tree = anchor_ ? anchor_->owner : nullptr;
+      node_ = node_ ? tree->Prev(node_) : tree ? tree->Rightmost() : nullptr;
+      if (!node_) throw std::out_of_range("Out of range");
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    // iterator получен от неконстантного дерева, поэтому const_cast
+    // здесь законен.
+    reference operator*() const {
+      if (!node_) throw std::logic_error("nullptr");
+      if (!Const)
+        node_ = const_cast<PersistentTree *>(anchor_->owner)->Own(node_);
+      return node_->key;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    Iterator(const AnchorCell *anchor, Node *node) noexcept
+        : anchor_(anchor), node_(node) {}
+
+    const AnchorCell *anchor_;
+    mutable Node *node_;
+    friend PersistentTree;
+    friend Iterator<!Const>;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  PersistentTree() : PersistentTree(Compare(), Allocator()) {}
+
+  explicit PersistentTree(const Allocator &alloc)
+      : PersistentTree(Compare(), alloc) {}
+
+  explicit PersistentTree(const Compare &comp,
+                          const Allocator &alloc = Allocator())
+      : comp_(comp), alloc_(alloc) {
+    anchor_.Ensure(this, alloc_);
+  }
+
+  // O(1): узлы делятся, если их сможет освободить и наш аллокатор.
+  PersistentTree(const PersistentTree &other)
+      : comp_(other.comp_),
+        alloc_(node_traits::select_on_container_copy_construction(
+            other.alloc_)) {
+    anchor_.Ensure(this, alloc_);
+    ShareFrom(other);
+  }
+
+  PersistentTree(PersistentTree &&other) noexcept
+      : comp_(other.comp_), alloc_(std::move(other.alloc_)) {
+    anchor_.Take(other.anchor_, this);
+    StealState(other);
+  }
+
+  PersistentTree &operator=(const PersistentTree &other) {
+    if (this == &other) return *this;
+    clear();
+    if (node_traits::propagate_on_container_copy_assignment::value) {
+      anchor_.Free(alloc_);
+      alloc_ = other.alloc_;
+      anchor_.Ensure(this, alloc_);
+    }
+    comp_ = other.comp_;
+    ShareFrom(other);
+    return *this;
+  }
+
+  PersistentTree &operator=(PersistentTree &&other) noexcept(
+      node_traits::propagate_on_container_move_assignment::value ||
+      node_traits::is_always_equal::value) {
+    if (this == &other) return *this;
+    clear();
+    comp_ = other.comp_;
+    if (!node_traits::propagate_on_container_move_assignment::value &&
+        !(alloc_ == other.alloc_)) {
+      CopyFrom(other);
+      other.clear();
+      return *this;
+    }
+    anchor_.Free(alloc_);
+    if (node_traits::propagate_on_container_move_assignment::value)
+      alloc_ = std::move(other.alloc_);
+    anchor_.Take(other.anchor_, this);
+    StealState(other);
+    return *this;
+  }
+
+  ~PersistentTree() {
+    Release(root_);
+    anchor_.Free(alloc_);
+  }
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator, const T &value) {
+    return InsertUnique(value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(iterator, T &&value) {
+    return InsertUnique(std::move(value));
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    if (Node *existing = FindNode(key))
+      return std::make_pair(iterator(this, existing), false);
+    Node *created = CreateNode(std::forward<Args>(args)...);
+    Link(created);
+    return std::make_pair(iterator(this, created), true);
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceHintUnique(iterator, const K &key,
+                                                 Args &&...args) {
+    return TryEmplaceUnique(key, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    Node *created = CreateNode(std::forward<Args>(args)...);
+    if (Node *existing = FindNode(KeyOf(created))) {
+      DestroyNode(created);
+      return std::make_pair(iterator(this, existing), false);
+    }
+    Link(created);
+    return std::make_pair(iterator(this, created), true);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceHintUnique(iterator, Args &&...args) {
+    return EmplaceUnique(std::forward<Args>(args)...);
+  }
+
+  template <class InputIt>
+  void AssignSortedUnique(InputIt first, InputIt last) {
+    clear();
+    for (; first != last; ++first) EmplaceUnique(*first);
+  }
+
+  // Узлы other могут быть видны его копиям, поэтому элементы
+  // копируются и удаляются из other по одному.
+  void MergeUnique(PersistentTree &other) {
+    if (this == &other) return;
+    for (iterator it = other.begin(); it != other.end();) {
+      if (FindNode(KeyOf(it.node_))) {
+        ++it;
+        continue;
+      }
+      InsertUnique(static_cast<const T &>(it.node_->key));
+      it = other.erase(it);
+    }
+  }
+
+  void UniteUnique(const PersistentTree &other) {
+    if (this == &other) return;
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      InsertUnique(*it);
+  }
+
+  void IntersectUnique(const PersistentTree &other) {
+    if (this == &other) return;
+    Filter([&other](const key_type &key) {
+      return other.FindNode(key) != nullptr;
+    });
+  }
+
+  void SubtractUnique(const PersistentTree &other) {
+    if (this == &other) {
+      clear();
+      return;
+    }
+    Filter([&other](const key_type &key) { return !other.FindNode(key); });
+  }
+
+  // Если дерево делит узлы с копией, путь к удаляемому узлу
+  // копируется и возможна bad_alloc; в неразделённом дереве память не
+  // выделяется. Вынутый узел отпускаем, когда найден следующий ключ.
+  iterator erase(iterator pos) {
+    Node *victim = Remove(root_, KeyOf(pos.node_));
+    --size_;
+    iterator next(this, UpperNode(KeyOf(victim)));
+    Release(victim);
+    return next;
+  }
+
+  void clear() noexcept {
+    Release(root_);
+    root_ = nullptr;
+    size_ = 0;
+    shared_.store(false, std::memory_order_relaxed);
+  }
+
+  template <class K>
+  iterator FindTreeNode(const K &key) {
+    return iterator(this, FindNode(key));
+  }
+
+  template <class K>
+  const_iterator FindTreeNode(const K &key) const {
+    return const_iterator(this, FindNode(key));
+  }
+
+  template <class K>
+  iterator LowerBound(const K &key) {
+    return iterator(this, LowerNode(key));
+  }
+
+  template <class K>
+  const_iterator LowerBound(const K &key) const {
+    return const_iterator(this, LowerNode(key));
+  }
+
+  template <class K>
+  iterator UpperBound(const K &key) {
+    return iterator(this, UpperNode(key));
+  }
+
+  template <class K>
+  const_iterator UpperBound(const K &key) const {
+    return const_iterator(this, UpperNode(key));
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> EqualRange(const K &key) {
+    return std::make_pair(LowerBound(key), UpperBound(key));
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> EqualRange(const K &key) const {
+    return std::make_pair(LowerBound(key), UpperBound(key));
+  }
+
+  void Refresh(iterator) noexcept {}
+
+  iterator begin() noexcept { return iterator(this, Leftmost()); }
+
+  iterator end() noexcept { return iterator(this, nullptr); }
+
+  const_iterator begin() const noexcept {
+    return const_iterator(this, Leftmost());
+  }
+
+  const_iterator end() const noexcept {
+    return const_iterator(this, nullptr);
+  }
+
+  size_t size() const noexcept { return size_; }
+
+  key_compare key_comp() const { return comp_; }
+
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+ private:
+  using node_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+
+  static const key_type &KeyOf(const Node *node) noexcept {
+    return KeyOfValue()(node->key);
+  }
+
+  static unsigned height(const Node *node) noexcept {
+    return node ? node->height : 0;
+  }
+
+  static void Retain(Node *node) noexcept {
+    if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Снимает одну ссылку; узел, на который больше никто не ссылается,
+  // уничтожается вместе со своими ссылками на детей.
+  void Release(Node *node) noexcept {
+    while (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Release(node->left);
+      Node *right = node->right;
+      DestroyNode(node);
+      node = right;
+    }
+  }
+
+  template <class... Args>
+  Node *CreateNode(Args &&...args) {
+    anchor_.Ensure(this, alloc_);
+    Node *node = node_traits::allocate(alloc_, 1);
+    try {
+      node_traits::construct(alloc_, std::addressof(node->key),
+                             std::forward<Args>(args)...);
+    } catch (...) {
+      node_traits::deallocate(alloc_, node, 1);
+      throw;
+    }
+    node->left = nullptr;
+    node->right = nullptr;
+    ::new (static_cast<void *>(&node->refs)) std::atomic<uint32_t>(1);
+    node->height = 1;
+    return node;
+  }
+
+  void DestroyNode(Node *node) noexcept {
+    node_traits::destroy(alloc_, std::addressof(node->key));
+    node_traits::deallocate(alloc_, node, 1);
+  }
+
+  // Делает узел по ссылке link собственным: если его видит ещё кто-то,
+  // на его место встаёт копия с теми же детьми. Вызывается сверху вниз,
+  // когда родитель уже собственный.
+  void Unshare(Node *&link) {
+    if (link->refs.load(std::memory_order_acquire) == 1) return;
+    Node *copy = CreateNode(static_cast<const T &>(link->key));
+    copy->left = link->left;
+    copy->right = link->right;
+    copy->height = link->height;
+    Retain(copy->left);
+    Retain(copy->right);
+    Release(link);
+    link = copy;
+  }
+
+  // Копирует путь к node, если дерево когда-либо делилось, и
+  // возвращает собственный узел с тем же ключом. node держим: копия
+  // может отпустить его последней.
+  Node *Own(Node *node) {
+    if (!shared_.load(std::memory_order_relaxed)) return node;
+    Retain(node);
+    Node **link = &root_;
+    for (;;) {
+      Unshare(*link);
+      Node *current = *link;
+      if (comp_(KeyOf(node), KeyOf(current))) {
+        link = &current->left;
+      } else if (comp_(KeyOf(current), KeyOf(node))) {
+        link = &current->right;
+      } else {
+        Release(node);
+        return current;
+      }
+    }
+  }
+
+  template <class K>
+  Node *FindNode(const K &key) const {
+    Node *node = root_;
+    while (node) {
+      if (comp_(key, KeyOf(node)))
+        node = node->left;
+      else if (comp_(KeyOf(node), key))
+        node = node->right;
+      else
+        break;
+    }
+    return node;
+  }
+
+  template <class K>
+  Node *LowerNode(const K &key) const {
+    Node *result = nullptr;
+    for (Node *node = root_; node;) {
+      if (comp_(KeyOf(node), key)) {
+        node = node->right;
+      } else {
+        result = node;
+        node = node->left;
+      }
+    }
+    return result;
+  }
+
+  template <class K>
+  Node *UpperNode(const K &key) const {
+    Node *result = nullptr;
+    for (Node *node = root_; node;) {
+      if (comp_(key, KeyOf(node))) {
+        result = node;
+        node = node->left;
+      } else {
+        node = node->right;
+      }
+    }
+    return result;
+  }
+
+  Node *Leftmost() const noexcept {
+    Node *node = root_;
+    while (node && node->left) node = node->left;
+    return node;
+  }
+
+  Node *Rightmost() const noexcept {
+    Node *node = root_;
+    while (node && node->right) node = node->right;
+    return node;
+  }
+
+  Node *Next(Node *node) const { return UpperNode(KeyOf(node)); }
+
+  Node *Prev(Node *node) const {
+    Node *result = nullptr;
+    for (Node *current = root_; current;) {
+      if (comp_(KeyOf(current), KeyOf(node))) {
+        result = current;
+        current = current->right;
+      } else {
+        current = current->left;
+      }
+    }
+    return result;
+  }
+
+  // Вставка нового узла, ключа которого в дереве нет.
+  void Link(Node *created) {
+    try {
+      Insert(root_, created);
+    } catch (...) {
+      DestroyNode(created);
+      throw;
+    }
+    ++size_;
+  }
+
+  void Insert(Node *&link, Node *created) {
+    if (!link) {
+      link = created;
+      return;
+    }
+    Unshare(link);
+    if (comp_(KeyOf(created), KeyOf(link)))
+      Insert(link->left, created);
+    else
+      Insert(link->right, created);
+    Rebalance(link);
+  }
+
+  // Вынимает узел с ключом key и возвращает его вместе со ссылкой,
+  // которую держал родитель: вызывающий отпускает её сам.
+  template <class K>
+  Node *Remove(Node *&link, const K &key) {
+    Node *victim;
+    if (comp_(key, KeyOf(link))) {
+      Unshare(link);
+      victim = Remove(link->left, key);
+    } else if (comp_(KeyOf(link), key)) {
+      Unshare(link);
+      victim = Remove(link->right, key);
+    } else {
+      return Unlink(link);
+    }
+    Rebalance(link);
+    return victim;
+  }
+
+  // Ставит на место узла его ребёнка или минимум правого поддерева.
+  // Собственный узел отдаёт детей как есть, без копий и счётчиков.
+  // Узел, который видит копия, не меняется: его дети получают ещё по
+  // ссылке, а минимум собирается заново.
+  Node *Unlink(Node *&link) {
+    Node *victim = link;
+    bool owned = victim->refs.load(std::memory_order_acquire) == 1;
+    if (!victim->left || !victim->right) {
+      link = victim->left ? victim->left : victim->right;
+      if (owned)
+        victim->left = victim->right = nullptr;
+      else
+        Retain(link);
+      return victim;
+    }
+    Node *successor;
+    if (owned) {
+      successor = DetachMin(victim->right);
+      successor->right = victim->right;
+      victim->right = nullptr;
+    } else {
+      Node *right = victim->right;
+      Retain(right);
+      try {
+        successor = DetachMin(right);
+      } catch (...) {
+        Release(right);
+        throw;
+      }
+      successor->right = right;
+      Retain(victim->left);
+    }
+    successor->left = victim->left;
+    if (owned) victim->left = nullptr;
+    link = successor;
+    Rebalance(link);
+    return victim;
+  }
+
+  // Отцепляет минимум поддерева и возвращает его собственным, без
+  // детей.
+  Node *DetachMin(Node *&link) {
+    Unshare(link);
+    if (!link->left) {
+      Node *min = link;
+      link = min->right;
+      min->right = nullptr;
+      return min;
+    }
+    Node *min = DetachMin(link->left);
+    Rebalance(link);
+    return min;
+  }
+
+  void fixheight(Node *node) noexcept {
+    unsigned hl = height(node->left);
+    unsigned hr = height(node->right);
+    node->height = static_cast<unsigned char>((hl > hr ? hl : hr) + 1);
+  }
+
+  int bfactor(const Node *node) const noexcept {
+    return int(height(node->right)) - int(height(node->left));
+  }
+
+  // Повороты меняют и ребёнка, поэтому он тоже становится собственным.
+  void rotateright(Node *&link) {
+    Unshare(link->left);
+    Node *pivot = link->left;
+    link->left = pivot->right;
+    pivot->right = link;
+    fixheight(link);
+    fixheight(pivot);
+    link = pivot;
+  }
+
+  void rotateleft(Node *&link) {
+    Unshare(link->right);
+    Node *pivot = link->right;
+    link->right = pivot->left;
+    pivot->left = link;
+    fixheight(link);
+    fixheight(pivot);
+    link = pivot;
+  }
+
+  void Rebalance(Node *&link) {
+    fixheight(link);
+    if (bfactor(link) == 2) {
+      if (bfactor(link->right) < 0) {
+        Unshare(link->right);
+        rotateright(link->right);
+      }
+      rotateleft(link);
+    } else if (bfactor(link) == -2) {
+      if (bfactor(link->left) > 0) {
+        Unshare(link->left);
+        rotateleft(link->left);
+      }
+      rotateright(link);
+    }
+  }
+
+  template <class Predicate>
+  void Filter(Predicate keep) {
+    for (iterator it = begin(); it != end();) {
+      if (keep(KeyOf(it.node_)))
+        ++it;
+      else
+        it = erase(it);
+    }
+  }
+
+  void ShareFrom(const PersistentTree &other) {
+    if (!(alloc_ == other.alloc_)) {
+      CopyFrom(other);
+      return;
+    }
+    root_ = other.root_;
+    Retain(root_);
+    size_ = other.size_;
+    // Источник тоже начинает копировать пути. Флаг атомарный: снимать
+    // копии с одного дерева могут несколько читателей сразу.
+    if (root_) {
+      shared_.store(true, std::memory_order_relaxed);
+      other.shared_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  void CopyFrom(const PersistentTree &other) {
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+      InsertUnique(*it);
+  }
+
+  void StealState(PersistentTree &other) noexcept {
+    root_ = other.root_;
+    size_ = other.size_;
+    shared_.store(other.shared_.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+    other.root_ = nullptr;
+    other.size_ = 0;
+    other.shared_.store(false, std::memory_order_relaxed);
+  }
+
+  Compare comp_;
+  node_allocator alloc_;
+  Node *root_ = nullptr;
+  size_t size_ = 0;
+  Anchor anchor_;
+  // Когда-то делились узлами с копией; пока false, итераторы
+  // разыменовываются без проверки пути.
+  mutable std::atomic<bool> shared_{false};
+};
+
+// Бэкенд с копированием путей для map и set: копия контейнера за O(1).
+struct PersistentBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree = PersistentTree<T, KeyOfValue, Compare, Allocator, Augment>;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_PERSISTENT_TREE_H
@@ -0,0 +1,163 @@
+#ifndef STLCONTAINERS_POOL_ALLOCATOR_H
+#define STLCONTAINERS_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace STL {
+
+// Пул объектов фиксированного размера. Память берётся у системы слэбами,
+// освобождённые объекты складываются в свободный список своего размерного
+// класса и переиспользуются, так что при постоянной вставке/удалении узлов
+// malloc не вызывается. Слэбы возвращаются системе только в деструкторе.
+// Пул не потокобезопасен, как и контейнеры, которые им пользуются.
+class NodePool {
+ public:
+  static constexpr size_t kGranularity = alignof(std::max_align_t);
+  static constexpr size_t kMaxObjectSize = 512;
+
+  NodePool() noexcept = default;
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  ~NodePool() {
+    while (slabs_) {
+      Slab *next = slabs_->next;
+      ::operator delete(slabs_);
+      slabs_ = next;
+    }
+  }
+
+  static constexpr bool Fits(size_t size, size_t alignment) noexcept {
+    return size <= kMaxObjectSize && alignment <= kGranularity;
+  }
+
+  void *Allocate(size_t size) {
+    SizeClass &bucket = classes_[Index(size)];
+    if (bucket.free_list) {
+      FreeObject *object = bucket.free_list;
+      bucket.free_list = object->next;
+      return object;
+    }
+    if (bucket.cursor == bucket.end) Refill(bucket, ClassSize(size));
+    void *result = bucket.cursor;
+    bucket.cursor += ClassSize(size);
+    return result;
+  }
+
+  void Deallocate(void *pointer, size_t size) noexcept {
+    SizeClass &bucket = classes_[Index(size)];
+    FreeObject *object = static_cast<FreeObject *>(pointer);
+    object->next = bucket.free_list;
+    bucket.free_list = object;
+  }
+
+ private:
+  static constexpr size_t kClassCount = kMaxObjectSize / kGranularity;
+  static constexpr size_t kFirstSlabObjects = 16;
+  static constexpr size_t kMaxSlabObjects = 1024;
+
+  struct FreeObject {
+    FreeObject *next;
+  };
+
+  struct alignas(kGranularity) Slab {
+    Slab *next;
+  };
+
+  struct SizeClass {
+    FreeObject *free_list = nullptr;
+    char *cursor = nullptr;
+    char *end = nullptr;
+    size_t slab_objects = kFirstSlabObjects;
+  };
+
+  static constexpr size_t Index(size_t size) noexcept {
+    return size ? (size - 1) / kGranularity : 0;
+  }
+
+  static constexpr size_t ClassSize(size_t size) noexcept {
+    return (Index(size) + 1) * kGranularity;
+  }
+
+  // Каждый следующий слэб класса вдвое больше предыдущего, чтобы маленькие
+  // контейнеры не держали лишнюю память, а большие редко ходили в систему.
+  void Refill(SizeClass &bucket, size_t object_size) {
+    size_t bytes = sizeof(Slab) + bucket.slab_objects * object_size;
+    Slab *slab = static_cast<Slab *>(::operator new(bytes));
+    slab->next = slabs_;
+    slabs_ = slab;
+    bucket.cursor = reinterpret_cast<char *>(slab) + sizeof(Slab);
+    bucket.end = reinterpret_cast<char *>(slab) + bytes;
+    if (bucket.slab_objects < kMaxSlabObjects) bucket.slab_objects *= 2;
+  }
+
+  SizeClass classes_[kClassCount];
+  Slab *slabs_ = nullptr;
+};
+
+// Аллокатор поверх NodePool. Каждый сконструированный по умолчанию
+// аллокатор заводит свой пул, копии и rebind-копии делят его, поэтому у
+// каждого контейнера свои свободные списки. Копия контейнера получает
+// новый пул (select_on_container_copy_construction), при перемещении и
+// swap пул уходит вместе с узлами. Запросы на несколько объектов и
+// слишком крупные типы обслуживает operator new.
+template <class T>
+class pool_allocator {
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  pool_allocator() : pool_(std::make_shared<NodePool>()) {}
+
+  pool_allocator(const pool_allocator &other) noexcept = default;
+
+  template <class U>
+  pool_allocator(const pool_allocator<U> &other) noexcept
+      : pool_(other.pool_) {}
+
+  pool_allocator &operator=(const pool_allocator &other) noexcept = default;
+
+  T *allocate(size_type n) {
+    if (n == 1 && NodePool::Fits(sizeof(T), alignof(T)))
+      return static_cast<T *>(pool_->Allocate(sizeof(T)));
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T *pointer, size_type n) noexcept {
+    if (n == 1 && NodePool::Fits(sizeof(T), alignof(T)))
+      pool_->Deallocate(pointer, sizeof(T));
+    else
+      std::allocator<T>().deallocate(pointer, n);
+  }
+
+  pool_allocator select_on_container_copy_construction() const {
+    return pool_allocator();
+  }
+
+  template <class U>
+  bool operator==(const pool_allocator<U> &other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+  template <class U>
+  bool operator!=(const pool_allocator<U> &other) const noexcept {
+    return pool_ != other.pool_;
+  }
+
+ private:
+  std::shared_ptr<NodePool> pool_;
+
+  template <class U>
+  friend class pool_allocator;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_POOL_ALLOCATOR_H
@@ -0,0 +1,99 @@
+#ifndef STLCONTAINERS_SHARDED_H
+#define STLCONTAINERS_SHARDED_H
+
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+
+#include "hash_table.h"
+
+namespace STL {
+
+// Набор независимых контейнеров-шардов, каждый под своим
+// reader-writer мьютексом. Шард выбирается по хешу ключа, так что
+// операции над разными ключами почти не ждут друг друга, а чтения
+// одного шарда идут параллельно. Шарды выровнены по кеш-линии, чтобы
+// мьютексы соседей не делили линию.
+template <class Container, class Hash, size_t Shards>
+class Sharded {
+  static_assert(Shards && !(Shards & (Shards - 1)),
+                "Shards must be a power of two");
+
+ public:
+  Sharded() = default;
+
+  Sharded(const Container &prototype, const Hash &hash) : hash_(hash) {
+    for (Shard &shard : shards_) shard.data = prototype;
+  }
+
+  Sharded(const Sharded &) = delete;
+  Sharded &operator=(const Sharded &) = delete;
+
+  // work(container) под разделяемой блокировкой шарда ключа.
+  template <class K, class Work>
+  decltype(auto) Read(const K &key, Work work) const {
+    const Shard &shard = ShardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return work(shard.data);
+  }
+
+  // work(container) под исключительной блокировкой шарда ключа.
+  template <class K, class Work>
+  decltype(auto) Write(const K &key, Work work) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return work(shard.data);
+  }
+
+  // Обход шардов по очереди; каждый шард целиком под своей блокировкой.
+  template <class Work>
+  void ReadEach(Work work) const {
+    for (const Shard &shard : shards_) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      work(shard.data);
+    }
+  }
+
+  template <class Work>
+  void WriteEach(Work work) {
+    for (Shard &shard : shards_) {
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      work(shard.data);
+    }
+  }
+
+  // Согласованный срез: все шарды заблокированы на чтение одновременно.
+  // Блокировки берутся всегда в одном порядке, поэтому взаимной
+  // блокировки с другими срезами нет.
+  template <class Work>
+  void ReadAll(Work work) const {
+    std::array<std::shared_lock<std::shared_mutex>, Shards> locks;
+    for (size_t i = 0; i < Shards; ++i)
+      locks[i] = std::shared_lock<std::shared_mutex>(shards_[i].mutex);
+    for (const Shard &shard : shards_) work(shard.data);
+  }
+
+  Hash hash_function() const { return hash_; }
+
+ private:
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    Container data;
+  };
+
+  template <class K>
+  Shard &ShardFor(const K &key) {
+    return shards_[MixHash(hash_(key)) & (Shards - 1)];
+  }
+
+  template <class K>
+  const Shard &ShardFor(const K &key) const {
+    return shards_[MixHash(hash_(key)) & (Shards - 1)];
+  }
+
+  std::array<Shard, Shards> shards_;
+  Hash hash_;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_SHARDED_H
@@ -0,0 +1,249 @@
+#ifndef STLCONTAINERS_SIMD_SEARCH_H
+#define STLCONTAINERS_SIMD_SEARCH_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "drevo.h"
+
+// Векторные ядра есть только для x86-64 под GCC/Clang. STL_NO_SIMD
+// оставляет везде скалярный путь.
+#if !defined(STL_NO_SIMD) && defined(__x86_64__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define STL_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace STL {
+namespace simd {
+
+// Ключи, которые умеют сравнивать ядра: 32- и 64-битные целые, float и
+// double.
+template <class T>
+inline constexpr bool kKeyType =
+    (std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+     (sizeof(T) == 4 || sizeof(T) == 8)) ||
+    std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+// Векторный поиск применим, когда ключ - само значение (set, multiset),
+// порядок - обычный < и ищется ключ того же типа.
+template <class T, class KeyOfValue, class Compare, class K>
+inline constexpr bool kSearchable =
+    kKeyType<T> && std::is_same_v<K, T> &&
+    std::is_same_v<KeyOfValue, Identity<T>> &&
+    (std::is_same_v<Compare, std::less<T>> ||
+     std::is_same_v<Compare, std::less<>>);
+
+// Все ядра считают, сколько элементов keys[0..n) меньше key (Upper: не
+// больше key). Для упорядоченного массива это индекс lower_bound
+// (upper_bound), а подсчёт не ветвится на каждом элементе.
+template <bool Upper, class T>
+size_t ScalarCount(const T *keys, size_t n, T key) noexcept {
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i)
+    count += Upper ? !(key < keys[i]) : keys[i] < key;
+  return count;
+}
+
+#ifdef STL_SIMD_X86
+#define STL_SIMD_AVX2 __attribute__((target("avx2,popcnt")))
+
+// Операции над регистром для каждого типа ключа: загрузка, размножение
+// ключа и маска лан, где a > b. Беззнаковые сдвигаются на знаковый бит,
+// чтобы сравнивать знаковой командой.
+template <class T, class = void>
+struct Sse2Ops {
+  static constexpr bool kEnabled = false;
+};
+
+template <class T>
+struct Sse2Ops<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 4>> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 4;
+  static __m128i Bias(__m128i v) noexcept {
+    if constexpr (std::is_signed_v<T>) return v;
+    return _mm_xor_si128(v, _mm_set1_epi32(INT_MIN));
+  }
+  static __m128i Load(const T *p) noexcept {
+    return Bias(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  }
+  static __m128i Set(T key) noexcept {
+    return Bias(_mm_set1_epi32(static_cast<int>(key)));
+  }
+  static int Greater(__m128i a, __m128i b) noexcept {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, b)));
+  }
+};
+
+template <>
+struct Sse2Ops<float> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 4;
+  static __m128 Load(const float *p) noexcept { return _mm_loadu_ps(p); }
+  static __m128 Set(float key) noexcept { return _mm_set1_ps(key); }
+  static int Greater(__m128 a, __m128 b) noexcept {
+    return _mm_movemask_ps(_mm_cmpgt_ps(a, b));
+  }
+};
+
+template <>
+struct Sse2Ops<double> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 2;
+  static __m128d Load(const double *p) noexcept { return _mm_loadu_pd(p); }
+  static __m128d Set(double key) noexcept { return _mm_set1_pd(key); }
+  static int Greater(__m128d a, __m128d b) noexcept {
+    return _mm_movemask_pd(_mm_cmpgt_pd(a, b));
+  }
+};
+
+template <class T, class = void>
+struct Avx2Ops {
+  static constexpr bool kEnabled = false;
+};
+
+template <class T>
+struct Avx2Ops<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 4>> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 8;
+  STL_SIMD_AVX2 static __m256i Bias(__m256i v) noexcept {
+    if constexpr (std::is_signed_v<T>) return v;
+    return _mm256_xor_si256(v, _mm256_set1_epi32(INT_MIN));
+  }
+  STL_SIMD_AVX2 static __m256i Load(const T *p) noexcept {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+  }
+  STL_SIMD_AVX2 static __m256i Set(T key) noexcept {
+    return Bias(_mm256_set1_epi32(static_cast<int>(key)));
+  }
+  STL_SIMD_AVX2 static int Greater(__m256i a, __m256i b) noexcept {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)));
+  }
+};
+
+template <class T>
+struct Avx2Ops<T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) == 8>> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 4;
+  STL_SIMD_AVX2 static __m256i Bias(__m256i v) noexcept {
+    if constexpr (std::is_signed_v<T>) return v;
+    return _mm256_xor_si256(v, _mm256_set1_epi64x(LLONG_MIN));
+  }
+  STL_SIMD_AVX2 static __m256i Load(const T *p) noexcept {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+  }
+  STL_SIMD_AVX2 static __m256i Set(T key) noexcept {
+    return Bias(_mm256_set1_epi64x(static_cast<long long>(key)));
+  }
+  STL_SIMD_AVX2 static int Greater(__m256i a, __m256i b) noexcept {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b)));
+  }
+};
+
+template <>
+struct Avx2Ops<float> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 8;
+  STL_SIMD_AVX2 static __m256 Load(const float *p) noexcept {
+    return _mm256_loadu_ps(p);
+  }
+  STL_SIMD_AVX2 static __m256 Set(float key) noexcept {
+    return _mm256_set1_ps(key);
+  }
+  STL_SIMD_AVX2 static int Greater(__m256 a, __m256 b) noexcept {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ));
+  }
+};
+
+template <>
+struct Avx2Ops<double> {
+  static constexpr bool kEnabled = true;
+  static constexpr size_t kLanes = 4;
+  STL_SIMD_AVX2 static __m256d Load(const double *p) noexcept {
+    return _mm256_loadu_pd(p);
+  }
+  STL_SIMD_AVX2 static __m256d Set(double key) noexcept {
+    return _mm256_set1_pd(key);
+  }
+  STL_SIMD_AVX2 static int Greater(__m256d a, __m256d b) noexcept {
+    return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+  }
+};
+
+// Одно и то же ядро для SSE2 и AVX2, различаются только Ops и набор
+// команд, под который компилируется функция. Считаются ланы с
+// key > keys[i] (или keys[i] > key для Upper), хвост - скалярно.
+#define STL_SIMD_COUNT_KERNEL(name, attribute)                            \
+  template <bool Upper, class Ops, class T>                               \
+  attribute size_t name(const T *keys, size_t n, T key) noexcept {        \
+    auto pivot = Ops::Set(key);                                           \
+    size_t hits = 0;                                                      \
+    size_t i = 0;                                                         \
+    for (; i + Ops::kLanes <= n; i += Ops::kLanes) {                      \
+      auto block = Ops::Load(keys + i);                                   \
+      hits += __builtin_popcount(Upper ? Ops::Greater(block, pivot)       \
+                                       : Ops::Greater(pivot, block));     \
+    }                                                                     \
+    for (; i < n; ++i) hits += Upper ? key < keys[i] : keys[i] < key;     \
+    return Upper ? n - hits : hits;                                       \
+  }
+
+STL_SIMD_COUNT_KERNEL(Sse2Count, )
+STL_SIMD_COUNT_KERNEL(Avx2Count, STL_SIMD_AVX2)
+#undef STL_SIMD_COUNT_KERNEL
+#endif  // STL_SIMD_X86
+
+template <bool Upper, class T>
+using CountFunction = size_t (*)(const T *, size_t, T) noexcept;
+
+// Выбор ядра по возможностям процессора: AVX2, затем SSE2 (есть на
+// любом x86-64), иначе скалярный подсчёт.
+template <bool Upper, class T>
+CountFunction<Upper, T> SelectKernel(const char **name = nullptr) noexcept {
+  const char *unused;
+  if (!name) name = &unused;
+#ifdef STL_SIMD_X86
+  __builtin_cpu_init();
+  if constexpr (Avx2Ops<T>::kEnabled) {
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+      *name = "avx2";
+      return &Avx2Count<Upper, Avx2Ops<T>, T>;
+    }
+  }
+  if constexpr (Sse2Ops<T>::kEnabled) {
+    *name = "sse2";
+    return &Sse2Count<Upper, Sse2Ops<T>, T>;
+  }
+#endif
+  *name = "scalar";
+  return &ScalarCount<Upper, T>;
+}
+
+// Имя ядра, которое выбрано для ключей типа T.
+template <class T>
+const char *KernelName() noexcept {
+  const char *name;
+  SelectKernel<false, T>(&name);
+  return name;
+}
+
+// Индексы lower_bound и upper_bound в упорядоченном keys[0..n). Ядро
+// выбирается один раз на тип.
+template <class T>
+size_t LowerIndex(const T *keys, size_t n, T key) noexcept {
+  static const CountFunction<false, T> count = SelectKernel<false, T>();
+  return count(keys, n, key);
+}
+
+template <class T>
+size_t UpperIndex(const T *keys, size_t n, T key) noexcept {
+  static const CountFunction<true, T> count = SelectKernel<true, T>();
+  return count(keys, n, key);
+}
+}  // namespace simd
+}  // namespace STL
+
+#endif  // STLCONTAINERS_SIMD_SEARCH_H
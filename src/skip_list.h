@@ -0,0 +1,443 @@
+#ifndef STLCONTAINERS_SKIP_LIST_H
+#define STLCONTAINERS_SKIP_LIST_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "drevo.h"
+#include "epoch.h"
+
+namespace STL {
+
+// Упорядоченный список с пропусками без блокировок (Harris, Fraser)
+// для lockfree_map и lockfree_set. Ключи уникальны. Ссылки на
+// следующий узел - атомарные слова, младший бит которых помечает узел
+// удалённым на этом уровне: сначала помечаются верхние уровни, затем
+// нулевой - это и есть момент удаления. Физически узел вырезает любой
+// пишущий поиск, который на него наткнулся. Читатели ничего не пишут в
+// список и только перешагивают помеченные узлы, поэтому никогда не
+// ждут писателей. Узлы освобождаются через EpochReclaimer: итератор
+// держит Guard эпохи, и узел, на который он указывает, живёт, пока жив
+// итератор, даже если его уже удалили.
+template <class T, class KeyOfValue, class Compare, class Allocator>
+class SkipList {
+  struct Node;
+  using Link = std::atomic<uintptr_t>;
+  using node_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+  using Guard = EpochReclaimer::Guard;
+
+ public:
+  using key_type = TreeKey<T, KeyOfValue>;
+  using value_type = T;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+
+  // Вероятность подняться на уровень выше - 1/4, так что 16 уровней
+  // хватает на 4^16 элементов.
+  static constexpr int kMaxHeight = 16;
+
+  // Итератор только на чтение: значения в узлах не меняются, пока узел
+  // в списке. Проходит живые узлы по возрастанию ключей и видит
+  // вставки и удаления, случившиеся впереди него.
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    iterator() : node_(nullptr) {}
+
+    iterator &operator++() {
+      if (!node_) throw std::out_of_range("Out of range");
+      node_ = NextLive(node_);
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    reference operator*() const {
+      if (!node_) throw std::logic_error("nullptr");
+      return node_->value;
+    }
+
+    bool operator==(const iterator &other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const iterator &other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    iterator(Node *node, Guard guard)
+        : node_(node), guard_(std::move(guard)) {}
+
+    Node *node_;
+    Guard guard_;
+    friend SkipList;
+  };
+
+  using const_iterator = iterator;
+
+  explicit SkipList(const Compare &comp = Compare(),
+                    const Allocator &alloc = Allocator())
+      : comp_(comp), alloc_(alloc), head_(NewNode(kMaxHeight)) {}
+
+  SkipList(const SkipList &) = delete;
+  SkipList &operator=(const SkipList &) = delete;
+
+  // Только когда других потоков у списка уже нет.
+  ~SkipList() {
+    Node *node = Ptr(Links(head_)[0].load());
+    while (node) {
+      Node *next = Ptr(Links(node)[0].load());
+      FreeNode(node);
+      node = next;
+    }
+    DeallocateNode(head_);
+    reclaimer_.Drain([this](EpochReclaimer::Retired *node) {
+      FreeNode(static_cast<Node *>(node));
+    });
+  }
+
+  std::pair<iterator, bool> InsertUnique(const T &value) {
+    return TryEmplaceUnique(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> InsertUnique(T &&value) {
+    return TryEmplaceUnique(KeyOfValue()(value), std::move(value));
+  }
+
+  // Значение строится, только если ключа нет на момент поиска; если
+  // ключ вставили параллельно, построенный узел уничтожается.
+  template <class K, class... Args>
+  std::pair<iterator, bool> TryEmplaceUnique(const K &key, Args &&...args) {
+    Guard guard(&reclaimer_);
+    Node *preds[kMaxHeight];
+    Node *succs[kMaxHeight];
+    if (Locate(key, preds, succs))
+      return std::make_pair(iterator(succs[0], std::move(guard)), false);
+    return Publish(MakeNode(std::forward<Args>(args)...), preds, succs,
+                   std::move(guard));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> EmplaceUnique(Args &&...args) {
+    Guard guard(&reclaimer_);
+    Node *node = MakeNode(std::forward<Args>(args)...);
+    Node *preds[kMaxHeight];
+    Node *succs[kMaxHeight];
+    if (Locate(KeyOf(node), preds, succs)) {
+      FreeNode(node);
+      return std::make_pair(iterator(succs[0], std::move(guard)), false);
+    }
+    return Publish(node, preds, succs, std::move(guard));
+  }
+
+  // 1, если этот вызов удалил ключ; 0, если ключа не было или его
+  // параллельно удалил другой поток.
+  template <class K>
+  size_t EraseUnique(const K &key) {
+    Guard guard(&reclaimer_);
+    Node *preds[kMaxHeight];
+    Node *succs[kMaxHeight];
+    if (!Locate(key, preds, succs)) return 0;
+    Node *victim = succs[0];
+    for (int level = victim->height - 1; level > 0; --level) {
+      uintptr_t link = Links(victim)[level].load();
+      while (!Marked(link) &&
+             !Links(victim)[level].compare_exchange_weak(link, link | 1)) {
+      }
+    }
+    uintptr_t link = Links(victim)[0].load();
+    do {
+      if (Marked(link)) return 0;
+    } while (!Links(victim)[0].compare_exchange_weak(link, link | 1));
+    size_.fetch_sub(1);
+    // Обычно предшественники из поиска всё ещё указывают на узел, и его
+    // можно вырезать без второго прохода.
+    bool unlinked = true;
+    for (int level = victim->height - 1; level >= 0; --level) {
+      uintptr_t expected = Raw(victim);
+      uintptr_t next = Links(victim)[level].load() & ~uintptr_t(1);
+      if (!Links(preds[level])[level].compare_exchange_strong(expected, next))
+        unlinked = false;
+    }
+    if (!unlinked) Locate(key, preds, succs);
+    Release(victim);
+    return 1;
+  }
+
+  // Удаляет по одному все ключи, которые видит обход; параллельные
+  // вставки могут остаться.
+  void clear() {
+    for (iterator it = begin(); it != end(); ++it)
+      EraseUnique(KeyOfValue()(*it));
+  }
+
+  template <class K>
+  iterator Find(const K &key) const {
+    Guard guard(&reclaimer_);
+    Node *node = LowerNode(key);
+    if (!node || comp_(key, KeyOf(node))) return end();
+    return iterator(node, std::move(guard));
+  }
+
+  template <class K>
+  bool Contains(const K &key) const {
+    Guard guard(&reclaimer_);
+    Node *node = LowerNode(key);
+    return node && !comp_(key, KeyOf(node));
+  }
+
+  template <class K>
+  iterator LowerBound(const K &key) const {
+    Guard guard(&reclaimer_);
+    Node *node = LowerNode(key);
+    return node ? iterator(node, std::move(guard)) : end();
+  }
+
+  template <class K>
+  iterator UpperBound(const K &key) const {
+    Guard guard(&reclaimer_);
+    Node *node = Seek([&](Node *curr) { return !comp_(key, KeyOf(curr)); });
+    return node ? iterator(node, std::move(guard)) : end();
+  }
+
+  iterator begin() const {
+    Guard guard(&reclaimer_);
+    Node *node = NextLive(head_);
+    return node ? iterator(node, std::move(guard)) : end();
+  }
+
+  iterator end() const noexcept { return iterator(); }
+
+  // Число элементов на момент вызова; при параллельных изменениях -
+  // приблизительно.
+  size_t size() const noexcept {
+    ptrdiff_t size = size_.load();
+    return size > 0 ? size_t(size) : 0;
+  }
+
+  Compare key_comp() const { return comp_; }
+
+  Allocator get_allocator() const { return Allocator(alloc_); }
+
+ private:
+  // Заголовок узла; за ним в том же блоке лежат height ссылок.
+  struct Node : EpochReclaimer::Retired {
+    explicit Node(int node_height) : height(node_height) {}
+    ~Node() {}
+
+    // Владельцы узла: вставка, пока достраивает верхние уровни, и
+    // удаление. Последний отдаёт узел в EpochReclaimer.
+    std::atomic<int> refs{2};
+    int height;
+    union {
+      T value;
+    };
+  };
+
+  static Link *Links(Node *node) noexcept {
+    return reinterpret_cast<Link *>(node + 1);
+  }
+
+  static Node *Ptr(uintptr_t link) noexcept {
+    return reinterpret_cast<Node *>(link & ~uintptr_t(1));
+  }
+
+  static uintptr_t Raw(Node *node) noexcept {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+
+  static bool Marked(uintptr_t link) noexcept { return link & 1; }
+
+  static const key_type &KeyOf(Node *node) noexcept {
+    return KeyOfValue()(node->value);
+  }
+
+  // Узел с ссылками занимает целое число блоков размера Node.
+  static size_t Units(int height) noexcept {
+    return 1 + (height * sizeof(Link) + sizeof(Node) - 1) / sizeof(Node);
+  }
+
+  static int RandomHeight() noexcept {
+    thread_local uint64_t state =
+        0x9e3779b97f4a7c15ull ^ reinterpret_cast<uintptr_t>(&state);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    int height = 1;
+    for (uint64_t bits = state; !(bits & 3) && height < kMaxHeight; bits >>= 2)
+      ++height;
+    return height;
+  }
+
+  // Первый живой узел после node на нулевом уровне.
+  static Node *NextLive(Node *node) noexcept {
+    Node *curr = Ptr(Links(node)[0].load());
+    while (curr && Marked(Links(curr)[0].load()))
+      curr = Ptr(Links(curr)[0].load());
+    return curr;
+  }
+
+  Node *NewNode(int height) {
+    Node *node = node_traits::allocate(alloc_, Units(height));
+    ::new (static_cast<void *>(node)) Node(height);
+    for (int level = 0; level < height; ++level)
+      ::new (static_cast<void *>(Links(node) + level)) Link(0);
+    return node;
+  }
+
+  template <class... Args>
+  Node *MakeNode(Args &&...args) {
+    Node *node = NewNode(RandomHeight());
+    try {
+      node_traits::construct(alloc_, std::addressof(node->value),
+                             std::forward<Args>(args)...);
+    } catch (...) {
+      DeallocateNode(node);
+      throw;
+    }
+    return node;
+  }
+
+  void DeallocateNode(Node *node) noexcept {
+    size_t units = Units(node->height);
+    node->~Node();
+    node_traits::deallocate(alloc_, node, units);
+  }
+
+  void FreeNode(Node *node) noexcept {
+    node_traits::destroy(alloc_, std::addressof(node->value));
+    DeallocateNode(node);
+  }
+
+  // Первый живой узел, для которого before(node) ложно. Ничего не
+  // пишет в список.
+  template <class Before>
+  Node *Seek(Before before) const {
+    Node *pred = head_;
+    Node *curr = nullptr;
+    for (int level = kMaxHeight - 1; level >= 0; --level) {
+      curr = Ptr(Links(pred)[level].load());
+      while (curr) {
+        uintptr_t succ = Links(curr)[level].load();
+        if (!Marked(succ)) {
+          if (!before(curr)) break;
+          pred = curr;
+        }
+        curr = Ptr(succ);
+      }
+    }
+    return curr;
+  }
+
+  template <class K>
+  Node *LowerNode(const K &key) const {
+    return Seek([&](Node *curr) { return comp_(KeyOf(curr), key); });
+  }
+
+  // Поиск для писателей: на каждом уровне последний узел меньше key и
+  // первый не меньше, помеченные узлы по пути вырезаются. true, если
+  // ключ есть.
+  template <class K>
+  bool Locate(const K &key, Node **preds, Node **succs) {
+    while (!TryLocate(key, preds, succs)) {
+    }
+    return succs[0] && !comp_(key, KeyOf(succs[0]));
+  }
+
+  // false, если предшественника изменили под нами и проход нужно
+  // начать заново.
+  template <class K>
+  bool TryLocate(const K &key, Node **preds, Node **succs) {
+    Node *pred = head_;
+    for (int level = kMaxHeight - 1; level >= 0; --level) {
+      Node *curr = Ptr(Links(pred)[level].load());
+      while (curr) {
+        uintptr_t succ = Links(curr)[level].load();
+        if (Marked(succ)) {
+          uintptr_t expected = Raw(curr);
+          if (!Links(pred)[level].compare_exchange_strong(
+                  expected, succ & ~uintptr_t(1)))
+            return false;
+          curr = Ptr(succ);
+          continue;
+        }
+        if (!comp_(KeyOf(curr), key)) break;
+        pred = curr;
+        curr = Ptr(succ);
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return true;
+  }
+
+  // Вставка построенного узла по результату поиска, в котором ключа не
+  // нашлось: сначала нулевой уровень (момент появления ключа), затем
+  // верхние, пока узел не пометили удалённым.
+  std::pair<iterator, bool> Publish(Node *node, Node **preds, Node **succs,
+                                    Guard guard) {
+    const key_type &key = KeyOf(node);
+    for (;;) {
+      for (int level = 0; level < node->height; ++level)
+        Links(node)[level].store(Raw(succs[level]));
+      uintptr_t expected = Raw(succs[0]);
+      if (Links(preds[0])[0].compare_exchange_strong(expected, Raw(node)))
+        break;
+      if (Locate(key, preds, succs)) {
+        FreeNode(node);
+        return std::make_pair(iterator(succs[0], std::move(guard)), false);
+      }
+    }
+    size_.fetch_add(1);
+    for (int level = 1; level < node->height; ++level)
+      if (!LinkLevel(node, level, preds, succs)) break;
+    // Если узел удалили, пока мы его достраивали, уровни, подшитые
+    // после поиска удаляющего, вырезаем сами.
+    if (Marked(Links(node)[0].load())) Locate(key, preds, succs);
+    Release(node);
+    return std::make_pair(iterator(node, std::move(guard)), true);
+  }
+
+  bool LinkLevel(Node *node, int level, Node **preds, Node **succs) {
+    for (;;) {
+      uintptr_t link = Links(node)[level].load();
+      if (Marked(link)) return false;
+      if (Ptr(link) != succs[level] &&
+          !Links(node)[level].compare_exchange_strong(link, Raw(succs[level])))
+        return false;
+      uintptr_t expected = Raw(succs[level]);
+      if (Links(preds[level])[level].compare_exchange_strong(expected,
+                                                             Raw(node)))
+        return true;
+      Locate(KeyOf(node), preds, succs);
+    }
+  }
+
+  // Отказ от владения узлом; последний владелец списывает его.
+  void Release(Node *node) noexcept {
+    if (node->refs.fetch_sub(1) == 1) reclaimer_.Retire(node);
+    reclaimer_.TryAdvance([this](EpochReclaimer::Retired *retired) {
+      FreeNode(static_cast<Node *>(retired));
+    });
+  }
+
+  Compare comp_;
+  node_allocator alloc_;
+  Node *head_;
+  std::atomic<ptrdiff_t> size_{0};
+  mutable EpochReclaimer reclaimer_;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_SKIP_LIST_H
@@ -1,12 +1,105 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <map>
+#include <mutex>
+#include <random>
 #include <set>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
-
+#include <vector>
+
+#include "../btree.h"
+#include "../compact_tree.h"
+#include "../concurrent_map.h"
+#include "../concurrent_set.h"
+#include "../lockfree_map.h"
+#include "../lockfree_set.h"
+#include "../flat_map.h"
+#include "../flat_multiset.h"
+#include "../flat_set.h"
 #include "../my_map.h"
 #include "../my_set.h"
+#include "../my_unordered_map.h"
+#include "../my_unordered_set.h"
 #include "../my_multiset.h"
+#include "../persistent_map.h"
+#include "../persistent_set.h"
+#include "../pool_allocator.h"
+#include "../simd_search.h"
+#include "../tree_stats.h"
+
+struct Ticket {
+  explicit Ticket(int id) : id(id) { ++constructed; }
+  Ticket(const Ticket &other) : id(other.id) { ++constructed; }
+  int id;
+  static int constructed;
+};
+int Ticket::constructed = 0;
+
+struct Tracked {
+  explicit Tracked(int value) : value(value) { ++constructed; }
+  Tracked(const Tracked &other) : value(other.value) { ++copied; }
+  Tracked(Tracked &&other) noexcept : value(other.value) { ++moved; }
+  Tracked &operator=(const Tracked &) = default;
+  bool operator<(const Tracked &other) const { return value < other.value; }
+  int value;
+  static int constructed, copied, moved;
+  static void Reset() { constructed = copied = moved = 0; }
+};
+int Tracked::constructed = 0, Tracked::copied = 0, Tracked::moved = 0;
+
+struct TicketLess {
+  using is_transparent = void;
+  bool operator()(const Ticket &a, const Ticket &b) const {
+    return a.id < b.id;
+  }
+  bool operator()(const Ticket &a, int b) const { return a.id < b; }
+  bool operator()(int a, const Ticket &b) const { return a < b.id; }
+};
+
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view text) const {
+    return std::hash<std::string_view>()(text);
+  }
+};
+
+template <class T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(long *live, long *total = nullptr)
+      : live(live), total(total) {}
+  template <class U>
+  CountingAllocator(const CountingAllocator<U> &other)
+      : live(other.live), total(other.total) {}
+
+  T *allocate(size_t n) {
+    *live += n;
+    if (total) *total += n;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    *live -= n;
+    std::allocator<T>().deallocate(p, n);
+  }
+  template <class U>
+  bool operator==(const CountingAllocator<U> &other) const {
+    return live == other.live;
+  }
+  template <class U>
+  bool operator!=(const CountingAllocator<U> &other) const {
+    return live != other.live;
+  }
+
+  long *live;
+  long *total;
+};
 
 
 TEST(MultiSetConstructorTest, DefaultConstructor) {
@@ -27,7 +120,7 @@ TEST(MultiSetConstructorTest, CopyConstructor) {
   STL::multiset<int> originalSet{5, 10, 5, 7};
   STL::multiset<int> copySet(originalSet);
 
-  EXPECT_EQ(copySet.size(), 3);
+  EXPECT_EQ(copySet.size(), 4);
   EXPECT_EQ(*originalSet.begin(), *copySet.begin());
 }
 
@@ -45,7 +138,7 @@ TEST(MultiSetTest, CopyAssignmentOperator) {
 
   assignedSet = originalSet;
 
-  EXPECT_EQ(assignedSet.size(), 3);
+  EXPECT_EQ(assignedSet.size(), 4);
   EXPECT_EQ(*assignedSet.begin(), *originalSet.begin());
 }
 
@@ -59,6 +152,24 @@ TEST(MultiSetTest, MoveAssignmentOperator) {
   EXPECT_EQ(originalSet.size(), 0);
 }
 
+TEST(MultiSetConstructorTest, RangeConstructorKeepsDuplicates) {
+  std::vector<int> values;
+  for (int i = 0; i < 1000; ++i) values.push_back(i / 4);
+  STL::multiset<int> sortedSet(values.begin(), values.end());
+  EXPECT_EQ(sortedSet.size(), 1000);
+  EXPECT_EQ(sortedSet.count(100), 4);
+  std::vector<int> reversed(values.rbegin(), values.rend());
+  STL::multiset<int> reversedSet(reversed.begin(), reversed.end());
+  auto it = reversedSet.begin();
+  for (int value : values) {
+    EXPECT_EQ(*it, value);
+    ++it;
+  }
+  STL::set<int> uniqueSet(reversed.begin(), reversed.end());
+  EXPECT_EQ(uniqueSet.size(), 250);
+  EXPECT_EQ(*uniqueSet.begin(), 0);
+}
+
 TEST(MultiSetTest, EmptyMethodOnEmptySet) {
   STL::multiset<int> emptySet;
 
@@ -86,6 +197,21 @@ TEST(MultiSetTest, InsertReturnValue) {
   EXPECT_EQ(testSet.size(), 3);
 }
 
+TEST(MultiSetTest, InsertRvalueKeepsOrder) {
+  STL::multiset<std::string> testSet;
+  std::multiset<std::string> expected;
+  for (const char *key : {"delta", "alpha", "echo", "bravo", "alpha"}) {
+    testSet.insert(std::string(key));
+    expected.insert(key);
+  }
+  testSet.insert(testSet.begin(), std::string("charlie"));
+  expected.insert("charlie");
+
+  auto it = testSet.begin();
+  for (const std::string &key : expected) EXPECT_EQ(*it++, key);
+  EXPECT_TRUE(it == testSet.end());
+}
+
 TEST(MultiSetTest, EraseMethod) {
   STL::multiset<int> testSet{5, 10, 5, 7};
 
@@ -98,6 +224,68 @@ TEST(MultiSetTest, EraseMethod) {
   EXPECT_EQ(testSet.count(10), 1);
 }
 
+TEST(MultiSetTest, EqualRangeWithDuplicates) {
+  STL::multiset<int> testSet;
+  for (int i = 0; i < 300; ++i) testSet.insert(i % 30);
+  for (int key = 0; key < 30; ++key) {
+    auto range = testSet.equal_range(key);
+    int count = 0;
+    for (auto it = range.first; it != range.second; ++it, ++count)
+      EXPECT_EQ(*it, key);
+    EXPECT_EQ(count, 10);
+    EXPECT_TRUE(range.first == testSet.lower_bound(key));
+    EXPECT_TRUE(range.second == testSet.upper_bound(key));
+  }
+  EXPECT_TRUE(testSet.equal_range(30).first == testSet.end());
+}
+
+TEST(MultiSetTest, EraseExactNode) {
+  auto by_first = [](const std::pair<int, int> &a,
+                     const std::pair<int, int> &b) {
+    return a.first < b.first;
+  };
+  STL::multiset<std::pair<int, int>, decltype(by_first)> testSet(by_first);
+  for (int i = 0; i < 5; ++i) testSet.insert({1, i});
+  auto third = testSet.begin();
+  ++third, ++third;
+  testSet.erase(third);
+  int expected[] = {0, 1, 3, 4};
+  int index = 0;
+  for (auto it = testSet.begin(); it != testSet.end(); ++it)
+    EXPECT_EQ((*it).second, expected[index++]);
+
+  STL::multiset<int> values{3, 3, 3, 1, 5};
+  auto it = values.find(3);
+  values.erase(it);
+  EXPECT_EQ(values.count(3), 2);
+  EXPECT_EQ(values.size(), 4);
+
+  STL::multiset<int> large;
+  for (int i = 0; i < 100000; ++i) large.insert(i % 10);
+  EXPECT_EQ(large.count(7), 10000);
+}
+
+TEST(MultiSetTest, EmplaceAndMove) {
+  STL::multiset<Tracked> testSet;
+  Tracked::Reset();
+  auto it = testSet.emplace(3);
+  testSet.emplace_hint(it, 3);
+  testSet.insert(Tracked(1));
+  EXPECT_EQ(Tracked::constructed, 3);
+  EXPECT_EQ(Tracked::copied, 0);
+  EXPECT_EQ(Tracked::moved, 1);
+  EXPECT_EQ(testSet.size(), 3);
+  EXPECT_EQ((*testSet.begin()).value, 1);
+
+  STL::set<std::string> strings;
+  std::string word = "a long string that does not fit into SSO";
+  strings.insert(std::move(word));
+  EXPECT_TRUE(word.empty());
+  EXPECT_TRUE(strings.emplace(5, 'x').second);
+  EXPECT_FALSE(strings.emplace("xxxxx").second);
+  EXPECT_EQ(strings.size(), 2);
+}
+
 TEST(MultiSetTest, SwapMethod) {
   STL::multiset<int> set1{5, 10, 5, 7};
   STL::multiset<int> set2{3, 8, 3};
@@ -177,6 +365,25 @@ TEST(MultiSetTest, UpperBoundMethod) {
   EXPECT_EQ(it3, testSet.end());
 }
 
+TEST(MultiSetTest, InsertWithHint) {
+  STL::multiset<int> testSet;
+  std::multiset<int> stdSet;
+  auto hint = testSet.end();
+  for (int i = 0; i < 200; ++i) {
+    int value = (i / 3) * 2 + (i % 7 == 0);
+    hint = testSet.insert(i % 5 ? testSet.end() : hint, value);
+    stdSet.insert(value);
+  }
+  EXPECT_EQ(testSet.size(), stdSet.size());
+  auto it = testSet.begin();
+  for (int value : stdSet) {
+    EXPECT_EQ(*it, value);
+    ++it;
+  }
+  EXPECT_EQ(testSet.count(4), stdSet.count(4));
+  EXPECT_EQ(testSet.count(5), stdSet.count(5));
+}
+
 TEST(Map, Constructor_Default) {
   STL::map<int, std::string> STL_map;
   std::map<int, std::string> std_map;
@@ -193,6 +400,33 @@ TEST(Map, Constructor_Initializer_list) {
   EXPECT_EQ(STL_map.empty(), std_map.empty());
 }
 
+TEST(Map, Constructor_Range) {
+  std::vector<std::pair<int, std::string>> sorted;
+  for (int i = 0; i < 10000; ++i) sorted.emplace_back(i, std::to_string(i));
+  STL::map<int, std::string> STL_map_1(sorted.begin(), sorted.end());
+  EXPECT_EQ(STL_map_1.size(), 10000);
+  EXPECT_EQ(STL_map_1.at(4321), "4321");
+  int expected = 0;
+  for (auto it = STL_map_1.begin(); it != STL_map_1.end(); ++it)
+    EXPECT_EQ((*it).first, expected++);
+
+  std::vector<std::pair<int, std::string>> unsorted{
+      {3, "c"}, {1, "a"}, {3, "dup"}, {2, "b"}, {1, "dup"}};
+  STL::map<int, std::string> STL_map_2(unsorted.begin(), unsorted.end());
+  std::map<int, std::string> std_map(unsorted.begin(), unsorted.end());
+  EXPECT_EQ(STL_map_2.size(), std_map.size());
+  auto it = STL_map_2.begin();
+  for (const auto &item : std_map) {
+    EXPECT_EQ((*it).first, item.first);
+    EXPECT_EQ((*it).second, item.second);
+    ++it;
+  }
+  STL::map<int, std::string> STL_map_3(STL_map_2.begin(), STL_map_2.end());
+  EXPECT_EQ(STL_map_3.size(), 3);
+  STL::map<int, std::string> STL_map_4{{2, "b"}, {1, "a"}, {2, "x"}};
+  EXPECT_EQ(STL_map_4.at(2), "b");
+}
+
 TEST(Map, Constructor_Copy) {
   STL::map<int, std::string> STL_map_1{
       {1, "aboba"}, {2, "shleppa"}, {3, "amogus"}, {4, "abobus"}};
@@ -211,6 +445,23 @@ TEST(Map, Constructor_Copy) {
   }
 }
 
+TEST(Map, Constructor_Copy_Is_Deep) {
+  STL::map<int, std::string> STL_map_1;
+  for (int i = 0; i < 1000; ++i) STL_map_1.insert(i, std::to_string(i));
+  STL::map<int, std::string> STL_map_2(STL_map_1);
+  STL_map_2[5] = "changed";
+  STL_map_2.erase(STL_map_2.begin());
+  STL_map_2.insert(-1, "new");
+  EXPECT_EQ(STL_map_1.at(5), "5");
+  EXPECT_EQ(STL_map_1.size(), 1000);
+  EXPECT_EQ(STL_map_2.size(), 1000);
+  EXPECT_EQ((*STL_map_1.begin()).first, 0);
+  EXPECT_EQ((*STL_map_2.begin()).first, -1);
+  auto it = STL_map_1.end();
+  for (int i = 0; i < 999; ++i) it = STL_map_1.insert(it, {i, ""});
+  EXPECT_EQ(STL_map_1.size(), 1000);
+}
+
 TEST(Map, Constructor_Move) {
   STL::map<int, std::string> STL_map_1{
       {1, "aboba"}, {2, "shleppa"}, {3, "amogus"}, {4, "abobus"}};
@@ -469,6 +720,51 @@ TEST(Map, Modifier_Mem_Merge) {
   EXPECT_EQ(STL_map_1.size(), STL_map_3.size());
 }
 
+TEST(Map, Modifier_Insert_Hint) {
+  STL::map<int, int> STL_map;
+  auto hint = STL_map.end();
+  for (int i = 0; i < 500; ++i) hint = STL_map.insert(hint, {i, i * i});
+  EXPECT_EQ((*STL_map.insert(STL_map.begin(), {250, 0})).second, 250 * 250);
+  EXPECT_EQ((*STL_map.insert(STL_map.end(), {-1, 1})).first, -1);
+  EXPECT_EQ(STL_map.size(), 501);
+  int expected = -1;
+  for (auto it = STL_map.begin(); it != STL_map.end(); ++it, ++expected) {
+    EXPECT_EQ((*it).first, expected);
+  }
+}
+
+TEST(Map, Modifier_Emplace) {
+  STL::map<int, Tracked> STL_map;
+  Tracked::Reset();
+  EXPECT_TRUE(STL_map.try_emplace(1, 10).second);
+  EXPECT_FALSE(STL_map.try_emplace(1, 20).second);
+  EXPECT_TRUE(STL_map.emplace(2, Tracked(30)).second);
+  EXPECT_FALSE(STL_map.emplace(std::piecewise_construct,
+                               std::forward_as_tuple(2),
+                               std::forward_as_tuple(40))
+                   .second);
+  EXPECT_EQ(Tracked::constructed, 3);
+  EXPECT_EQ(Tracked::copied, 0);
+  EXPECT_EQ(Tracked::moved, 1);
+  auto hint = STL_map.try_emplace(STL_map.end(), 3, 50);
+  EXPECT_EQ((*hint).second.value, 50);
+  EXPECT_EQ((*STL_map.emplace_hint(hint, 4, Tracked(60))).first, 4);
+  EXPECT_EQ(STL_map.at(1).value, 10);
+  EXPECT_EQ(STL_map.at(2).value, 30);
+  EXPECT_EQ(STL_map.size(), 4);
+
+  STL::map<std::string, std::string> strings;
+  std::string key = "key", value = "value";
+  strings.insert_or_assign(std::move(key), std::move(value));
+  EXPECT_TRUE(value.empty());
+  std::string other = "other";
+  strings.insert_or_assign(std::string("key"), other);
+  EXPECT_EQ(strings["key"], "other");
+  EXPECT_EQ(strings.size(), 1);
+  strings[std::string("new")];
+  EXPECT_EQ(strings.size(), 2);
+}
+
 TEST(Map, Lookup_Contains) {
   STL::map<int, std::string> STL_map;
   STL_map.insert(1, "salamandry");
@@ -483,6 +779,51 @@ TEST(Map, Lookup_Contains) {
   EXPECT_EQ(STL_map.contains(-2), false);
   EXPECT_EQ(STL_map.contains(0), false);
 }
+TEST(Map, Lookup_Many_Keys) {
+  STL::map<int, int> STL_map;
+  for (int i = 0; i < 1000; ++i) STL_map.insert((i * 7919) % 1000, i);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(STL_map.contains(i));
+    EXPECT_EQ((STL_map.at(i) * 7919) % 1000, i);
+  }
+  EXPECT_FALSE(STL_map.contains(-1));
+  EXPECT_FALSE(STL_map.contains(1000));
+  EXPECT_ANY_THROW(STL_map.at(1000));
+}
+
+TEST(Map, Lookup_Bounds) {
+  STL::map<int, int> STL_map;
+  std::map<int, int> std_map;
+  for (int i = 0; i < 200; i += 3) {
+    STL_map.insert(i, i);
+    std_map.insert({i, i});
+  }
+  for (int key = -2; key < 205; ++key) {
+    auto it = STL_map.lower_bound(key);
+    auto std_it = std_map.lower_bound(key);
+    if (std_it == std_map.end())
+      EXPECT_TRUE(it == STL_map.end());
+    else
+      EXPECT_EQ((*it).first, std_it->first);
+    it = STL_map.upper_bound(key);
+    std_it = std_map.upper_bound(key);
+    if (std_it == std_map.end())
+      EXPECT_TRUE(it == STL_map.end());
+    else
+      EXPECT_EQ((*it).first, std_it->first);
+  }
+  int sum = 0;
+  for (auto it = STL_map.lower_bound(10); it != STL_map.upper_bound(30); ++it)
+    sum += (*it).second;
+  EXPECT_EQ(sum, 12 + 15 + 18 + 21 + 24 + 27 + 30);
+  auto range = STL_map.equal_range(99);
+  EXPECT_EQ((*range.first).first, 99);
+  EXPECT_EQ((*range.second).first, 102);
+  range = STL_map.equal_range(100);
+  EXPECT_TRUE(range.first == range.second);
+  EXPECT_EQ((*range.first).first, 102);
+}
+
 TEST(Map, Exception_1) {
   STL::map<int, std::string> STL_map;
   STL_map.insert(2, "medoedy");
@@ -588,6 +929,39 @@ TEST(Iterators, End_set) {
   ASSERT_TRUE(it1 == st1.end());
 }
 
+// Итератор, взятый до swap или перемещения, остаётся в своих элементах:
+// шаг назад от конца возвращает последний из них, а не чужой.
+template <class Backend>
+void ExpectEndFollowsElements() {
+  using Set =
+      STL::set<int, std::less<int>, std::allocator<int>, STL::NoAugment,
+               Backend>;
+  Set a{1, 2, 3};
+  Set b{100, 200};
+  auto it = a.find(3);
+  a.swap(b);
+  ++it;
+  EXPECT_TRUE(it == b.end());
+  EXPECT_EQ(*--it, 3);
+  typename Set::const_iterator end = b.end();
+  Set moved(std::move(b));
+  EXPECT_EQ(*--end, 3);
+  ++it;
+  Set assigned;
+  assigned = std::move(moved);
+  EXPECT_EQ(*--it, 3);
+  EXPECT_EQ(*--a.end(), 200);
+  EXPECT_THROW(--b.end(), std::out_of_range);
+}
+
+TEST(Iterators, End_Follows_Elements_After_Swap_And_Move) {
+  ExpectEndFollowsElements<STL::AvlBackend>();
+  ExpectEndFollowsElements<STL::ThreadedBackend>();
+  ExpectEndFollowsElements<STL::BTreeBackend<>>();
+  ExpectEndFollowsElements<STL::CompactBackend>();
+  ExpectEndFollowsElements<STL::PersistentBackend>();
+}
+
 TEST(Capacity, Empty_set) {
   STL::set<int> st1;
   ASSERT_TRUE(st1.empty());
@@ -609,6 +983,20 @@ TEST(LookUp, Contains_set) {
   ASSERT_TRUE(st1.contains(67));
 }
 
+TEST(LookUp, Bounds_set) {
+  STL::set<int> st1{-4, 8, 135, 67, 5, -15, 1};
+  EXPECT_EQ(*st1.lower_bound(5), 5);
+  EXPECT_EQ(*st1.upper_bound(5), 8);
+  EXPECT_EQ(*st1.lower_bound(-100), -15);
+  EXPECT_TRUE(st1.upper_bound(135) == st1.end());
+  auto range = st1.equal_range(67);
+  EXPECT_EQ(*range.first, 67);
+  EXPECT_EQ(*range.second, 135);
+  STL::set<std::string, std::less<>> words{"apple", "banana", "cherry"};
+  EXPECT_EQ(*words.lower_bound(std::string_view("b")), "banana");
+  EXPECT_EQ(*words.upper_bound("banana"), "cherry");
+}
+
 TEST(Modifieres, Clear_set) {
   STL::set<int> st1{-4, 8, 135, 67, 5, -15, 1};
   st1.clear();
@@ -621,6 +1009,25 @@ TEST(Modifieres, Insert_set) {
   ASSERT_TRUE(*st1.begin() == -200);
 }
 
+TEST(Modifieres, Insert_Hint_set) {
+  STL::set<int> st1;
+  std::set<int> st2;
+  for (int i = 0; i < 300; ++i) {
+    int value = i % 2 ? i : 300 - i;
+    st1.insert(st1.find(value - 1) == st1.end() ? st1.begin()
+                                                : st1.find(value - 1),
+               value);
+    st2.insert(value);
+  }
+  EXPECT_EQ(*st1.insert(st1.end(), 150), 150);
+  EXPECT_EQ(st1.size(), st2.size());
+  auto it = st1.begin();
+  for (int value : st2) {
+    EXPECT_EQ(*it, value);
+    ++it;
+  }
+}
+
 TEST(Modifieres, Erase_set) {
   STL::set<int> st1{-4, 8, 135, 67, 5, -15, 1};
   STL::set<int>::iterator it1 = st1.find(8);
@@ -628,6 +1035,31 @@ TEST(Modifieres, Erase_set) {
   // ASSERT_ANY_THROW(*st1.find(8) == 0);
 }
 
+TEST(Modifieres, Erase_Random_set) {
+  STL::set<int> st1;
+  std::set<int> st2;
+  unsigned seed = 12345;
+  for (int i = 0; i < 5000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int value = (seed >> 8) % 1000;
+    if (i % 3 == 2 && st1.contains(value)) {
+      st1.erase(st1.find(value));
+      st2.erase(value);
+    } else {
+      st1.insert(value);
+      st2.insert(value);
+    }
+  }
+  EXPECT_EQ(st1.size(), st2.size());
+  auto it = st1.begin();
+  for (int value : st2) {
+    EXPECT_EQ(*it, value);
+    ++it;
+  }
+  while (!st1.empty()) st1.erase(st1.begin());
+  EXPECT_TRUE(st1.begin() == st1.end());
+}
+
 TEST(Modifieres, Swap_set) {
   STL::set<int> st1{-4, 8, 135, 67, 5, -15, 1};
   STL::set<int> st2{1, 3, 6, 7, -12, 21};
@@ -648,6 +1080,1600 @@ TEST(Const, Iterator_set) {
   ASSERT_TRUE(*it == 5);
 }
 
+TEST(LookUp, Find_Missing_set) {
+  STL::set<int> st1{-4, 8, 135, 67, 5, -15, 1};
+  EXPECT_TRUE(st1.find(7) == st1.end());
+  EXPECT_TRUE(st1.find(-100) == st1.end());
+  EXPECT_TRUE(st1.find(1000) == st1.end());
+  EXPECT_FALSE(st1.contains(0));
+}
+
+TEST(Allocator, NodePool_Reuses_Freed_Objects) {
+  STL::NodePool pool;
+  void *first = pool.Allocate(40);
+  void *second = pool.Allocate(40);
+  EXPECT_NE(first, second);
+  pool.Deallocate(first, 40);
+  EXPECT_EQ(pool.Allocate(40), first);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(second) %
+                alignof(std::max_align_t),
+            0);
+  pool.Deallocate(second, 40);
+}
+
+TEST(Allocator, Counting_Allocator_Owns_Every_Node) {
+  long live = 0;
+  {
+    CountingAllocator<std::pair<int, std::string>> alloc(&live);
+    STL::map<int, std::string, std::less<int>,
+             CountingAllocator<std::pair<int, std::string>>>
+        STL_map(alloc);
+    for (int i = 0; i < 100; ++i) STL_map.insert(i, std::to_string(i));
+    // Плюс одна ячейка якоря итераторов на каждое дерево.
+    EXPECT_EQ(live, 101);
+    STL_map.erase(STL_map.begin());
+    EXPECT_EQ(live, 100);
+    CountingAllocator<int> int_alloc(&live);
+    STL::multiset<int, std::less<int>, CountingAllocator<int>> ms(int_alloc);
+    ms.insert(1);
+    ms.insert(1);
+    EXPECT_EQ(live, 103);
+    EXPECT_TRUE(ms.get_allocator() == CountingAllocator<int>(&live));
+  }
+  EXPECT_EQ(live, 0);
+}
+
+TEST(Allocator, Copy_Assignment_Reuses_Nodes) {
+  long live = 0, total = 0;
+  using Alloc = CountingAllocator<std::pair<int, std::string>>;
+  Alloc alloc(&live, &total);
+  STL::map<int, std::string, std::less<int>, Alloc> source(alloc);
+  STL::map<int, std::string, std::less<int>, Alloc> target(alloc);
+  for (int i = 0; i < 60; ++i) source.insert(i, std::to_string(i));
+  for (int i = 0; i < 100; ++i) target.insert(-i, "old");
+  long before = total;
+  target = source;
+  EXPECT_EQ(total, before);
+  EXPECT_EQ(live, 122);
+  source.insert(100, "extra");
+  target = source;
+  EXPECT_EQ(total, before + 2);
+  EXPECT_EQ(live, 124);
+  target = target;
+  EXPECT_EQ(target.size(), 61);
+  int expected = 0;
+  for (auto it = target.begin(); it != target.end(); ++it, ++expected) {
+    EXPECT_EQ((*it).first, expected == 60 ? 100 : expected);
+  }
+}
+
+TEST(Allocator, Pool_Allocator_Containers) {
+  STL::map<int, std::string, std::less<int>,
+           STL::pool_allocator<std::pair<int, std::string>>>
+      STL_map;
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 1000; ++i) STL_map.insert(i, std::to_string(i));
+    while (STL_map.size() > 10) STL_map.erase(STL_map.begin());
+  }
+  auto copy = STL_map;
+  EXPECT_FALSE(copy.get_allocator() == STL_map.get_allocator());
+  STL::set<int, std::less<int>, STL::pool_allocator<int>> st1{3, 1, 2};
+  STL::set<int, std::less<int>, STL::pool_allocator<int>> st2{7, 8};
+  st1.swap(st2);
+  EXPECT_EQ(st1.size(), 2);
+  EXPECT_EQ(*st2.begin(), 1);
+  STL::multiset<int, std::less<int>, STL::pool_allocator<int>> ms{5, 5, 5};
+  auto moved = std::move(ms);
+  EXPECT_EQ(moved.count(5), 3);
+  EXPECT_EQ(copy.size(), 10);
+  EXPECT_EQ((*copy.begin()).first, 990);
+}
+
+TEST(Allocator, Merge_Splices_Nodes) {
+  long live = 0, total = 0;
+  using Alloc = CountingAllocator<std::pair<int, std::string>>;
+  Alloc alloc(&live, &total);
+  STL::map<int, std::string, std::less<int>, Alloc> target(alloc);
+  STL::map<int, std::string, std::less<int>, Alloc> source(alloc);
+  for (int i = 0; i < 1000; i += 2) target.insert(i, "target");
+  for (int i = 0; i < 1000; i += 3) source.insert(i, "source");
+  long before = total;
+  target.merge(source);
+  EXPECT_EQ(total, before);
+  EXPECT_EQ(live, 500 + 334 + 2);
+  EXPECT_EQ(target.size(), 500 + 167);
+  EXPECT_EQ(source.size(), 167);
+  EXPECT_EQ(target.at(6), "target");
+  EXPECT_EQ(target.at(9), "source");
+  for (auto it = source.begin(); it != source.end(); ++it) {
+    EXPECT_EQ((*it).first % 6, 0);
+    EXPECT_EQ((*it).second, "source");
+  }
+
+  long other_live = 0;
+  STL::map<int, std::string, std::less<int>, Alloc> foreign(
+      Alloc(&other_live, nullptr));
+  foreign.insert(1, "foreign");
+  foreign.insert(2, "foreign");
+  target.merge(foreign);
+  EXPECT_EQ(target.at(1), "foreign");
+  EXPECT_EQ(target.at(2), "target");
+  EXPECT_EQ(foreign.size(), 1);
+  EXPECT_EQ(other_live, 2);
+}
+
+TEST(Modifieres, Set_Algebra) {
+  STL::set<int> evens, threes;
+  for (int i = 0; i < 30000; i += 2) evens.insert(i);
+  for (int i = 0; i < 30000; i += 3) threes.insert(i);
+
+  STL::set<int> both(evens);
+  both.intersect(threes);
+  EXPECT_EQ(both.size(), 5000);
+  int expected = 0;
+  for (auto it = both.begin(); it != both.end(); ++it, expected += 6)
+    EXPECT_EQ(*it, expected);
+
+  STL::set<int> only_evens(evens);
+  only_evens.subtract(threes);
+  EXPECT_EQ(only_evens.size(), 10000);
+  EXPECT_FALSE(only_evens.contains(6));
+  EXPECT_TRUE(only_evens.contains(4));
+
+  STL::set<int> any(evens);
+  any.unite(threes);
+  EXPECT_EQ(any.size(), 20000);
+  EXPECT_EQ(threes.size(), 10000);
+  any.unite(STL::set<int>{-1, 1, 2});
+  EXPECT_EQ(any.size(), 20002);
+  EXPECT_EQ(*any.begin(), -1);
+
+  any.subtract(any);
+  EXPECT_EQ(any.size(), 0);
+  both.intersect(STL::set<int>());
+  EXPECT_EQ(both.size(), 0);
+}
+
+namespace {
+struct NothrowLess {
+  bool operator()(int a, int b) const noexcept { return a < b; }
+};
+
+struct MaybeThrowingLess {
+  bool operator()(int a, int b) const { return a < b; }
+};
+}  // namespace
+
+// noexcept у алгебры множеств следует за noexcept сравнения, иначе
+// исключение из Compare обернулось бы std::terminate.
+TEST(Modifieres, Set_Algebra_Noexcept_Follows_Compare) {
+  using Nothrow = STL::set<int, NothrowLess>;
+  using Maybe = STL::set<int, MaybeThrowingLess>;
+  using NothrowMap = STL::map<int, int, NothrowLess>;
+  using MaybeMap = STL::map<int, int, MaybeThrowingLess>;
+  static_assert(
+      noexcept(std::declval<Nothrow &>().intersect(std::declval<Nothrow &>())));
+  static_assert(
+      noexcept(std::declval<Nothrow &>().subtract(std::declval<Nothrow &>())));
+  static_assert(
+      !noexcept(std::declval<Maybe &>().intersect(std::declval<Maybe &>())));
+  static_assert(
+      !noexcept(std::declval<Maybe &>().subtract(std::declval<Maybe &>())));
+  static_assert(noexcept(
+      std::declval<NothrowMap &>().intersect(std::declval<NothrowMap &>())));
+  static_assert(!noexcept(
+      std::declval<MaybeMap &>().subtract(std::declval<MaybeMap &>())));
+  using NothrowFlat = STL::flat_set<int, NothrowLess>;
+  using MaybeFlat = STL::flat_set<int, MaybeThrowingLess>;
+  static_assert(noexcept(
+      std::declval<NothrowFlat &>().intersect(std::declval<NothrowFlat &>())));
+  static_assert(!noexcept(
+      std::declval<MaybeFlat &>().subtract(std::declval<MaybeFlat &>())));
+  Nothrow values{1, 2, 3, 4};
+  values.subtract(Nothrow{2, 4});
+  values.intersect(Nothrow{1, 3, 5});
+  EXPECT_EQ(values.size(), 2);
+  Maybe other{1, 2, 3};
+  other.intersect(Maybe{2});
+  EXPECT_EQ(*other.begin(), 2);
+}
+
+TEST(MultiSetTest, MergeKeepsOrderOfEqual) {
+  struct ByFirst {
+    bool operator()(const std::pair<int, int> &a,
+                    const std::pair<int, int> &b) const {
+      return a.first < b.first;
+    }
+  };
+  STL::multiset<std::pair<int, int>, ByFirst> set1, set2;
+  for (int i = 0; i < 100; ++i) set1.insert({i % 10, 0});
+  for (int i = 0; i < 100; ++i) set2.insert({i % 10, 1 + i / 10});
+  set1.merge(set2);
+  EXPECT_EQ(set1.size(), 200);
+  EXPECT_EQ(set2.size(), 0);
+  auto it = set1.begin();
+  for (int key = 0; key < 10; ++key) {
+    for (int i = 0; i < 10; ++i, ++it) EXPECT_EQ(*it, std::make_pair(key, 0));
+    for (int i = 1; i <= 10; ++i, ++it) EXPECT_EQ(*it, std::make_pair(key, i));
+  }
+}
+
+TEST(OrderStatistics, Rank_And_Select) {
+  STL::set<int, std::less<int>, std::allocator<int>, STL::SubtreeSize> st;
+  for (int i = 0; i < 1000; ++i) st.insert((i * 7919) % 1000 * 2);
+  for (int i = 0; i < 1000; i += 3) st.erase(st.find(i * 2));
+  std::vector<int> sorted(st.begin(), st.end());
+  for (size_t k = 0; k < sorted.size(); ++k) {
+    EXPECT_EQ(*st.nth(k), sorted[k]);
+    EXPECT_EQ(st.rank(sorted[k]), k);
+  }
+  EXPECT_TRUE(st.nth(sorted.size()) == st.end());
+  EXPECT_EQ(st.rank(-5), 0);
+  EXPECT_EQ(st.rank(5000), sorted.size());
+  EXPECT_EQ(st.count_range(0, 12), 4);
+  EXPECT_EQ(st.count_range(12, 0), 0);
+  EXPECT_EQ(sizeof(STL::TreeNode<int>) + sizeof(size_t),
+            sizeof(STL::TreeNode<int, STL::SubtreeSize>));
+}
+
+TEST(OrderStatistics, Map_And_Multiset) {
+  STL::map<std::string, int, std::less<std::string>,
+           std::allocator<std::pair<std::string, int>>, STL::SubtreeSize>
+      scores{{"carol", 7}, {"alice", 3}, {"bob", 5}};
+  EXPECT_EQ((*scores.nth(1)).first, "bob");
+  EXPECT_EQ(scores.rank("bob"), 1);
+  EXPECT_EQ(scores.count_range("a", "c"), 2);
+  auto copy = scores;
+  copy.insert("aaron", 1);
+  EXPECT_EQ((*copy.nth(0)).first, "aaron");
+  EXPECT_EQ(scores.rank("carol"), 2);
+
+  STL::multiset<int, std::less<int>, std::allocator<int>, STL::SubtreeSize>
+      ms{5, 1, 5, 3, 5, 9};
+  EXPECT_EQ(ms.rank(5), 2);
+  EXPECT_EQ(ms.count_range(5, 6), 3);
+  EXPECT_EQ(*ms.nth(4), 5);
+  EXPECT_EQ(*ms.nth(5), 9);
+  STL::multiset<int, std::less<int>, std::allocator<int>, STL::SubtreeSize>
+      other{0, 5, 10};
+  ms.merge(other);
+  EXPECT_EQ(ms.count_range(5, 6), 4);
+  EXPECT_EQ(*ms.nth(0), 0);
+  EXPECT_EQ(ms.rank(10), 8);
+}
+
+TEST(Aggregate, Map_Sum_Of_Values) {
+  using Pair = std::pair<int, long>;
+  using Augment = STL::MonoidAugment<STL::Sum<long, STL::SelectSecond<Pair>>>;
+  STL::map<int, long, std::less<int>, std::allocator<Pair>, Augment> prices;
+  std::map<int, long> reference;
+  for (int i = 0; i < 2000; ++i) {
+    int key = (i * 7919) % 1500;
+    prices.insert_or_assign(key, i);
+    reference[key] = i;
+  }
+  for (int key = 0; key < 1500; key += 4) {
+    prices.erase(prices.find(key));
+    reference.erase(key);
+  }
+  for (int lo = -10; lo < 1510; lo += 37) {
+    for (int hi = lo; hi < 1520; hi += 101) {
+      long expected = 0;
+      for (auto it = reference.lower_bound(lo); it != reference.lower_bound(hi);
+           ++it)
+        expected += it->second;
+      EXPECT_EQ(prices.aggregate(lo, hi), expected);
+    }
+  }
+  EXPECT_EQ(prices.aggregate(10, 5), 0);
+
+  static_assert(std::is_same_v<decltype(prices[1]), const long &>);
+  long total = prices.aggregate(0, 1500);
+  auto it = prices.find(1);
+  long old = (*it).second;
+  prices.modify(it, [](long &value) { value += 1000; });
+  EXPECT_EQ(prices.aggregate(0, 1500), total + 1000);
+  (*it).second = old;
+  prices.refresh(it);
+  EXPECT_EQ(prices.aggregate(0, 1500), total);
+  EXPECT_THROW(prices.modify(it,
+                             [](long &value) {
+                               value = 7;
+                               throw std::runtime_error("fail");
+                             }),
+               std::runtime_error);
+  EXPECT_EQ(prices.aggregate(0, 1500), total - old + 7);
+  STL::map<int, long, std::less<int>, std::allocator<Pair>, STL::SubtreeSize>
+      counted;
+  counted[1] = 2;
+  EXPECT_EQ(counted.at(1), 2);
+}
+
+TEST(Aggregate, Multiset_Max_And_Order) {
+  STL::multiset<int, std::less<int>, std::allocator<int>,
+                STL::MonoidAugment<STL::Max<int>>>
+      ms{4, 8, 8, 15, 16, 23, 42};
+  EXPECT_EQ(ms.aggregate(0, 100), 42);
+  EXPECT_EQ(ms.aggregate(8, 16), 15);
+  EXPECT_EQ(ms.aggregate(9, 15), std::numeric_limits<int>::lowest());
+
+  struct Digits {
+    struct value_type {
+      long long value, scale;
+    };
+    static value_type identity() noexcept { return {0, 1}; }
+    static value_type lift(int element) noexcept { return {element % 10, 10}; }
+    static value_type combine(value_type a, value_type b) noexcept {
+      return {a.value * b.scale + b.value, a.scale * b.scale};
+    }
+  };
+  STL::set<int, std::less<int>, std::allocator<int>, STL::MonoidAugment<Digits>>
+      st;
+  for (int i = 9; i > 0; --i) st.insert(i);
+  EXPECT_EQ(st.aggregate(2, 7).value, 23456);
+  EXPECT_EQ(st.aggregate(0, 10).value, 123456789);
+  EXPECT_EQ(sizeof(STL::TreeNode<int>),
+            sizeof(STL::TreeNode<int, STL::NoAugment>));
+}
+
+TEST(BTreeBackend, Map_Matches_Avl) {
+  STL::map<int, std::string, std::less<int>,
+           std::allocator<std::pair<int, std::string>>, STL::NoAugment,
+           STL::BTreeBackend<64>>
+      btree_map{{5, "five"}, {1, "one"}, {3, "three"}};
+  std::map<int, std::string> std_map{{5, "five"}, {1, "one"}, {3, "three"}};
+  for (int i = 0; i < 5000; ++i) {
+    int key = (i * 7919) % 3000;
+    if (i % 3 == 2) {
+      auto it = btree_map.find(key);
+      EXPECT_EQ(it != btree_map.end(), std_map.erase(key) == 1);
+      if (it != btree_map.end()) btree_map.erase(it);
+    } else {
+      btree_map[key] = std::to_string(i);
+      std_map[key] = std::to_string(i);
+    }
+  }
+  EXPECT_EQ(btree_map.size(), std_map.size());
+  auto it = btree_map.begin();
+  for (const auto &item : std_map) {
+    EXPECT_EQ((*it).first, item.first);
+    EXPECT_EQ((*it).second, item.second);
+    ++it;
+  }
+  EXPECT_TRUE(it == btree_map.end());
+  EXPECT_THROW(++it, std::out_of_range);
+  EXPECT_THROW(btree_map.at(-1), std::out_of_range);
+  EXPECT_EQ((*btree_map.lower_bound(2999)).first, std_map.rbegin()->first);
+  EXPECT_TRUE(btree_map.upper_bound(3000) == btree_map.end());
+  auto copy = btree_map;
+  int first = (*copy.begin()).first;
+  EXPECT_FALSE(copy.insert_or_assign(first, "changed").second);
+  EXPECT_EQ(copy.at(first), "changed");
+  EXPECT_NE(btree_map.at(first), "changed");
+}
+
+TEST(BTreeBackend, Set_And_Multiset) {
+  using Backend = STL::BTreeBackend<16>;
+  STL::set<int, std::less<int>, std::allocator<int>, STL::NoAugment, Backend>
+      st{9, 3, 7, 1, 5};
+  std::vector<int> backward;
+  auto it = st.end();
+  for (it = st.find(9);; --it) {
+    backward.push_back(*it);
+    if (it == st.begin()) break;
+  }
+  EXPECT_EQ(backward, std::vector<int>({9, 7, 5, 3, 1}));
+  STL::set<int, std::less<int>, std::allocator<int>, STL::NoAugment, Backend>
+      other{1, 2, 3, 4};
+  st.merge(other);
+  EXPECT_EQ(st.size(), 7);
+  EXPECT_EQ(other.size(), 2);
+  st.subtract(STL::set<int, std::less<int>, std::allocator<int>,
+                       STL::NoAugment, Backend>{1, 9});
+  EXPECT_EQ(*st.begin(), 2);
+
+  STL::multiset<int, std::less<int>, std::allocator<int>, STL::NoAugment,
+                Backend>
+      ms;
+  for (int i = 0; i < 1000; ++i) ms.insert(i % 10);
+  EXPECT_EQ(ms.size(), 1000);
+  EXPECT_EQ(ms.count(7), 100);
+  auto range = ms.equal_range(3);
+  EXPECT_EQ(*range.first, 3);
+  EXPECT_EQ(*range.second, 4);
+  while (ms.size() > 1) ms.erase(ms.begin());
+  EXPECT_EQ(*ms.begin(), 9);
+}
+
+namespace {
+// Копия бросает, когда счётчик copies_left исчерпан.
+struct Fragile {
+  explicit Fragile(int value) : value(value) { ++alive; }
+  Fragile(const Fragile &other) : value(other.value) {
+    if (--copies_left < 0) throw std::runtime_error("copy");
+    ++alive;
+  }
+  ~Fragile() { --alive; }
+  bool operator<(const Fragile &other) const { return value < other.value; }
+  int value;
+  static int alive, copies_left;
+};
+int Fragile::alive = 0, Fragile::copies_left = 0;
+
+struct CountingLess {
+  bool operator()(int a, int b) const {
+    ++*calls;
+    return a < b;
+  }
+  long *calls;
+};
+}  // namespace
+
+TEST(CompactBackend, Arena_Grows_And_Reuses_Freed_Nodes) {
+  using Tree = STL::CompactTree<long>;
+  EXPECT_LE(sizeof(Tree::Node), sizeof(STL::TreeNode<long>) * 2 / 3);
+  long live = 0, total = 0;
+  using Alloc = CountingAllocator<int>;
+  using Set =
+      STL::set<int, std::less<int>, Alloc, STL::NoAugment, STL::CompactBackend>;
+  {
+    Alloc alloc(&live, &total);
+    Set st(alloc);
+    const int &one = *st.insert(1).first;
+    for (int i = 0; i < 5000; ++i) st.insert(i);
+    EXPECT_EQ(&one, &*st.find(1));
+    long grown = total;
+    for (int i = 0; i < 5000; i += 2) st.erase(st.find(i));
+    for (int i = 5000; i < 7500; ++i) st.insert(i);
+    EXPECT_EQ(total, grown);
+    EXPECT_EQ(&one, &*st.find(1));
+    EXPECT_EQ(st.size(), 5000);
+
+    Set copy(st);
+    EXPECT_TRUE(std::equal(st.begin(), st.end(), copy.begin(), copy.end()));
+    Set moved(std::move(copy));
+    EXPECT_TRUE(copy.empty());
+    copy.insert(42);
+    EXPECT_EQ(*copy.begin(), 42);
+    EXPECT_EQ(moved.size(), 5000);
+  }
+  EXPECT_EQ(live, 0);
+}
+
+TEST(CompactBackend, Builds_Sorted_Ranges_In_Linear_Time) {
+  long comparisons = 0;
+  std::vector<int> sorted;
+  for (int i = 0; i < 4096; ++i) sorted.push_back(i / 2);
+  STL::multiset<int, CountingLess, std::allocator<int>, STL::NoAugment,
+                STL::CompactBackend>
+      ms(sorted.begin(), sorted.end(), CountingLess{&comparisons});
+  EXPECT_EQ(comparisons, 4095);
+  EXPECT_TRUE(std::equal(ms.begin(), ms.end(), sorted.begin(), sorted.end()));
+  comparisons = 0;
+  EXPECT_EQ(*ms.find(1234), 1234);
+  EXPECT_LE(comparisons, 2 * 13);
+
+  std::vector<std::pair<int, std::string>> pairs{
+      {3, "c"}, {1, "a"}, {3, "x"}, {2, "b"}};
+  STL::map<int, std::string, std::less<int>,
+           std::allocator<std::pair<int, std::string>>, STL::NoAugment,
+           STL::CompactBackend>
+      compact_map(pairs.begin(), pairs.end());
+  EXPECT_EQ(compact_map.size(), 3);
+  EXPECT_EQ(compact_map.at(3), "c");
+  EXPECT_EQ((*compact_map.begin()).second, "a");
+
+  long live = 0;
+  std::vector<Fragile> values;
+  values.reserve(3000);
+  for (int i = 0; i < 3000; ++i) values.emplace_back(i);
+  Fragile::copies_left = 2000;
+  using Set = STL::set<Fragile, std::less<Fragile>, CountingAllocator<Fragile>,
+                       STL::NoAugment, STL::CompactBackend>;
+  EXPECT_THROW(Set(values.begin(), values.end(), std::less<Fragile>(),
+                   CountingAllocator<Fragile>(&live)),
+               std::runtime_error);
+  EXPECT_EQ(live, 0);
+  EXPECT_EQ(Fragile::alive, 3000);
+}
+
+TEST(FlatContainers, Merge_Keeps_Sorted_Order_And_Rejects) {
+  struct ByFirst {
+    bool operator()(const std::pair<int, int> &a,
+                    const std::pair<int, int> &b) const {
+      return a.first < b.first;
+    }
+  };
+  using Multiset = STL::flat_multiset<std::pair<int, int>, ByFirst>;
+  using Pairs = std::vector<std::pair<int, int>>;
+  Multiset own{{2, 0}, {4, 0}, {4, 1}, {9, 0}};
+  Multiset more{{0, 5}, {4, 5}, {4, 6}, {9, 5}, {12, 5}};
+  own.merge(more);
+  EXPECT_TRUE(more.empty());
+  EXPECT_EQ(Pairs(own.begin(), own.end()),
+            (Pairs{{0, 5}, {2, 0}, {4, 0}, {4, 1}, {4, 5}, {4, 6}, {9, 0},
+                   {9, 5}, {12, 5}}));
+
+  STL::flat_map<int, std::string> target{{1, "a"}, {3, "c"}, {5, "e"}};
+  STL::flat_map<int, std::string> source{
+      {0, "z"}, {1, "x"}, {4, "d"}, {5, "y"}, {7, "g"}};
+  target.merge(source);
+  EXPECT_EQ(target.size(), 6);
+  EXPECT_EQ(target.at(1), "a");
+  EXPECT_EQ(target.at(5), "e");
+  EXPECT_EQ(target.at(0), "z");
+  using Entries = std::vector<std::pair<int, std::string>>;
+  EXPECT_EQ(Entries(source.begin(), source.end()),
+            (Entries{{1, "x"}, {5, "y"}}));
+  target.merge(target);
+  EXPECT_EQ(target.size(), 6);
+  STL::flat_map<int, std::string> empty;
+  empty.merge(target);
+  EXPECT_TRUE(target.empty());
+  EXPECT_EQ((*empty.nth(5)).first, 7);
+}
+
+TEST(FlatContainers, Filter_Assign_And_Positional_Erase) {
+  STL::flat_set<int> values{1, 2, 3, 5, 8, 13, 21};
+  STL::flat_set<int> probes{0, 2, 3, 4, 21, 40};
+  STL::flat_set<int> common = values;
+  common.intersect(probes);
+  EXPECT_EQ(std::vector<int>(common.begin(), common.end()),
+            (std::vector<int>{2, 3, 21}));
+  STL::flat_set<int> rest = values;
+  rest.subtract(probes);
+  EXPECT_EQ(std::vector<int>(rest.begin(), rest.end()),
+            (std::vector<int>{1, 5, 8, 13}));
+  rest.intersect(STL::flat_set<int>());
+  EXPECT_TRUE(rest.empty());
+  common.intersect(common);
+  EXPECT_EQ(common.size(), 3);
+  common.subtract(common);
+  EXPECT_TRUE(common.empty());
+
+  std::vector<std::pair<int, std::string>> pairs{
+      {3, "c"}, {1, "a"}, {3, "x"}, {2, "b"}, {1, "y"}};
+  STL::flat_map<int, std::string> assigned(pairs.begin(), pairs.end());
+  EXPECT_EQ(assigned.size(), 3);
+  EXPECT_EQ(assigned.at(1), "a");
+  EXPECT_EQ(assigned.at(3), "c");
+  EXPECT_EQ(assigned.rank(3), 2);
+
+  values.erase(values.find(5));
+  EXPECT_EQ(*values.nth(3), 8);
+  auto it = values.insert(values.begin(), 4);
+  EXPECT_EQ(*it, 4);
+  EXPECT_EQ(*++it, 8);
+  it = values.end();
+  EXPECT_EQ(*--it, 21);
+  values.erase(it);
+  EXPECT_EQ(std::vector<int>(values.begin(), values.end()),
+            (std::vector<int>{1, 2, 3, 4, 8, 13}));
+}
+
+TEST(FlatContainers, Conversion_And_Algebra) {
+  STL::set<int> tree{8, 2, 6, 4};
+  STL::flat_set<int> flat(tree);
+  EXPECT_EQ(std::vector<int>(flat.begin(), flat.end()),
+            std::vector<int>({2, 4, 6, 8}));
+  STL::set<int> back(flat);
+  EXPECT_EQ(back.size(), 4);
+  EXPECT_TRUE(back.contains(6));
+
+  STL::flat_set<int> other{1, 2, 3, 4};
+  STL::flat_set<int> united = flat;
+  united.unite(other);
+  EXPECT_EQ(united.size(), 6);
+  STL::flat_set<int> common = flat;
+  common.intersect(other);
+  EXPECT_EQ(std::vector<int>(common.begin(), common.end()),
+            std::vector<int>({2, 4}));
+  flat.subtract(other);
+  EXPECT_EQ(std::vector<int>(flat.begin(), flat.end()),
+            std::vector<int>({6, 8}));
+  flat.merge(other);
+  EXPECT_EQ(flat.size(), 6);
+  EXPECT_TRUE(other.empty());
+
+  STL::flat_multiset<int> ms{3, 1, 3, 2};
+  STL::flat_multiset<int> more{3, 0};
+  ms.merge(more);
+  EXPECT_EQ(std::vector<int>(ms.begin(), ms.end()),
+            std::vector<int>({0, 1, 2, 3, 3, 3}));
+  EXPECT_EQ(ms.count(3), 3);
+  STL::multiset<int> tree_ms(ms);
+  EXPECT_EQ(tree_ms.count(3), 3);
+}
+
+template <class T>
+void ExpectKernelsMatchScalar(const std::vector<T> &keys,
+                              const std::vector<T> &queries) {
+  namespace simd = STL::simd;
+  for (size_t n = 0; n <= keys.size(); ++n) {
+    for (T key : queries) {
+      size_t lower = simd::ScalarCount<false>(keys.data(), n, key);
+      size_t upper = simd::ScalarCount<true>(keys.data(), n, key);
+      EXPECT_EQ(simd::LowerIndex(keys.data(), n, key), lower);
+      EXPECT_EQ(simd::UpperIndex(keys.data(), n, key), upper);
+#ifdef STL_SIMD_X86
+      // Каждое ядро отдельно, а не только то, что выбрано на этой машине.
+      using Sse2 = simd::Sse2Ops<T>;
+      if constexpr (Sse2::kEnabled) {
+        EXPECT_EQ((simd::Sse2Count<false, Sse2>(keys.data(), n, key)), lower);
+        EXPECT_EQ((simd::Sse2Count<true, Sse2>(keys.data(), n, key)), upper);
+      }
+      using Avx2 = simd::Avx2Ops<T>;
+      if constexpr (Avx2::kEnabled) {
+        if (__builtin_cpu_supports("avx2")) {
+          EXPECT_EQ((simd::Avx2Count<false, Avx2>(keys.data(), n, key)),
+                    lower);
+          EXPECT_EQ((simd::Avx2Count<true, Avx2>(keys.data(), n, key)),
+                    upper);
+        }
+      }
+#endif
+    }
+  }
+}
+
+TEST(SimdSearch, Kernels_Match_Scalar) {
+  std::vector<int64_t> signed_keys;
+  std::vector<uint32_t> unsigned_keys;
+  std::vector<double> double_keys;
+  for (int i = -20; i < 20; ++i) {
+    signed_keys.push_back(int64_t(i) * 3);
+    unsigned_keys.push_back(uint32_t(i + 20) * 0x5000000u);
+    double_keys.push_back(i / 4.0);
+  }
+  signed_keys.insert(signed_keys.begin() + 10, signed_keys[10]);
+  ExpectKernelsMatchScalar(
+      signed_keys, {std::numeric_limits<int64_t>::min(), -31, -30, 0, 1, 56,
+                    std::numeric_limits<int64_t>::max()});
+  ExpectKernelsMatchScalar(unsigned_keys,
+                           {0u, 1u, 0x5000000u, 0x80000000u, 0xffffffffu});
+  ExpectKernelsMatchScalar(double_keys, {-10.0, -0.25, 0.0, 0.3, 4.75, 9.0});
+  std::vector<int32_t> int_keys;
+  std::vector<float> float_keys;
+  for (int i = -20; i < 20; ++i) {
+    int_keys.push_back(i * 100000000);
+    float_keys.push_back(i / 8.0f);
+  }
+  int_keys.insert(int_keys.begin() + 7, 3, int_keys[7]);
+  ExpectKernelsMatchScalar(
+      int_keys, {std::numeric_limits<int32_t>::min(), -1300000000, 0, 1,
+                 std::numeric_limits<int32_t>::max()});
+  ExpectKernelsMatchScalar(float_keys, {-3.0f, -0.125f, 0.0f, 0.1f, 2.5f});
+
+  STL::flat_set<uint32_t> flat;
+  STL::set<uint32_t, std::less<uint32_t>, std::allocator<uint32_t>,
+           STL::NoAugment, STL::BTreeBackend<64>>
+      btree;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    flat.insert(i * 0x400000u);
+    btree.insert(i * 0x400000u);
+  }
+  for (uint32_t i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(flat.contains(i * 0x400000u));
+    EXPECT_TRUE(btree.contains(i * 0x400000u));
+    EXPECT_FALSE(flat.contains(i * 0x400000u + 1));
+    EXPECT_FALSE(btree.contains(i * 0x400000u + 1));
+  }
+  EXPECT_EQ(*flat.upper_bound(0x80000000u), 0x80400000u);
+  EXPECT_EQ(*btree.lower_bound(0x80000001u), 0x80400000u);
+}
+
+TEST(UnorderedMap, Reserve_Counts_Tombstones) {
+  STL::unordered_map<int, int> table;
+  table.reserve(1000);
+  size_t limit = size_t(float(table.bucket_count()) * table.max_load_factor());
+  for (int i = 0; i < int(limit); ++i) table[i] = i;
+  for (int i = 0; i < int(limit); i += 2) EXPECT_EQ(table.erase(i), 1);
+  table.reserve(limit);
+  size_t buckets = table.bucket_count();
+  const int *kept = &table.at(1);
+  for (int i = int(limit); table.size() < limit; ++i) table[i] = i;
+  EXPECT_EQ(table.bucket_count(), buckets);
+  EXPECT_EQ(kept, &table.at(1));
+  EXPECT_EQ(table.at(int(limit)), int(limit));
+  EXPECT_THROW(table.at(0), std::out_of_range);
+}
+
+TEST(UnorderedMap, Tombstone_Churn_Rehashes_In_Place) {
+  STL::unordered_map<int, std::string> table;
+  table.reserve(512);
+  size_t buckets = table.bucket_count();
+  std::unordered_map<int, std::string> std_table;
+  for (int i = 0; i < 128; ++i) {
+    table.insert_or_assign(i, std::to_string(i));
+    std_table[i] = std::to_string(i);
+  }
+  for (int i = 128; i < 20000; ++i) {
+    EXPECT_EQ(table.erase(i - 128), 1);
+    std_table.erase(i - 128);
+    table[i] = std::to_string(i);
+    std_table[i] = std::to_string(i);
+  }
+  EXPECT_EQ(table.bucket_count(), buckets);
+  EXPECT_EQ(table.size(), std_table.size());
+  for (const auto &item : std_table)
+    EXPECT_EQ(table.at(item.first), item.second);
+  size_t visited = 0;
+  for (auto it = table.begin(); it != table.end(); ++it) ++visited;
+  EXPECT_EQ(visited, std_table.size());
+  EXPECT_THROW(++table.end(), std::out_of_range);
+
+  auto copy = table;
+  EXPECT_FALSE(copy.insert_or_assign(19999, "changed").second);
+  EXPECT_NE(table.at(19999), "changed");
+  auto moved = std::move(copy);
+  EXPECT_TRUE(copy.empty());
+  EXPECT_EQ(moved.at(19999), "changed");
+}
+
+namespace {
+// Хеш, который бросает на ключе 13.
+struct PickyHash {
+  size_t operator()(int key) const {
+    if (key == 13) throw std::runtime_error("hash");
+    return std::hash<int>()(key);
+  }
+};
+
+struct NothrowHash {
+  size_t operator()(int key) const noexcept { return std::hash<int>()(key); }
+};
+
+struct NothrowEqual {
+  bool operator()(int a, int b) const noexcept { return a == b; }
+};
+}  // namespace
+
+TEST(UnorderedSet, Throwing_Hash_Propagates) {
+  using Picky = STL::unordered_set<int, PickyHash>;
+  using Nothrow = STL::unordered_set<int, NothrowHash, NothrowEqual>;
+  static_assert(!noexcept(std::declval<Picky &>().erase(0)));
+  static_assert(
+      !noexcept(std::declval<Picky &>().subtract(std::declval<Picky &>())));
+  static_assert(noexcept(std::declval<Nothrow &>().erase(0)));
+  static_assert(
+      noexcept(std::declval<Nothrow &>().intersect(std::declval<Nothrow &>())));
+  Picky values{1, 2, 3};
+  EXPECT_THROW(values.erase(13), std::runtime_error);
+  EXPECT_THROW(values.insert(13), std::runtime_error);
+  EXPECT_EQ(values.size(), 3);
+  Picky common{2, 3};
+  values.intersect(common);
+  EXPECT_EQ(values.size(), 2);
+}
+
+// Константный контейнер не даёт изменить элемент: const-перегрузки
+// возвращают const_iterator и const K &, обычные - изменяемые.
+TEST(UnorderedMap, Const_Accessors_Return_Const) {
+  using Map = STL::unordered_map<int, std::string>;
+  using Set = STL::unordered_set<int>;
+  Map table{{1, "one"}, {2, "two"}};
+  const Map &view = table;
+  static_assert(std::is_same_v<decltype(view.at(1)), const std::string &>);
+  static_assert(std::is_same_v<decltype(view.begin()), Map::const_iterator>);
+  static_assert(std::is_same_v<decltype(view.end()), Map::const_iterator>);
+  static_assert(std::is_same_v<decltype(view.find(1)), Map::const_iterator>);
+  static_assert(std::is_same_v<decltype(view.equal_range(1).second),
+                               Map::const_iterator>);
+  static_assert(std::is_same_v<decltype(table.find(1)), Map::iterator>);
+  static_assert(std::is_same_v<decltype(table.equal_range(1).first),
+                               Map::iterator>);
+  static_assert(std::is_same_v<decltype(table.at(1)), std::string &>);
+  table.at(1) = "uno";
+  (*table.find(2)).second = "dos";
+  EXPECT_EQ(view.at(1), "uno");
+  EXPECT_EQ((*view.find(2)).second, "dos");
+  EXPECT_THROW(view.at(3), std::out_of_range);
+  auto range = view.equal_range(2);
+  EXPECT_EQ(std::distance(range.first, range.second), 1);
+  Map::const_iterator it = table.begin();
+  EXPECT_TRUE(it != view.end());
+
+  Set values{5, 6};
+  const Set &values_view = values;
+  static_assert(
+      std::is_same_v<decltype(values_view.begin()), Set::const_iterator>);
+  static_assert(
+      std::is_same_v<decltype(values_view.find(5)), Set::const_iterator>);
+  static_assert(std::is_same_v<decltype(values_view.equal_range(5).first),
+                               Set::const_iterator>);
+  static_assert(std::is_same_v<decltype(values.find(5)), Set::iterator>);
+  EXPECT_EQ(*values_view.find(6), 6);
+  EXPECT_TRUE(values_view.find(7) == values_view.end());
+  auto found = values.equal_range(5);
+  values.erase(found.first);
+  EXPECT_FALSE(values_view.contains(5));
+}
+
+TEST(UnorderedSet, Lookup_Algebra_And_Capacity) {
+  STL::unordered_set<std::string, StringHash, std::equal_to<>> words{
+      "alpha", "beta", "gamma"};
+  std::string_view key = "beta";
+  EXPECT_TRUE(words.contains(key));
+  EXPECT_EQ(*words.find(key), "beta");
+  EXPECT_TRUE(words.find(std::string_view("delta")) == words.end());
+  EXPECT_EQ(words.count(std::string_view("gamma")), 1);
+
+  STL::unordered_set<int> st;
+  st.reserve(1000);
+  size_t buckets = st.bucket_count();
+  EXPECT_GE(buckets * st.max_load_factor(), 1000);
+  for (int i = 0; i < 1000; ++i) st.insert(i);
+  EXPECT_EQ(st.bucket_count(), buckets);
+  st.max_load_factor(0.5f);
+  EXPECT_LE(st.load_factor(), 0.5f);
+  EXPECT_THROW(st.max_load_factor(0.0f), std::invalid_argument);
+  st.max_load_factor(2.0f);
+  EXPECT_LT(st.max_load_factor(), 1.0f);
+  for (int i = 0; i < 1000; i += 2) st.erase(st.find(i));
+  st.rehash(0);
+  EXPECT_EQ(st.size(), 500);
+  EXPECT_LT(st.bucket_count(), buckets);
+  EXPECT_TRUE(st.contains(999));
+  EXPECT_FALSE(st.contains(998));
+
+  STL::unordered_set<int> other{1, 2, 3, 4};
+  STL::unordered_set<int> common{1, 2, 3, 4, 5};
+  common.intersect(st);
+  EXPECT_EQ(common.size(), 3);
+  st.merge(other);
+  EXPECT_EQ(st.size(), 502);
+  EXPECT_EQ(other.size(), 2);
+  st.subtract(other);
+  EXPECT_FALSE(st.contains(1));
+  EXPECT_TRUE(st.contains(2));
+}
+
+TEST(Concurrent, Map_Updates_From_Threads) {
+  STL::concurrent_map<int, long> counters;
+  for (int key = 0; key < 100; ++key) EXPECT_TRUE(counters.insert(key, 0));
+  EXPECT_FALSE(counters.insert(0, 5));
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 8; ++t) {
+    workers.emplace_back([&counters, t] {
+      for (int i = 0; i < 5000; ++i) {
+        counters.find_and_update(i % 100, [](long &value) { ++value; });
+        int own = 1000 + t * 5000 + i;
+        counters.insert_or_assign(own, long(i));
+        if (i % 2) counters.erase(own - 1);
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  for (int key = 0; key < 100; ++key) EXPECT_EQ(*counters.find(key), 400);
+  EXPECT_FALSE(counters.find(1000).has_value());
+  EXPECT_EQ(counters.size(), 100 + 8 * 2500);
+
+  EXPECT_FALSE(counters.erase_if(0, [](long value) { return value < 400; }));
+  EXPECT_TRUE(counters.erase_if(0, [](long value) { return value == 400; }));
+  EXPECT_EQ(counters.erase_if([](const std::pair<int, long> &item) {
+    return item.first >= 1000;
+  }), 8 * 2500);
+  auto snapshot = counters.snapshot();
+  EXPECT_EQ(snapshot.size(), 99);
+  EXPECT_EQ((*snapshot.begin()).first, 1);
+  long total = 0;
+  counters.for_each(
+      [&total](const std::pair<int, long> &item) { total += item.second; });
+  EXPECT_EQ(total, 99 * 400);
+}
+
+TEST(Concurrent, Set_Insert_And_Erase_From_Threads) {
+  STL::concurrent_set<int, std::less<int>, std::hash<int>,
+                      std::allocator<int>, 8>
+      st;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&st, t] {
+      for (int i = t; i < 4000; i += 4) st.insert(i);
+      for (int i = t; i < 4000; i += 8) st.erase(i);
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  EXPECT_EQ(st.size(), 2000);
+  EXPECT_TRUE(st.contains(4));
+  EXPECT_FALSE(st.contains(8));
+  EXPECT_EQ(st.erase_if([](int key) { return key < 100; }), 48);
+  EXPECT_EQ(*st.snapshot().begin(), 100);
+}
+
+namespace {
+// Значение, которое помнит, живо ли оно: деструктор портит проверочное
+// поле, а общий счётчик показывает, сколько значений ещё не освобождено.
+struct Guarded {
+  explicit Guarded(int id) : key(id), check(~id) { ++live; }
+  Guarded(const Guarded &other) : key(other.key), check(other.check) {
+    ++live;
+  }
+  ~Guarded() {
+    check = 0;
+    --live;
+  }
+  bool Alive() const { return check == ~key; }
+  bool operator<(const Guarded &other) const { return key < other.key; }
+
+  static inline std::atomic<long> live{0};
+  int key;
+  int check;
+};
+}  // namespace
+
+TEST(LockFree, Erased_Nodes_Outlive_Iterators_And_Are_Reclaimed) {
+  {
+    STL::lockfree_set<Guarded> st;
+    for (int key = 0; key < 256; ++key) st.emplace(key);
+    // Итератор на удалённый узел держит эпоху: сколько бы писатели ни
+    // списывали узлов после него, его узел не освобождается.
+    auto pinned = st.find(Guarded(100));
+    EXPECT_EQ(st.erase(Guarded(100)), 1);
+    for (int round = 0; round < 50; ++round) {
+      for (int key = 0; key < 256; key += 3) st.erase(Guarded(key));
+      for (int key = 0; key < 256; key += 3) st.emplace(key);
+    }
+    EXPECT_TRUE((*pinned).Alive());
+    EXPECT_EQ((*pinned).key, 100);
+    EXPECT_FALSE(st.contains(Guarded(100)));
+    pinned = st.end();
+
+    std::atomic<bool> done{false};
+    std::atomic<int> violations{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+      readers.emplace_back([&st, &done, &violations] {
+        while (!done.load()) {
+          // Узел под итератором может быть удалён прямо сейчас, но
+          // память остаётся за ним до конца обхода.
+          for (auto it = st.begin(); it != st.end(); ++it)
+            if (!(*it).Alive()) ++violations;
+          auto held = st.lower_bound(Guarded(128));
+          std::this_thread::yield();
+          if (held != st.end() && !(*held).Alive()) ++violations;
+        }
+      });
+    }
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+      writers.emplace_back([&st, t] {
+        for (int round = 0; round < 200; ++round) {
+          for (int key = t; key < 256; key += 4) st.erase(Guarded(key));
+          for (int key = t; key < 256; key += 4) st.emplace(key);
+        }
+      });
+    }
+    for (auto &writer : writers) writer.join();
+    done = true;
+    for (auto &reader : readers) reader.join();
+    EXPECT_EQ(violations.load(), 0);
+    EXPECT_EQ(st.size(), 256);
+    EXPECT_GE(Guarded::live.load(), 256);
+  }
+  // Всё списанное, но ещё не освобождённое, отдаёт деструктор.
+  EXPECT_EQ(Guarded::live.load(), 0);
+
+  STL::lockfree_map<std::string, int, std::less<>> words{{"b", 2}, {"a", 1}};
+  EXPECT_EQ((*words.find(std::string_view("a"))).second, 1);
+  EXPECT_EQ(words.erase(std::string_view("b")), 1);
+  EXPECT_FALSE(words.contains("b"));
+}
+
+TEST(LockFree, Readers_During_Write_Bursts) {
+  STL::lockfree_map<int, int> table;
+  for (int key = 0; key < 1000; key += 2) table.insert(key, key);
+  std::atomic<bool> done{false};
+  std::atomic<int> violations{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&table, &done, &violations] {
+      while (!done.load()) {
+        // Чётные ключи не трогают, их всегда видно; обход упорядочен.
+        for (int key = 0; key < 1000; key += 50)
+          if (!table.contains(key) || table.at(key) != key) ++violations;
+        int previous = -1;
+        int even = 0;
+        for (auto it = table.lower_bound(0); it != table.end(); ++it) {
+          if ((*it).first <= previous) ++violations;
+          if ((*it).first % 2 == 0) ++even;
+          previous = (*it).first;
+        }
+        if (even != 500) ++violations;
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&table, t] {
+      for (int round = 0; round < 20; ++round) {
+        for (int key = 1 + 2 * t; key < 1000; key += 8)
+          table.insert(key, key);
+        for (int key = 1 + 2 * t; key < 1000; key += 8) table.erase(key);
+      }
+      for (int key = 1 + 2 * t; key < 1000; key += 16) table.insert(key, key);
+    });
+  }
+  for (auto &writer : writers) writer.join();
+  done = true;
+  for (auto &thread : threads) thread.join();
+  EXPECT_EQ(violations.load(), 0);
+  EXPECT_EQ(table.size(), 500 + 4 * 63);
+  EXPECT_EQ((*table.upper_bound(996)).first, 997);
+}
+
+TEST(Persistent, Snapshot_Is_Isolated) {
+  STL::persistent_map<int, int> table;
+  std::map<int, int> reference;
+  for (int key = 0; key < 500; ++key) {
+    table.insert(key, key);
+    reference[key] = key;
+  }
+  auto snapshot = table.snapshot();
+  std::map<int, int> frozen = reference;
+  for (int i = 0; i < 1500; ++i) {
+    int key = (i * 37) % 700;
+    if (i % 4 == 0) {
+      auto it = table.find(key);
+      if (it != table.end()) table.erase(it);
+      reference.erase(key);
+    } else if (i % 4 == 1) {
+      table[key] = -i;
+      reference[key] = -i;
+    } else {
+      table.insert_or_assign(key, i);
+      reference[key] = i;
+    }
+    if (i == 700) snapshot = table.snapshot(), frozen = reference;
+  }
+  for (auto it = table.begin(); it != table.end(); ++it) ++(*it).second;
+  for (auto &item : reference) ++item.second;
+  EXPECT_EQ(table.size(), reference.size());
+  std::map<int, int> current(table.begin(), table.end());
+  std::map<int, int> seen(snapshot.begin(), snapshot.end());
+  EXPECT_TRUE(current == reference);
+  EXPECT_EQ(snapshot.size(), frozen.size());
+  EXPECT_TRUE(seen == frozen);
+  auto last = table.end();
+  --last;
+  EXPECT_EQ((*last).first, (*reference.rbegin()).first);
+
+  STL::persistent_set<int> st{1, 2, 3, 4, 5, 6};
+  STL::persistent_set<int> copy(st);
+  st.subtract(STL::persistent_set<int>{2, 4});
+  copy.intersect(STL::persistent_set<int>{4, 5, 6, 7});
+  st.merge(copy);
+  EXPECT_EQ(st.size(), 5);
+  EXPECT_TRUE(st.contains(4));
+  EXPECT_EQ(copy.size(), 2);
+  EXPECT_EQ(*copy.begin(), 5);
+  EXPECT_EQ(*st.lower_bound(2), 3);
+  EXPECT_TRUE(st.upper_bound(6) == st.end());
+}
+
+TEST(Persistent, Readers_On_Snapshots_While_Writing) {
+  // Писатель переносит единицы между ключами, сумма всегда 1000; читатели
+  // берут снимки и проверяют сумму, пока писатель продолжает.
+  STL::persistent_map<int, int> table;
+  for (int key = 0; key < 100; ++key) table.insert(key, 10);
+  std::mutex mutex;
+  auto published = table.snapshot();
+  std::atomic<bool> done{false};
+  std::atomic<int> violations{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        STL::persistent_map<int, int> view;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          view = published;
+        }
+        int total = 0;
+        for (auto it = view.begin(); it != view.end(); ++it)
+          total += (*it).second;
+        if (total != 1000 || view.size() != 100) ++violations;
+      }
+    });
+  }
+  for (int i = 0; i < 20000; ++i) {
+    --table[i % 100];
+    ++table.at((i * 7 + 3) % 100);
+    if (i % 100 == 0) {
+      auto snapshot = table.snapshot();
+      std::lock_guard<std::mutex> lock(mutex);
+      published = snapshot;
+    }
+  }
+  done = true;
+  for (auto &reader : readers) reader.join();
+  EXPECT_EQ(violations.load(), 0);
+  int total = 0;
+  for (auto it = table.begin(); it != table.end(); ++it)
+    total += (*it).second;
+  EXPECT_EQ(total, 1000);
+}
+
+TEST(Persistent, Reading_And_Unshared_Erase_Do_Not_Allocate) {
+  using Alloc = CountingAllocator<std::pair<int, int>>;
+  using Map = STL::persistent_map<int, int, std::less<int>, Alloc>;
+  long live = 0;
+  long total = 0;
+  Map table(std::less<int>(), Alloc(&live, &total));
+  for (int key = 0; key < 512; ++key) table.insert(key, key);
+  // Узлы ни с кем не делятся: удаление, в том числе узлов с двумя
+  // детьми, только освобождает память.
+  long allocated = total;
+  for (int key = 0; key < 512; key += 3) table.erase(table.find(key));
+  EXPECT_EQ(total, allocated);
+  EXPECT_EQ(live, long(table.size()) + 1);  // и ячейка якоря итераторов
+
+  const Map snapshot = table.snapshot();
+  allocated = total;
+  const Map &source = table;
+  static_assert(
+      std::is_same_v<decltype(snapshot.begin()), Map::const_iterator>);
+  long sum = 0;
+  for (auto it = snapshot.begin(); it != snapshot.end(); ++it)
+    sum += (*it).second;
+  for (auto it = source.rbegin(); it != source.rend(); ++it)
+    sum -= (*it).second;
+  EXPECT_EQ(sum, 0);
+  EXPECT_EQ(snapshot.at(1), 1);
+  EXPECT_EQ(snapshot.front().first, 1);
+  EXPECT_EQ(source.back().first, 511);
+  EXPECT_EQ((*snapshot.find(4)).second, 4);
+  EXPECT_EQ((*source.lower_bound(6)).first, 7);
+  EXPECT_EQ((*snapshot.equal_range(7).second).first, 8);
+  EXPECT_EQ(total, allocated);
+
+  // Запись через неконстантный путь копирует узлы и не видна в снимке.
+  table.at(1) = -1;
+  EXPECT_GT(total, allocated);
+  EXPECT_EQ(snapshot.at(1), 1);
+}
+
+TEST(Persistent, Const_Readers_Share_One_Snapshot) {
+  STL::persistent_map<int, int> table;
+  for (int key = 0; key < 1000; ++key) table.insert(key, key);
+  const auto snapshot = table.snapshot();
+  std::atomic<int> violations{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&snapshot, &violations] {
+      for (int round = 0; round < 50; ++round) {
+        long sum = 0;
+        for (auto it = snapshot.begin(); it != snapshot.end(); ++it)
+          sum += (*it).second;
+        if (sum != 999 * 1000 / 2) ++violations;
+        for (int key = round; key < 1000; key += 97)
+          if (snapshot.at(key) != key) ++violations;
+        // Снимок со снимка тоже только читает общие узлы.
+        const auto copy = snapshot.snapshot();
+        if ((*copy.find(round)).second != round) ++violations;
+      }
+    });
+  }
+  for (int i = 0; i < 5000; ++i) {
+    int key = (i * 31) % 1000;
+    auto it = table.find(key);
+    if (i % 3 == 0 && it != table.end())
+      table.erase(it);
+    else
+      table[key] += i;
+  }
+  for (auto &reader : readers) reader.join();
+  EXPECT_EQ(violations.load(), 0);
+  EXPECT_EQ(snapshot.size(), 1000);
+  EXPECT_EQ(snapshot.at(999), 999);
+}
+
+
+TEST(Threaded, Matches_Std_Set) {
+  using Set = STL::set<int, std::less<int>, std::allocator<int>,
+                       STL::NoAugment, STL::ThreadedBackend>;
+  std::mt19937 rng(11);
+  Set a;
+  Set b;
+  std::set<int> expected_a;
+  std::set<int> expected_b;
+  for (int step = 0; step < 3000; ++step) {
+    int key = int(rng() % 300);
+    switch (rng() % 6) {
+      case 0:
+      case 1:
+        a.insert(key);
+        expected_a.insert(key);
+        break;
+      case 2:
+        b.insert(key);
+        expected_b.insert(key);
+        break;
+      case 3:
+        if (a.contains(key)) {
+          a.erase(a.find(key));
+          expected_a.erase(key);
+        }
+        break;
+      case 4:
+        if (step % 50 == 0) {
+          a.unite(b);
+          expected_a.insert(expected_b.begin(), expected_b.end());
+        }
+        break;
+      case 5:
+        if (step % 70 == 0) {
+          a.subtract(b);
+          for (int value : expected_b) expected_a.erase(value);
+        }
+        break;
+    }
+  }
+  Set copy(a);
+  std::vector<int> forward(copy.begin(), copy.end());
+  std::vector<int> backward;
+  if (!copy.empty()) {
+    auto it = copy.begin();
+    for (size_t i = 1; i < copy.size(); ++i) ++it;
+    for (;; --it) {
+      backward.push_back(*it);
+      if (it == copy.begin()) break;
+    }
+  }
+  std::vector<int> expected(expected_a.begin(), expected_a.end());
+  EXPECT_EQ(forward, expected);
+  std::reverse(expected.begin(), expected.end());
+  EXPECT_EQ(backward, expected);
+}
+
+TEST(Threaded, Multiset_Merge_And_Order_Statistics) {
+  using Multiset = STL::multiset<int, std::less<int>, std::allocator<int>,
+                                 STL::SubtreeSize, STL::ThreadedBackend>;
+  Multiset left{5, 1, 3, 3};
+  Multiset right{3, 2, 6};
+  left.merge(right);
+  std::vector<int> values(left.begin(), left.end());
+  EXPECT_EQ(values, (std::vector<int>{1, 2, 3, 3, 3, 5, 6}));
+  EXPECT_EQ(*left.nth(4), 3);
+  left.erase(left.find(3));
+  left.insert(4);
+  values.assign(left.begin(), left.end());
+  EXPECT_EQ(values, (std::vector<int>{1, 2, 3, 3, 4, 5, 6}));
+  auto last = left.end();
+  EXPECT_THROW(++last, std::out_of_range);
+}
+
+namespace {
+struct MapStatsTag {};
+struct ThreadStatsTag {};
+struct HandleStatsTag {};
+
+size_t Sampled(const STL::TreeCounters &counters, STL::TreeOp op) {
+  size_t total = 0;
+  for (size_t count : counters.latency[size_t(op)]) total += count;
+  return total;
+}
+}  // namespace
+
+TEST(Stats, Counts_Tree_Operations) {
+  using Stats = STL::TreeStats<MapStatsTag, 1>;
+  STL::map<int, int, std::less<int>, std::allocator<std::pair<int, int>>,
+           STL::NoAugment, STL::StatsBackend<Stats>>
+      table;
+  for (int key = 0; key < 1000; ++key) table.insert(key, key);
+  STL::TreeCounters inserted = table.stats();
+  EXPECT_EQ(inserted.allocations, 1000u);
+  EXPECT_GT(inserted.rotations, 0u);
+  EXPECT_GT(inserted.comparisons, 1000u);
+  EXPECT_GE(inserted.max_height, 10u);
+  EXPECT_LE(inserted.max_height, 15u);
+  EXPECT_EQ(Sampled(inserted, STL::TreeOp::kInsert), 1000u);
+
+  for (auto it = table.begin(); it != table.end(); ++it) {
+  }
+  EXPECT_TRUE(table.contains(500));
+  STL::TreeCounters read = table.stats();
+  EXPECT_EQ(read.iterator_steps, 1000u);
+  EXPECT_EQ(read.rotations, inserted.rotations);
+  EXPECT_EQ(Sampled(read, STL::TreeOp::kFind), 1u);
+
+  while (!table.empty()) table.erase(table.begin());
+  STL::TreeCounters erased = table.stats();
+  EXPECT_EQ(erased.deallocations, 1000u);
+  EXPECT_EQ(Sampled(erased, STL::TreeOp::kErase), 1000u);
+
+  // Без StatsBackend счётчиков нет, и контейнер не стал больше.
+  STL::map<int, int> plain;
+  plain.insert(1, 1);
+  EXPECT_EQ(plain.stats().comparisons, 0u);
+  EXPECT_EQ(sizeof(plain), sizeof(table));
+}
+
+TEST(Stats, Keeps_Counters_Of_Finished_Threads) {
+  using Set = STL::set<int, std::less<int>, std::allocator<int>,
+                       STL::NoAugment,
+                       STL::StatsBackend<STL::TreeStats<ThreadStatsTag, 0>>>;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      Set set;
+      for (int key = 0; key < 100; ++key) set.insert(key);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  STL::TreeCounters counters = Set().stats();
+  EXPECT_EQ(counters.allocations, 400u);
+  EXPECT_EQ(counters.deallocations, 400u);
+  EXPECT_EQ(Sampled(counters, STL::TreeOp::kInsert), 0u);
+}
+
+TEST(Stats, Uninstrumented_Backends_Report_Zeros) {
+  auto zero = [](const STL::TreeCounters &counters) {
+    return counters.comparisons + counters.allocations +
+               counters.deallocations + counters.iterator_steps ==
+           0;
+  };
+  STL::flat_map<int, int> flat{{1, 1}, {2, 2}};
+  STL::persistent_map<int, int> persistent{{1, 1}};
+  STL::map<int, int, std::less<int>, std::allocator<std::pair<int, int>>,
+           STL::NoAugment, STL::BTreeBackend<>>
+      btree{{1, 1}};
+  STL::set<int, std::less<int>, std::allocator<int>, STL::NoAugment,
+           STL::CompactBackend>
+      compact{1, 2, 3};
+  STL::flat_multiset<int> multi{1, 1, 2};
+  STL::multiset<int, std::less<int>, std::allocator<int>, STL::NoAugment,
+                STL::BTreeBackend<>>
+      btree_multi{1, 1};
+  EXPECT_TRUE(zero(flat.stats()));
+  EXPECT_TRUE(zero(persistent.stats()));
+  EXPECT_TRUE(zero(btree.stats()));
+  EXPECT_TRUE(zero(compact.stats()));
+  EXPECT_TRUE(zero(multi.stats()));
+  EXPECT_TRUE(zero(btree_multi.stats()));
+}
+
+
+TEST(Comparator, Custom_Order) {
+  STL::set<int, std::greater<int>> st{4, 1, 3, 2};
+  int expected = 4;
+  for (auto it = st.begin(); it != st.end(); ++it) EXPECT_EQ(*it, expected--);
+  EXPECT_TRUE(st.contains(3));
+  EXPECT_EQ(st.count(5), 0);
+
+  STL::multiset<int, std::greater<int>> ms{1, 5, 5, 3};
+  EXPECT_EQ(*ms.begin(), 5);
+  EXPECT_EQ(ms.count(5), 2);
+  EXPECT_EQ(*ms.lower_bound(4), 3);
+  EXPECT_EQ(*ms.upper_bound(5), 3);
+
+  STL::map<std::string, int, std::greater<std::string>> STL_map{
+      {"a", 1}, {"c", 3}, {"b", 2}};
+  EXPECT_EQ((*STL_map.begin()).first, "c");
+  EXPECT_EQ(STL_map.at("a"), 1);
+}
+
+TEST(Comparator, Transparent_Lookup) {
+  STL::map<std::string, int, std::less<>> STL_map{
+      {"alpha", 1}, {"beta", 2}, {"gamma", 3}};
+  std::string_view key = "beta";
+  EXPECT_TRUE(STL_map.contains(key));
+  EXPECT_EQ((*STL_map.find(key)).second, 2);
+  EXPECT_EQ(STL_map.count("gamma"), 1);
+  EXPECT_TRUE(STL_map.find(std::string_view("delta")) == STL_map.end());
+
+  STL::set<Ticket, TicketLess> tickets;
+  for (int i = 0; i < 10; ++i) tickets.insert(Ticket(i * 2));
+  STL::multiset<Ticket, TicketLess> queue;
+  for (int i = 0; i < 10; ++i) queue.insert(Ticket(i / 2));
+  int constructed = Ticket::constructed;
+  EXPECT_TRUE(tickets.contains(4));
+  EXPECT_FALSE(tickets.contains(5));
+  EXPECT_EQ(tickets.count(18), 1);
+  EXPECT_EQ((*tickets.find(6)).id, 6);
+  EXPECT_EQ(queue.count(3), 2);
+  EXPECT_EQ((*queue.lower_bound(2)).id, 2);
+  EXPECT_EQ((*queue.upper_bound(2)).id, 3);
+  auto range = queue.equal_range(4);
+  EXPECT_EQ((*range.first).id, 4);
+  EXPECT_TRUE(range.second == queue.end());
+  EXPECT_EQ(Ticket::constructed, constructed);
+}
+
+TEST(ReverseIterators, Map_Front_And_Back) {
+  STL::map<int, std::string> STL_map{{2, "two"}, {1, "one"}, {3, "three"}};
+  std::map<int, std::string> std_map{{2, "two"}, {1, "one"}, {3, "three"}};
+  auto last = STL_map.end();
+  --last;
+  EXPECT_EQ((*last).first, 3);
+  EXPECT_EQ(STL_map.front().second, "one");
+  EXPECT_EQ(STL_map.back().second, "three");
+  std::vector<std::pair<int, std::string>> backward(STL_map.rbegin(),
+                                                    STL_map.rend());
+  EXPECT_EQ(backward, (std::vector<std::pair<int, std::string>>(
+                          std_map.rbegin(), std_map.rend())));
+  STL_map.erase(last);
+  EXPECT_EQ(STL_map.back().first, 2);
+  STL_map.clear();
+  EXPECT_TRUE(STL_map.rbegin() == STL_map.rend());
+  EXPECT_THROW(STL_map.back(), std::out_of_range);
+  EXPECT_THROW(STL_map.front(), std::logic_error);
+}
+
+namespace {
+template <class Backend>
+void ExpectReverseMatchesStd() {
+  STL::multiset<int, std::less<int>, std::allocator<int>, STL::NoAugment,
+                Backend>
+      values;
+  std::multiset<int> expected;
+  for (int i = 0; i < 500; ++i) {
+    int value = (i * 7919) % 211;
+    values.insert(value);
+    expected.insert(value);
+    if (i % 4 == 3) {
+      values.erase(values.find(value));
+      expected.erase(expected.find(value));
+    }
+  }
+  EXPECT_EQ(std::vector<int>(values.rbegin(), values.rend()),
+            std::vector<int>(expected.rbegin(), expected.rend()));
+  EXPECT_EQ(values.front(), *expected.begin());
+  EXPECT_EQ(values.back(), *expected.rbegin());
+  auto it = values.end();
+  EXPECT_EQ(*--it, *expected.rbegin());
+  values.clear();
+  it = values.end();
+  EXPECT_THROW(--it, std::out_of_range);
+}
+}  // namespace
+
+TEST(ReverseIterators, Every_Backend) {
+  ExpectReverseMatchesStd<STL::AvlBackend>();
+  ExpectReverseMatchesStd<STL::ThreadedBackend>();
+  ExpectReverseMatchesStd<STL::BTreeBackend<64>>();
+  ExpectReverseMatchesStd<STL::CompactBackend>();
+  ExpectReverseMatchesStd<STL::FlatBackend>();
+}
+
+TEST(NodeHandle, Map_Moves_Nodes_Without_Allocation) {
+  long live = 0, total = 0;
+  using Alloc = CountingAllocator<std::pair<int, std::string>>;
+  using Map = STL::map<int, std::string, std::less<int>, Alloc>;
+  Alloc alloc(&live, &total);
+  Map source(alloc);
+  Map target(alloc);
+  for (int i = 0; i < 10; ++i) source.insert(i, std::to_string(i));
+  target.insert(100, "hundred");
+  long allocated = total;
+  auto node = source.extract(3);
+  EXPECT_FALSE(node.empty());
+  EXPECT_EQ(node.mapped(), "3");
+  EXPECT_FALSE(source.contains(3));
+  node.key() = 103;
+  auto result = target.insert(std::move(node));
+  EXPECT_TRUE(result.inserted);
+  EXPECT_TRUE(result.node.empty());
+  EXPECT_EQ((*result.position).second, "3");
+  EXPECT_EQ(target.at(103), "3");
+  node = source.extract(source.find(4));
+  node.key() = 100;
+  result = target.insert(std::move(node));
+  EXPECT_FALSE(result.inserted);
+  EXPECT_EQ((*result.position).second, "hundred");
+  EXPECT_EQ(result.node.mapped(), "4");
+  source.insert(source.end(), std::move(result.node));
+  EXPECT_EQ(source.at(100), "4");
+  EXPECT_EQ(total, allocated);
+  EXPECT_EQ(live, 13);
+  EXPECT_TRUE(source.extract(42).empty());
+  EXPECT_FALSE(target.insert(Map::node_type()).inserted);
+  source.extract(0);
+  EXPECT_EQ(live, 12);
+
+  long other_live = 0;
+  Alloc other_alloc(&other_live);
+  Map other(other_alloc);
+  other.insert(source.extract(100));
+  EXPECT_EQ(other.at(100), "4");
+  EXPECT_EQ(other_live, 2);
+  EXPECT_EQ(live, 11);
+}
+
+TEST(NodeHandle, Set_And_Multiset_Keep_Augment_And_Threads) {
+  using Multiset = STL::multiset<int, std::less<int>, std::allocator<int>,
+                                 STL::SubtreeSize>;
+  Multiset values{1, 2, 2, 3, 5, 8};
+  auto node = values.extract(2);
+  EXPECT_EQ(node.value(), 2);
+  EXPECT_EQ(values.count(2), 1);
+  node.value() = 4;
+  values.insert(std::move(node));
+  EXPECT_EQ(std::vector<int>(values.begin(), values.end()),
+            (std::vector<int>{1, 2, 3, 4, 5, 8}));
+  EXPECT_EQ(*values.nth(3), 4);
+  EXPECT_EQ(values.rank(5), 4);
+  EXPECT_TRUE(values.extract(7).empty());
+
+  using Set = STL::set<int, std::less<int>, std::allocator<int>,
+                       STL::NoAugment, STL::ThreadedBackend>;
+  Set left{1, 3, 5, 7};
+  Set right{2, 4};
+  for (int value : {1, 5, 7}) right.insert(left.extract(value));
+  left.insert(left.begin(), right.extract(right.begin()));
+  EXPECT_EQ(std::vector<int>(left.begin(), left.end()),
+            (std::vector<int>{1, 3}));
+  EXPECT_EQ(std::vector<int>(right.rbegin(), right.rend()),
+            (std::vector<int>{7, 5, 4, 2}));
+  EXPECT_FALSE(right.insert(left.extract(3)).node);
+  EXPECT_TRUE(right.contains(3));
+  Set::node_type empty;
+  EXPECT_THROW(empty.value(), std::logic_error);
+}
+
+TEST(NodeHandle, Dropped_Nodes_Count_As_Freed) {
+  using Stats = STL::TreeStats<HandleStatsTag, 0>;
+  using Alloc = CountingAllocator<std::pair<int, int>>;
+  using Map = STL::map<int, int, std::less<int>, Alloc, STL::NoAugment,
+                       STL::StatsBackend<Stats>>;
+  long live = 0;
+  long other_live = 0;
+  Alloc alloc(&live);
+  Alloc other_alloc(&other_live);
+  {
+    Map source(alloc);
+    Map other(other_alloc);
+    for (int key = 0; key < 8; ++key) source.insert(key, key);
+    source.extract(1);
+    { auto node = source.extract(2); }
+    // Аллокаторы не равны: значение переезжает в новый узел, старый
+    // освобождает handle.
+    other.insert(source.extract(3));
+    STL::TreeCounters counters = source.stats();
+    EXPECT_EQ(counters.allocations, 9u);
+    EXPECT_EQ(counters.deallocations, 3u);
+    EXPECT_EQ(live, 6);
+    EXPECT_EQ(other_live, 2);
+  }
+  STL::TreeCounters counters = Stats::Snapshot();
+  EXPECT_EQ(counters.allocations, 9u);
+  EXPECT_EQ(counters.deallocations, 9u);
+  EXPECT_EQ(live, 0);
+  EXPECT_EQ(other_live, 0);
+}
+
+
+TEST(NodeHandle, Changed_Values_Refresh_Aggregates) {
+  using Pair = std::pair<int, int>;
+  using Map =
+      STL::map<int, int, std::less<int>, std::allocator<Pair>,
+               STL::MonoidAugment<STL::Sum<int, STL::SelectSecond<Pair>>>>;
+  for (int key = 0; key < 16; ++key) {
+    Map table;
+    for (int other = 0; other < 16; ++other) table.insert(other, 1);
+    auto node = table.extract(key);
+    node.mapped() = 100;
+    node.key() += 50;
+    table.insert(std::move(node));
+    EXPECT_EQ(table.aggregate(0, 100), 115);
+    EXPECT_EQ(table.aggregate(50, 100), 100);
+  }
+
+  using Multiset =
+      STL::multiset<int, std::less<int>, std::allocator<int>,
+                    STL::MonoidAugment<STL::Sum<long, STL::Identity<int>>>>;
+  for (int key = 1; key <= 16; ++key) {
+    Multiset values;
+    for (int value = 1; value <= 16; ++value) values.insert(value);
+    auto node = values.extract(key);
+    node.value() = 8;
+    values.insert(values.begin(), std::move(node));
+    EXPECT_EQ(values.aggregate(0, 100), 136 - key + 8);
+    EXPECT_EQ(values.count(8), key == 8 ? 1 : 2);
+  }
+}
+
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,185 @@
+#ifndef STLCONTAINERS_TREE_STATS_H
+#define STLCONTAINERS_TREE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "drevo.h"
+
+namespace STL {
+
+// Считающая политика для Tree. Счётчики общие для всех деревьев с одной
+// политикой; контейнеры, которые нужно считать отдельно, получают свой
+// Tag. Каждый поток пишет в собственный блок обычной записью без
+// lock-префикса, Snapshot складывает блоки живых потоков с итогами уже
+// завершившихся. Задержку замеряет каждая SampleEvery-я публичная
+// операция потока; SampleEvery = 0 отключает замеры.
+template <class Tag = void, unsigned SampleEvery = 64>
+class TreeStats {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  class Timer {
+   public:
+    explicit Timer(TreeOp op) noexcept : op_(op), sampled_(Sample()) {
+      if (sampled_) start_ = Clock::now();
+    }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+    ~Timer() {
+      if (!sampled_) return;
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          Clock::now() - start_);
+      Bump(Local().latency[size_t(op_)][Bucket(elapsed.count())]);
+    }
+
+   private:
+    TreeOp op_;
+    bool sampled_;
+    Clock::time_point start_;
+  };
+
+  static void OnCompare() noexcept { Bump(Local().counters[kComparisons]); }
+  static void OnRotate() noexcept { Bump(Local().counters[kRotations]); }
+  static void OnAllocate() noexcept { Bump(Local().counters[kAllocations]); }
+  static void OnFree() noexcept { Bump(Local().counters[kDeallocations]); }
+  static void OnStep() noexcept { Bump(Local().counters[kIteratorSteps]); }
+
+  static void OnHeight(size_t height) noexcept {
+    std::atomic<size_t> &max = Local().counters[kMaxHeight];
+    if (height > max.load(std::memory_order_relaxed))
+      max.store(height, std::memory_order_relaxed);
+  }
+
+  static TreeCounters Snapshot() {
+    Registry &registry = Instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    TreeCounters result = registry.retired;
+    for (Block *block = registry.blocks; block; block = block->next)
+      Add(result, *block);
+    return result;
+  }
+
+ private:
+  enum Counter {
+    kComparisons,
+    kRotations,
+    kAllocations,
+    kDeallocations,
+    kMaxHeight,
+    kIteratorSteps,
+    kCounters
+  };
+
+  // Пишет только поток-владелец, читает Snapshot, поэтому атомики
+  // нужны лишь ради отсутствия гонки, а не ради счёта.
+  struct Block {
+    std::atomic<size_t> counters[kCounters] = {};
+    std::atomic<size_t> latency[kTreeOps][kLatencyBuckets] = {};
+    unsigned ticks = 0;
+    Block *prev = nullptr;
+    Block *next = nullptr;
+  };
+
+  struct Registry {
+    std::mutex mutex;
+    Block *blocks = nullptr;
+    TreeCounters retired;
+  };
+
+  // Реестр не разрушается: потоки могут завершаться и после статических
+  // деструкторов.
+  static Registry &Instance() {
+    static Registry *registry = new Registry;
+    return *registry;
+  }
+
+  // Блок потока встаёт в реестр при первой операции и уходит из него
+  // при завершении потока, оставляя свои итоги в retired.
+  struct Holder {
+    Block block;
+
+    Holder() {
+      Registry &registry = Instance();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      block.next = registry.blocks;
+      if (registry.blocks) registry.blocks->prev = &block;
+      registry.blocks = &block;
+    }
+
+    ~Holder() {
+      Registry &registry = Instance();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      Add(registry.retired, block);
+      if (block.prev)
+        block.prev->next = block.next;
+      else
+        registry.blocks = block.next;
+      if (block.next) block.next->prev = block.prev;
+    }
+  };
+
+  static Block &Local() noexcept {
+    thread_local Holder holder;
+    return holder.block;
+  }
+
+  static void Bump(std::atomic<size_t> &counter) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  static bool Sample() noexcept {
+    if constexpr (SampleEvery == 0) {
+      return false;
+    } else {
+      return ++Local().ticks % SampleEvery == 0;
+    }
+  }
+
+  // Номер старшего бита: [2^b, 2^(b+1)) нс -> b.
+  static size_t Bucket(int64_t nanoseconds) noexcept {
+    size_t bucket = 0;
+    while (bucket + 1 < kLatencyBuckets &&
+           (uint64_t(nanoseconds) >> (bucket + 1)) != 0)
+      ++bucket;
+    return bucket;
+  }
+
+  static void Add(TreeCounters &total, const Block &block) noexcept {
+    auto get = [&block](Counter counter) {
+      return block.counters[counter].load(std::memory_order_relaxed);
+    };
+    total.comparisons += get(kComparisons);
+    total.rotations += get(kRotations);
+    total.allocations += get(kAllocations);
+    total.deallocations += get(kDeallocations);
+    total.iterator_steps += get(kIteratorSteps);
+    if (get(kMaxHeight) > total.max_height)
+      total.max_height = get(kMaxHeight);
+    for (size_t op = 0; op < kTreeOps; ++op)
+      for (size_t bucket = 0; bucket < kLatencyBuckets; ++bucket)
+        total.latency[op][bucket] +=
+            block.latency[op][bucket].load(std::memory_order_relaxed);
+  }
+};
+
+// AVL-дерево с инструментированием для map, set и multiset:
+// STL::map<int, int, std::less<int>, std::allocator<std::pair<int, int>>,
+// NoAugment, StatsBackend<>>. Без него (AvlBackend) стоимость нулевая.
+// Threaded - то же, что ThreadedBackend.
+template <class Stats = TreeStats<>, bool Threaded = false>
+struct StatsBackend {
+  template <class T, class KeyOfValue, class Compare, class Allocator,
+            class Augment>
+  using tree =
+      Tree<T, KeyOfValue, Compare, Allocator, Augment, Stats, Threaded>;
+};
+}  // namespace STL
+
+#endif  // STLCONTAINERS_TREE_STATS_H